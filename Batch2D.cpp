@@ -0,0 +1,75 @@
+#include "Batch2D.hpp"
+
+namespace EggyEngine {
+
+    void Batch2D::configure(uint32_t verticesPerChunk) {
+
+        _verticesPerChunk = std::clamp(verticesPerChunk, 4u, MAX_VERTICES_PER_CHUNK) & ~3u;
+
+        clear();
+    }
+
+    void Batch2D::clear() {
+
+        _vertices.clear();
+        _runs.clear();
+        _chunkStarts.clear();
+    }
+
+    std::span<const Vertex2D> Batch2D::chunk(uint32_t chunk) const {
+
+        uint32_t start = _chunkStarts[chunk];
+        uint32_t end = chunk + 1 < _chunkStarts.size() ? _chunkStarts[chunk + 1] : static_cast<uint32_t>(_vertices.size());
+
+        return std::span<const Vertex2D>(_vertices).subspan(start, end - start);
+    }
+
+    Vertex2D* Batch2D::append(Primitive2D primitive, uint32_t layer, uint32_t vertexCount) {
+
+        uint32_t vertexIndex = static_cast<uint32_t>(_vertices.size());
+
+        //A primitive never straddles two chunks, the next one starts wherever the last one ran out of room
+        if (_chunkStarts.empty() || vertexIndex - _chunkStarts.back() + vertexCount > _verticesPerChunk)
+            _chunkStarts.push_back(vertexIndex);
+
+        uint32_t chunk = chunkCount() - 1;
+        uint32_t firstVertex = vertexIndex - _chunkStarts.back();
+
+        if (!_runs.empty()) {
+
+            Batch2DRun& last = _runs.back();
+
+            if (last.primitive == primitive && last.layer == layer && last.chunk == chunk && last.firstVertex + last.vertexCount == firstVertex) {
+
+                last.vertexCount += vertexCount;
+
+                _vertices.resize(vertexIndex + vertexCount);
+                return _vertices.data() + vertexIndex;
+            }
+        }
+
+        _runs.push_back({ primitive, layer, chunk, firstVertex, vertexCount });
+
+        _vertices.resize(vertexIndex + vertexCount);
+        return _vertices.data() + vertexIndex;
+    }
+
+    void Batch2D::sprite(float x, float y, float width, float height, uint32_t layer, float u0, float v0, float u1, float v1, uint32_t color) {
+
+        Vertex2D* vertices = append(Primitive2D::Quads, layer, 4);
+
+        //Top left, top right, bottom right, bottom left. The shared index buffer makes the two triangles
+        vertices[0] = { { x, y }, { u0, v0 }, color };
+        vertices[1] = { { x + width, y }, { u1, v0 }, color };
+        vertices[2] = { { x + width, y + height }, { u1, v1 }, color };
+        vertices[3] = { { x, y + height }, { u0, v1 }, color };
+    }
+
+    void Batch2D::line(float x0, float y0, float x1, float y1, uint32_t color) {
+
+        Vertex2D* vertices = append(Primitive2D::Lines, WHITE_LAYER, 2);
+
+        vertices[0] = { { x0, y0 }, { 0.5f, 0.5f }, color };
+        vertices[1] = { { x1, y1 }, { 0.5f, 0.5f }, color };
+    }
+}
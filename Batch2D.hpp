@@ -0,0 +1,102 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <span>
+
+namespace EggyEngine {
+
+	// Layout of sprite2D.vert: pixel position, texture coordinate and an R8G8B8A8_UNORM color
+	struct Vertex2D {
+
+		float position[2];
+		float texCoord[2];
+		uint32_t color;
+	};
+
+	constexpr uint32_t rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+
+		return uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24);
+	}
+
+	struct Batch2DSettings {
+
+		// Side of every layer of the sprite texture array, in pixels
+		uint32_t layerSize = 256;
+
+		// Layers of the sprite texture array, layer 0 is reserved for white
+		uint32_t layerCount = 16;
+
+		// Size of one persistently mapped vertex chunk, a frame that needs more vertices gets more chunks
+		uint32_t verticesPerChunk = 16384;
+
+		// Chunks past the first that haven't been needed for this many frames are released, 0 keeps them for good
+		uint32_t trimAfterFrames = 600;
+	};
+
+	enum class Primitive2D : uint32_t {
+		Quads,
+		Lines
+	};
+
+	// Consecutive primitives of the same kind on the same texture array layer, recorded as one draw.
+	// firstVertex is relative to the start of the chunk
+	struct Batch2DRun {
+
+		Primitive2D primitive;
+		uint32_t layer;
+		uint32_t chunk;
+		uint32_t firstVertex;
+		uint32_t vertexCount;
+	};
+
+	// CPU side of the 2D overlay, filled on the main thread and carried to the render thread in the frame packet.
+	// Vertices are split in chunks of at most verticesPerChunk, one chunk is one persistently mapped buffer on the GPU side,
+	// so running out of room just starts the next chunk instead of growing the buffer.
+	// Pixel coordinates, origin top left.
+	class Batch2D {
+	public:
+
+		// Layer 0 of the sprite texture array, plain white so untextured quads and lines sample it
+		static constexpr uint32_t WHITE_LAYER = 0;
+
+		// Quads are indexed from a shared buffer of 16 bit indices, so a chunk can't go past 65536 vertices
+		static constexpr uint32_t MAX_VERTICES_PER_CHUNK = 65536;
+
+		// Rounded down to whole quads, clears the batch
+		void configure(uint32_t verticesPerChunk);
+
+		// Keeps the capacity, a batch reused every frame stops allocating after the first ones
+		void clear();
+
+		// Region of a texture array layer, uv in [0, 1]
+		void sprite(float x, float y, float width, float height, uint32_t layer, float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 1.0f, uint32_t color = rgba(255, 255, 255));
+
+		void quad(float x, float y, float width, float height, uint32_t color) { sprite(x, y, width, height, WHITE_LAYER, 0.0f, 0.0f, 1.0f, 1.0f, color); }
+
+		void line(float x0, float y0, float x1, float y1, uint32_t color);
+
+		bool empty() const { return _vertices.empty(); }
+
+		std::span<const Vertex2D> vertices() const { return _vertices; }
+		std::span<const Batch2DRun> runs() const { return _runs; }
+
+		uint32_t chunkCount() const { return static_cast<uint32_t>(_chunkStarts.size()); }
+
+		// Vertices of a chunk, contiguous in vertices()
+		std::span<const Vertex2D> chunk(uint32_t chunk) const;
+
+		uint32_t verticesPerChunk() const { return _verticesPerChunk; }
+
+	private:
+
+		// Room for vertexCount more vertices, continues the last run when it can
+		Vertex2D* append(Primitive2D primitive, uint32_t layer, uint32_t vertexCount);
+
+		uint32_t _verticesPerChunk = 16384;
+
+		std::vector<Vertex2D> _vertices;
+		std::vector<Batch2DRun> _runs;
+		std::vector<uint32_t> _chunkStarts;
+	};
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <glm/glm.hpp>
+
+namespace EggyEngine {
+
+	struct LightingSettings {
+
+		// Lights uploaded per frame, the rest of a frame's lights are dropped. 32 bytes each, one copy per frame in flight
+		uint32_t maxLights = 4096;
+
+		// Clusters across the screen and depth slices between the near and far plane, slices are exponential in depth
+		uint32_t clustersX = 16;
+		uint32_t clustersY = 9;
+		uint32_t clustersZ = 24;
+
+		// Sizes the shared light index list, 4 bytes per entry. A frame that needs more drops the lights that don't fit
+		uint32_t averageLightsPerCluster = 64;
+	};
+
+	// local_size_x of lightCluster.comp
+	constexpr uint32_t LIGHT_CLUSTER_WORKGROUP_SIZE = 128;
+
+	// Layouts shared with lightCluster.comp and meshShader.frag, std430
+
+	struct PointLight {
+
+		// xyz world position, w radius of influence. The light fades out to nothing at the radius
+		float positionRadius[4];
+
+		// rgb color, w intensity
+		float colorIntensity[4];
+	};
+
+	static_assert(sizeof(PointLight) == 32, "PointLight has to match the lighting shaders");
+
+	// Head of the per frame light buffer, the PointLight array follows it
+	struct LightDataHeader {
+
+		glm::mat4 view;
+
+		// tan of the half field of view in x and y, near and far plane
+		glm::vec4 projection;
+
+		// xy clusters per pixel, z and w turn the log of the view depth into a slice
+		glm::vec4 clusterScale;
+
+		// xyz cluster counts
+		uint32_t clusterGrid[4];
+
+		// x light count, y capacity of the light index list
+		uint32_t counts[4];
+
+		// Camera of the mesh vertex shaders. Kept out of the push constants so a moving camera doesn't change what
+		// gets recorded, see EngineSettings::reuseCommandBuffers
+		glm::mat4 viewProjection;
+	};
+
+	static_assert(sizeof(LightDataHeader) == 192, "LightDataHeader has to match LightData in the lighting shaders");
+}
@@ -0,0 +1,248 @@
+#include "DebugSink.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+namespace Debug {
+
+    // Everything only the drain thread touches
+    struct DebugSink::Impl {
+
+        struct Record {
+
+            std::string idName;
+            VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+            VkDebugUtilsMessageTypeFlagsEXT type;
+
+            uint64_t count = 0;
+
+            std::chrono::steady_clock::time_point windowStart{};
+            uint32_t printedInWindow = 0;
+            uint64_t suppressedInWindow = 0;
+        };
+
+        DebugSinkSettings settings{};
+
+        std::unordered_map<uint64_t, Record> records;
+
+        std::ostringstream output;
+
+        std::atomic<uint64_t> printed{ 0 };
+        std::atomic<uint64_t> suppressed{ 0 };
+
+        void writeSuppressed(const Record& record, uint64_t count);
+    };
+
+    static const char* severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+
+        switch (severity) {
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: return "verbose";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT: return "info";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "warning";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT: return "error";
+        default: return "unknown";
+        }
+    }
+
+    static const char* typeName(VkDebugUtilsMessageTypeFlagsEXT type) {
+
+        if (type & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)
+            return "validation";
+
+        if (type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)
+            return "performance";
+
+        return "general";
+    }
+
+    //Messages without an id (loader, verbose driver chatter) are told apart by their text
+    static uint64_t messageKey(const DebugMessage& message) {
+
+        if (message.idNumber != 0)
+            return static_cast<uint32_t>(message.idNumber);
+
+        uint64_t hash = 0xCBF29CE484222325ull;
+
+        for (const char* c = message.text; *c; c++)
+            hash = (hash ^ static_cast<uint8_t>(*c)) * 0x100000001B3ull;
+
+        return hash | (1ull << 63);
+    }
+
+    void DebugSink::Impl::writeSuppressed(const Record& record, uint64_t count) {
+
+        output << "[vulkan] severity=" << severityName(record.severity) << " type=" << typeName(record.type)
+            << " id=" << record.idName << " suppressed=" << record.suppressedInWindow << " count=" << count << '\n';
+    }
+
+    DebugSink::DebugSink() : _slots(new Slot[RING_CAPACITY]), _impl(std::make_unique<Impl>()) {
+
+        for (size_t i = 0; i < RING_CAPACITY; i++)
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    DebugSink::~DebugSink() {
+
+        stop();
+    }
+
+    void DebugSink::start(const DebugSinkSettings& settings) {
+
+        if (_running.exchange(true))
+            return;
+
+        _impl->settings = settings;
+        setSeverityFilter(settings.severityFilter);
+
+        _thread = std::thread(&DebugSink::drainThread, this);
+    }
+
+    void DebugSink::stop() {
+
+        if (!_running.exchange(false))
+            return;
+
+        _thread.join();
+
+        //Whatever came in after the last wake up
+        drain();
+
+        auto& impl = *_impl;
+
+        //Close every window so repeats are never lost
+        for (auto& [key, record] : impl.records)
+            if (record.suppressedInWindow > 0)
+                impl.writeSuppressed(record, record.count);
+
+        if (impl.settings.summaryOnStop && !impl.records.empty()) {
+
+            std::vector<const Impl::Record*> sorted;
+
+            for (const auto& [key, record] : impl.records)
+                sorted.push_back(&record);
+
+            std::sort(sorted.begin(), sorted.end(), [](const Impl::Record* a, const Impl::Record* b) { return a->count > b->count; });
+
+            DebugSinkStats totals = stats();
+
+            impl.output << "[vulkan] summary received=" << totals.received << " filtered=" << totals.filtered << " dropped=" << totals.dropped
+                << " printed=" << totals.printed << " suppressed=" << totals.suppressed << " unique=" << sorted.size() << '\n';
+
+            for (const auto* record : sorted)
+                impl.output << "[vulkan]   count=" << record->count << " severity=" << severityName(record->severity) << " id=" << record->idName << '\n';
+        }
+
+        std::cerr << impl.output.str() << std::flush;
+        impl.output.str({});
+    }
+
+    DebugSinkStats DebugSink::stats() const {
+
+        return {
+            .received = _received.load(std::memory_order_relaxed),
+            .filtered = _filtered.load(std::memory_order_relaxed),
+            .dropped = _dropped.load(std::memory_order_relaxed),
+            .printed = _impl->printed.load(std::memory_order_relaxed),
+            .suppressed = _impl->suppressed.load(std::memory_order_relaxed)
+        };
+    }
+
+    bool DebugSink::pop(DebugMessage& message) {
+
+        Slot& slot = _slots[_dequeuePosition & (RING_CAPACITY - 1)];
+
+        if (slot.sequence.load(std::memory_order_acquire) != _dequeuePosition + 1)
+            return false;
+
+        message = slot.message;
+
+        //Hand the slot back to the producers one lap later
+        slot.sequence.store(_dequeuePosition + RING_CAPACITY, std::memory_order_release);
+        _dequeuePosition++;
+
+        return true;
+    }
+
+    void DebugSink::drainThread() {
+
+        auto interval = std::chrono::duration<double>(_impl->settings.drainIntervalSeconds);
+
+        while (_running.load(std::memory_order_acquire)) {
+
+            drain();
+
+            std::string text = _impl->output.str();
+
+            //One write per wake up instead of one flush per message
+            if (!text.empty()) {
+                std::cerr << text << std::flush;
+                _impl->output.str({});
+            }
+
+            std::this_thread::sleep_for(interval);
+        }
+    }
+
+    void DebugSink::drain() {
+
+        auto& impl = *_impl;
+
+        auto window = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(impl.settings.rateWindowSeconds));
+        auto now = std::chrono::steady_clock::now();
+
+        DebugMessage message;
+
+        while (pop(message)) {
+
+            auto [entry, inserted] = impl.records.try_emplace(messageKey(message));
+            auto& record = entry->second;
+
+            if (inserted) {
+                record.idName = message.idName[0] ? message.idName : "none";
+                record.severity = message.severity;
+                record.type = message.type;
+                record.windowStart = message.time;
+            }
+
+            record.count++;
+
+            if (message.time - record.windowStart >= window) {
+
+                if (record.suppressedInWindow > 0)
+                    impl.writeSuppressed(record, record.count - 1);
+
+                record.windowStart = message.time;
+                record.printedInWindow = 0;
+                record.suppressedInWindow = 0;
+            }
+
+            if (record.printedInWindow >= impl.settings.maxRepeatsPerWindow) {
+
+                record.suppressedInWindow++;
+                impl.suppressed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            record.printedInWindow++;
+            impl.printed.fetch_add(1, std::memory_order_relaxed);
+
+            impl.output << "[vulkan] severity=" << severityName(message.severity) << " type=" << typeName(message.type)
+                << " id=" << record.idName << " count=" << record.count << " | " << message.text << '\n';
+        }
+
+        //Windows of ids that went quiet close here, otherwise their repeats would only show up at shutdown
+        for (auto& [key, record] : impl.records)
+            if (record.suppressedInWindow > 0 && now - record.windowStart >= window) {
+
+                impl.writeSuppressed(record, record.count);
+
+                record.windowStart = now;
+                record.printedInWindow = 0;
+                record.suppressedInWindow = 0;
+            }
+    }
+}
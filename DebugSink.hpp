@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// Validation and debug messages are copied into a lock-free ring by whatever thread the driver calls back on,
+// a background thread deduplicates, rate limits and prints them. The callback never touches a stream or a lock.
+
+namespace Debug {
+
+    struct DebugSinkSettings {
+
+        // Messages below this never leave the callback, can be changed at runtime
+        VkDebugUtilsMessageSeverityFlagsEXT severityFilter = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+
+        // Every message id is printed at most this many times per window, the rest are counted and reported
+        // once when the window closes
+        uint32_t maxRepeatsPerWindow = 3;
+        double rateWindowSeconds = 1.0;
+
+        // How often the background thread wakes up to drain the ring
+        double drainIntervalSeconds = 0.01;
+
+        // Prints the count of every message id when the sink stops
+        bool summaryOnStop = true;
+    };
+
+    struct DebugSinkStats {
+
+        uint64_t received = 0;
+        uint64_t filtered = 0;
+
+        // Ring was full, the drain thread is behind
+        uint64_t dropped = 0;
+
+        uint64_t printed = 0;
+        uint64_t suppressed = 0;
+    };
+
+    struct DebugMessage {
+
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        VkDebugUtilsMessageTypeFlagsEXT type;
+
+        int32_t idNumber;
+        char idName[96];
+
+        // Truncated to fit, validation messages are rarely longer
+        char text[1024];
+
+        std::chrono::steady_clock::time_point time;
+    };
+
+    class DebugSink {
+    public:
+
+        DebugSink();
+        ~DebugSink();
+
+        DebugSink(const DebugSink&) = delete;
+        DebugSink& operator=(const DebugSink&) = delete;
+
+        void start(const DebugSinkSettings& settings);
+
+        // Drains what is left, prints the summary and joins the thread
+        void stop();
+
+        void setSeverityFilter(VkDebugUtilsMessageSeverityFlagsEXT severityFilter) { _severityFilter.store(severityFilter, std::memory_order_relaxed); }
+
+        DebugSinkStats stats() const;
+
+        // pUserData has to be the sink
+        static VKAPI_ATTR VkBool32 VKAPI_CALL messengerCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
+
+            static_cast<DebugSink*>(pUserData)->push(messageSeverity, messageType, pCallbackData);
+
+            //Never abort the call that triggered the message
+            return VK_FALSE;
+        }
+
+        // Any thread, wait free unless another producer is claiming the same slot
+        void push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* data) {
+
+            _received.fetch_add(1, std::memory_order_relaxed);
+
+            if (!(severity & _severityFilter.load(std::memory_order_relaxed))) {
+                _filtered.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            //Bounded multi producer queue: a slot is free for position p when its sequence is p
+            size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+            Slot* slot;
+
+            while (true) {
+
+                slot = &_slots[position & (RING_CAPACITY - 1)];
+
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                if (difference == 0) {
+                    if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0) {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                else
+                    position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+
+            DebugMessage& message = slot->message;
+
+            message.severity = severity;
+            message.type = type;
+            message.idNumber = data->messageIdNumber;
+            message.time = std::chrono::steady_clock::now();
+
+            copyTruncated(message.idName, sizeof(message.idName), data->pMessageIdName);
+            copyTruncated(message.text, sizeof(message.text), data->pMessage);
+
+            slot->sequence.store(position + 1, std::memory_order_release);
+        }
+
+    private:
+
+        static constexpr size_t RING_CAPACITY = 1024;
+
+        static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0, "ring capacity has to be a power of two");
+
+        struct Slot {
+            std::atomic<size_t> sequence;
+            DebugMessage message;
+        };
+
+        static void copyTruncated(char* destination, size_t capacity, const char* source) {
+
+            if (!source) {
+                destination[0] = '\0';
+                return;
+            }
+
+            size_t length = strnlen(source, capacity - 1);
+
+            std::memcpy(destination, source, length);
+            destination[length] = '\0';
+        }
+
+        bool pop(DebugMessage& message);
+
+        void drainThread();
+        void drain();
+
+        struct Impl;
+
+        // Heap allocated, the ring alone is about a megabyte
+        std::unique_ptr<Slot[]> _slots;
+        std::unique_ptr<Impl> _impl;
+
+        alignas(64) std::atomic<size_t> _enqueuePosition{ 0 };
+        alignas(64) size_t _dequeuePosition = 0;
+
+        std::atomic<VkDebugUtilsMessageSeverityFlagsEXT> _severityFilter{ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT };
+
+        std::atomic<uint64_t> _received{ 0 };
+        std::atomic<uint64_t> _filtered{ 0 };
+        std::atomic<uint64_t> _dropped{ 0 };
+
+        std::atomic<bool> _running{ false };
+        std::thread _thread;
+    };
+}
@@ -0,0 +1,61 @@
+#include "DeletionQueue.hpp"
+
+namespace EggyEngine {
+
+    void DeletionQueue::configure(const DeletionQueueSettings& settings) {
+
+        std::lock_guard lock(_mutex);
+        _settings = settings;
+    }
+
+    void DeletionQueue::retire(VkObjectType type, uint64_t handle) {
+
+        std::lock_guard lock(_mutex);
+
+        _retired.push_back({ .type = type, .handle = handle, .serial = _serial + 1 });
+        _retiredCount++;
+    }
+
+    void DeletionQueue::beginFrame(uint64_t serial, uint64_t completedSerial, std::vector<RetiredObject>& ready) {
+
+        std::lock_guard lock(_mutex);
+
+        _serial = serial;
+
+        uint32_t budget = _settings.destroysPerFrame;
+        uint32_t taken = 0;
+
+        //Ordered by serial, the first one still in flight ends the run
+        while (!_retired.empty() && _retired.front().serial <= completedSerial) {
+
+            if (budget != 0 && taken++ == budget)
+                break;
+
+            ready.push_back(_retired.front());
+            _retired.pop_front();
+
+            _destroyedCount++;
+        }
+    }
+
+    void DeletionQueue::flush(std::vector<RetiredObject>& ready) {
+
+        std::lock_guard lock(_mutex);
+
+        ready.insert(ready.end(), _retired.begin(), _retired.end());
+
+        _destroyedCount += _retired.size();
+        _retired.clear();
+    }
+
+    DeletionQueueStats DeletionQueue::stats() const {
+
+        std::lock_guard lock(_mutex);
+
+        return {
+            .retired = _retiredCount,
+            .destroyed = _destroyedCount,
+            .pending = _retired.size()
+        };
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace EggyEngine {
+
+	struct DeletionQueueSettings {
+
+		// Objects destroyed per frame at most, the rest carry over to the next frames so a large release doesn't
+		// land on one frame. 0 destroys everything that is ready
+		uint32_t destroysPerFrame = 32;
+	};
+
+	struct DeletionQueueStats {
+
+		uint64_t retired = 0;
+		uint64_t destroyed = 0;
+
+		// Waiting for the GPU or for budget
+		uint64_t pending = 0;
+	};
+
+	struct RetiredObject {
+
+		VkObjectType type;
+		uint64_t handle;
+
+		// Frame that has to complete on the GPU before the object can go
+		uint64_t serial;
+	};
+
+	// Objects retired while frames are in flight, handed back for destruction once the GPU is past every frame that
+	// could have recorded them. Frames are numbered by a serial the render thread advances, the fence of a frame in
+	// flight signals in submission order so it also covers every earlier serial
+	class DeletionQueue {
+	public:
+
+		void configure(const DeletionQueueSettings& settings);
+
+		// Any thread. Kept until the frame after the one being recorded has completed, so a retire racing the start
+		// of the next frame is still covered. Nothing may record the object after it has been retired
+		void retire(VkObjectType type, uint64_t handle);
+
+		// Render thread, once per frame after the fence wait. serial is the frame about to be recorded and every frame up to
+		// completedSerial has finished. Appends what can be destroyed now to ready, oldest first and within the budget
+		void beginFrame(uint64_t serial, uint64_t completedSerial, std::vector<RetiredObject>& ready);
+
+		// The device is idle, everything goes regardless of budget
+		void flush(std::vector<RetiredObject>& ready);
+
+		DeletionQueueStats stats() const;
+
+	private:
+
+		mutable std::mutex _mutex;
+
+		DeletionQueueSettings _settings{};
+
+		// Serials only grow under the lock, so the queue is ordered by serial
+		std::deque<RetiredObject> _retired;
+
+		uint64_t _serial = 0;
+
+		uint64_t _retiredCount = 0;
+		uint64_t _destroyedCount = 0;
+	};
+}
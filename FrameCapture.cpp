@@ -0,0 +1,219 @@
+#include "FrameCapture.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace EggyEngine {
+
+    // Everything only the encoder thread touches once it runs
+    struct FrameCapture::Impl {
+
+        FrameCaptureSettings settings{};
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        CapturePixelLayout layout = CapturePixelLayout::BGRA;
+
+        std::filesystem::path directory;
+
+        std::ofstream raw;
+
+        // RGB rows of the image being written, kept between frames
+        std::vector<uint8_t> converted;
+
+        void writeImage(const CapturedFrame& frame);
+        void writeRaw(const CapturedFrame& frame);
+        void writeDescription(uint64_t frames);
+
+        size_t frameBytes() const { return size_t(width) * height * 4; }
+    };
+
+    void FrameCapture::Impl::writeImage(const CapturedFrame& frame) {
+
+        size_t pixelCount = size_t(width) * height;
+
+        converted.resize(pixelCount * 3);
+
+        //Drop alpha, and swap red and blue for BGRA
+        size_t red = layout == CapturePixelLayout::BGRA ? 2 : 0;
+        size_t blue = 2 - red;
+
+        const uint8_t* source = frame.pixels;
+        uint8_t* destination = converted.data();
+
+        for (size_t i = 0; i < pixelCount; i++, source += 4, destination += 3) {
+
+            destination[0] = source[red];
+            destination[1] = source[1];
+            destination[2] = source[blue];
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%08llu.ppm", static_cast<unsigned long long>(frame.frameNumber));
+
+        std::ofstream file(directory / name, std::ios::binary);
+
+        file << "P6\n" << width << ' ' << height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(converted.data()), converted.size());
+    }
+
+    void FrameCapture::Impl::writeRaw(const CapturedFrame& frame) {
+
+        //As stored, a straight copy keeps the encoder well ahead of the render thread
+        raw.write(reinterpret_cast<const char*>(frame.pixels), frameBytes());
+    }
+
+    void FrameCapture::Impl::writeDescription(uint64_t frames) {
+
+        const char* pixelFormat = layout == CapturePixelLayout::BGRA ? "bgra" : "rgba";
+
+        std::ofstream file(directory / "capture.txt");
+
+        file << "width=" << width << '\n'
+            << "height=" << height << '\n'
+            << "pixel_format=" << pixelFormat << '\n'
+            << "frames=" << frames << '\n'
+            << "ffmpeg -f rawvideo -pixel_format " << pixelFormat << " -video_size " << width << 'x' << height << " -i capture.raw capture.mp4\n";
+    }
+
+    FrameCapture::FrameCapture() : _impl(std::make_unique<Impl>()) {
+    }
+
+    FrameCapture::~FrameCapture() {
+
+        stop();
+    }
+
+    void FrameCapture::start(const FrameCaptureSettings& settings, uint32_t width, uint32_t height, CapturePixelLayout layout) {
+
+        if (_running)
+            return;
+
+        auto& impl = *_impl;
+
+        impl.settings = settings;
+        impl.width = width;
+        impl.height = height;
+        impl.layout = layout;
+        impl.directory = settings.directory;
+
+        std::error_code error;
+        std::filesystem::create_directories(impl.directory, error);
+
+        if (error)
+            Debug::errorWindow(L"failed to create the capture directory!");
+
+        if (settings.format == CaptureFormat::RawVideo) {
+
+            impl.raw.open(impl.directory / "capture.raw", std::ios::binary | std::ios::trunc);
+
+            if (!impl.raw)
+                Debug::errorWindow(L"failed to open the capture file!");
+        }
+
+        _queue.clear();
+        _freeSlots.clear();
+
+        for (uint32_t i = settings.ringSize; i > 0; i--)
+            _freeSlots.push_back(i - 1);
+
+        _stopping = false;
+        _running = true;
+
+        _thread = std::thread(&FrameCapture::encoderThread, this);
+    }
+
+    void FrameCapture::stop() {
+
+        if (!_running)
+            return;
+
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+
+        _wake.notify_one();
+        _thread.join();
+
+        _running = false;
+
+        auto& impl = *_impl;
+
+        if (impl.settings.format == CaptureFormat::RawVideo) {
+
+            impl.raw.close();
+            impl.writeDescription(_written.load(std::memory_order_relaxed));
+        }
+    }
+
+    bool FrameCapture::acquireSlot(uint32_t& slot) {
+
+        std::lock_guard lock(_mutex);
+
+        if (_freeSlots.empty()) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+
+        return true;
+    }
+
+    void FrameCapture::submit(const CapturedFrame& frame) {
+
+        {
+            std::lock_guard lock(_mutex);
+            _queue.push_back(frame);
+        }
+
+        _captured.fetch_add(1, std::memory_order_relaxed);
+        _wake.notify_one();
+    }
+
+    CaptureStats FrameCapture::stats() const {
+
+        return {
+            .captured = _captured.load(std::memory_order_relaxed),
+            .dropped = _dropped.load(std::memory_order_relaxed),
+            .written = _written.load(std::memory_order_relaxed),
+            .bytesWritten = _bytesWritten.load(std::memory_order_relaxed)
+        };
+    }
+
+    void FrameCapture::encoderThread() {
+
+        auto& impl = *_impl;
+
+        while (true) {
+
+            CapturedFrame frame;
+
+            {
+                std::unique_lock lock(_mutex);
+                _wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+
+                //Stopping only once everything queued is on disk
+                if (_queue.empty())
+                    return;
+
+                frame = _queue.front();
+                _queue.pop_front();
+            }
+
+            if (impl.settings.format == CaptureFormat::ImageSequence)
+                impl.writeImage(frame);
+            else
+                impl.writeRaw(frame);
+
+            _written.fetch_add(1, std::memory_order_relaxed);
+            _bytesWritten.fetch_add(impl.settings.format == CaptureFormat::ImageSequence ? impl.converted.size() : impl.frameBytes(), std::memory_order_relaxed);
+
+            std::lock_guard lock(_mutex);
+            _freeSlots.push_back(frame.slot);
+        }
+    }
+}
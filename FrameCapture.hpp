@@ -0,0 +1,114 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace EggyEngine {
+
+	enum class CaptureFormat {
+		ImageSequence,	// One binary PPM per frame, converted to RGB on the encoder thread
+		RawVideo		// Every frame appended to capture.raw as the swapchain stores it, capture.txt describes the stream
+	};
+
+	struct FrameCaptureSettings {
+
+		// Where the files go, created if missing. Empty turns capture off
+		std::string directory{};
+
+		CaptureFormat format = CaptureFormat::RawVideo;
+
+		// Host visible readback buffers of one frame each. A frame is dropped when every buffer is still being copied
+		// on the GPU or waiting for the encoder, the encoder falling behind never stalls the render thread
+		uint32_t ringSize = 6;
+
+		// Captures every Nth frame
+		uint32_t interval = 1;
+	};
+
+	struct CaptureStats {
+
+		// Copied out of the swapchain and handed to the encoder
+		uint64_t captured = 0;
+
+		// No free readback buffer, the encoder is behind
+		uint64_t dropped = 0;
+
+		uint64_t written = 0;
+		uint64_t bytesWritten = 0;
+	};
+
+	// Byte order of the 4 byte swapchain formats
+	enum class CapturePixelLayout {
+		RGBA,
+		BGRA
+	};
+
+	struct CapturedFrame {
+
+		// Readback buffer the frame was copied into, the pixels stay valid until the encoder releases it
+		uint32_t slot = 0;
+		const uint8_t* pixels = nullptr;
+
+		uint64_t frameNumber = 0;
+	};
+
+	// Encoder side of the frame capture. The engine owns the readback buffers, this hands out free ones to the render
+	// thread and writes the filled ones to disk on a background thread
+	class FrameCapture {
+	public:
+
+		FrameCapture();
+		~FrameCapture();
+
+		FrameCapture(const FrameCapture&) = delete;
+		FrameCapture& operator=(const FrameCapture&) = delete;
+
+		// Every frame of the session has the same size and layout, tightly packed rows of 4 bytes per pixel
+		void start(const FrameCaptureSettings& settings, uint32_t width, uint32_t height, CapturePixelLayout layout);
+
+		// Writes what is still queued, closes the files and joins the encoder
+		void stop();
+
+		bool running() const { return _running; }
+
+		// Render thread, false drops the frame
+		bool acquireSlot(uint32_t& slot);
+
+		// Render thread, once the copy into frame.slot has completed and is visible to the host
+		void submit(const CapturedFrame& frame);
+
+		CaptureStats stats() const;
+
+	private:
+
+		void encoderThread();
+
+		struct Impl;
+
+		std::unique_ptr<Impl> _impl;
+
+		std::mutex _mutex;
+		std::condition_variable _wake;
+
+		std::deque<CapturedFrame> _queue;
+		std::vector<uint32_t> _freeSlots;
+
+		bool _stopping = false;
+		bool _running = false;
+
+		std::atomic<uint64_t> _captured{ 0 };
+		std::atomic<uint64_t> _dropped{ 0 };
+		std::atomic<uint64_t> _written{ 0 };
+		std::atomic<uint64_t> _bytesWritten{ 0 };
+
+		std::thread _thread;
+	};
+}
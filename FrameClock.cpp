@@ -0,0 +1,46 @@
+#include "FrameClock.hpp"
+
+namespace EggyEngine {
+
+    uint32_t FrameClock::beginFrame() {
+
+        auto now = Clock::now();
+
+        //First frame has no previous one to measure against
+        double delta = (_lastFrame == Clock::time_point{}) ? 0.0 : seconds(now - _lastFrame);
+        _lastFrame = now;
+
+        delta = std::min(delta, _settings.maxFrameDelta) * _settings.timeScale;
+
+        _timing.frameNumber++;
+        _timing.deltaTime = delta;
+
+        _accumulator += delta;
+
+        uint32_t steps = static_cast<uint32_t>(_accumulator / _settings.fixedTimestep);
+
+        //Can't catch up, drop the extra time instead of taking longer and longer every frame
+        if (steps > _settings.maxStepsPerFrame) {
+
+            double dropped = (steps - _settings.maxStepsPerFrame) * _settings.fixedTimestep;
+
+            _accumulator -= dropped;
+            _timing.droppedTime += dropped;
+
+            steps = _settings.maxStepsPerFrame;
+        }
+
+        _accumulator -= steps * _settings.fixedTimestep;
+        _timing.stepsThisFrame = steps;
+
+        return steps;
+    }
+
+    void FrameClock::endFrame(Clock::time_point updateStart) {
+
+        _timing.updateMs = seconds(Clock::now() - updateStart) * 1000.0;
+        _timing.averageUpdateMs = (_timing.frameNumber <= 1) ? _timing.updateMs : _timing.averageUpdateMs * 0.95 + _timing.updateMs * 0.05;
+
+        _timing.interpolationAlpha = std::clamp(_accumulator / _settings.fixedTimestep, 0.0, 1.0);
+    }
+}
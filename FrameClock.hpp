@@ -0,0 +1,89 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <chrono>
+
+namespace EggyEngine {
+
+	struct FrameClockSettings {
+
+		// Simulation step, independent of the render rate
+		double fixedTimestep = 1.0 / 60.0;
+
+		// Spiral of death guard: steps beyond this are dropped and the simulation falls behind real time instead
+		uint32_t maxStepsPerFrame = 5;
+
+		// Frame deltas above this (debugger breaks, window drags) are clamped before they reach the accumulator
+		double maxFrameDelta = 0.25;
+
+		double timeScale = 1.0;
+	};
+
+	struct FrameTiming {
+
+		uint64_t frameNumber = 0;
+
+		// Real time between the last two frames, after clamping and scaling
+		double deltaTime = 0.0;
+
+		double simulationTime = 0.0;
+
+		// How far between the previous and current simulation state the frame sits, 0..1
+		double interpolationAlpha = 0.0;
+
+		uint32_t stepsThisFrame = 0;
+
+		// Seconds of simulated time thrown away by the step clamp
+		double droppedTime = 0.0;
+
+		// CPU cost of the update steps, separate from recording and presenting
+		double updateMs = 0.0;
+		double averageUpdateMs = 0.0;
+	};
+
+	class FrameClock {
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		void configure(const FrameClockSettings& settings) { _settings = settings; }
+		const FrameClockSettings& settings() const { return _settings; }
+
+		// Advances to now and runs every due fixed step through step(dt). Returns the timing of this frame
+		template <typename StepFunction>
+		const FrameTiming& tick(StepFunction&& step) {
+
+			uint32_t steps = beginFrame();
+
+			auto updateStart = Clock::now();
+
+			for (uint32_t i = 0; i < steps; i++) {
+
+				step(_settings.fixedTimestep);
+				_timing.simulationTime += _settings.fixedTimestep;
+			}
+
+			endFrame(updateStart);
+
+			return _timing;
+		}
+
+		const FrameTiming& timing() const { return _timing; }
+
+		static double seconds(Clock::duration duration) { return std::chrono::duration<double>(duration).count(); }
+
+	private:
+
+		uint32_t beginFrame();
+		void endFrame(Clock::time_point updateStart);
+
+		FrameClockSettings _settings{};
+
+		Clock::time_point _lastFrame{};
+
+		double _accumulator = 0.0;
+
+		FrameTiming _timing{};
+	};
+}
@@ -0,0 +1,169 @@
+#include "FramePacing.hpp"
+
+#include <thread>
+
+namespace EggyEngine {
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    void FramePacer::configure(const FramePacingSettings& settings) {
+
+        _settings = settings;
+
+        //Force a resync of the deadline with the new period
+        _nextDeadline = {};
+    }
+
+    VkPresentModeKHR FramePacer::selectPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPhysicalDeviceType deviceType) const {
+
+        std::vector<VkPresentModeKHR> candidates;
+
+        switch (_settings.presentModePolicy) {
+        case PresentModePolicy::DeviceDefault:
+            // This is a discrete GPU (e.g. Nvidia or AMD)
+            if (deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+                candidates = { VK_PRESENT_MODE_MAILBOX_KHR };
+            // This is an integrated GPU (e.g. Intel HD Graphics)
+            else if (deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+                candidates = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            break;
+        case PresentModePolicy::LowLatency: candidates = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR }; break;
+        case PresentModePolicy::NoTearing: candidates = { VK_PRESENT_MODE_MAILBOX_KHR }; break;
+        case PresentModePolicy::AdaptiveVSync: candidates = { VK_PRESENT_MODE_FIFO_RELAXED_KHR }; break;
+        case PresentModePolicy::VSync: break;
+        }
+
+        for (auto candidate : candidates)
+            if (std::find(availablePresentModes.begin(), availablePresentModes.end(), candidate) != availablePresentModes.end())
+                return candidate;
+
+        //FIFO is the only mode that is required to be supported
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    double FramePacer::framePeriodMs() const {
+
+        if (_settings.targetFrameRate > 0.0)
+            return 1000.0 / _settings.targetFrameRate;
+
+        //Without a limiter the low latency mode uses the measured present interval (the refresh rate under FIFO)
+        if (_settings.lowLatencyMode)
+            return averageFrameMs();
+
+        return 0.0;
+    }
+
+    void FramePacer::preciseSleepUntil(Clock::time_point deadline) {
+
+        // The OS sleep is only trusted up to the worst oversleep we have seen, the rest is spun
+        while (true) {
+
+            auto now = Clock::now();
+            double remainingMs = Milliseconds(deadline - now).count();
+            double spinMs = std::max(_settings.minSpinMs, _sleepErrorMs);
+
+            if (remainingMs <= spinMs)
+                break;
+
+            double requestedMs = remainingMs - spinMs;
+
+            Platform::sleepFor(requestedMs / 1000.0);
+
+            double oversleepMs = Milliseconds(Clock::now() - now).count() - requestedMs;
+            _sleepErrorMs = std::max(oversleepMs, _sleepErrorMs * 0.99);
+        }
+
+        while (Clock::now() < deadline)
+            std::this_thread::yield();
+    }
+
+    double FramePacer::waitForFrameStart() {
+
+        double periodMs = framePeriodMs();
+
+        if (periodMs <= 0.0) {
+            _frameStart = Clock::now();
+            return 0.0;
+        }
+
+        auto period = std::chrono::duration_cast<Clock::duration>(Milliseconds(periodMs));
+        auto now = Clock::now();
+
+        //First frame, new settings or we fell more than a frame behind: restart the schedule from now
+        if (_nextDeadline == Clock::time_point{} || now > _nextDeadline + period)
+            _nextDeadline = now + period;
+
+        // _nextDeadline is when this frame should be presented, normally the frame starts one period before it.
+        // In low latency mode we start as late as the predicted CPU cost allows, so input is sampled right before it is needed.
+        auto frameStart = _nextDeadline - period;
+
+        if (_settings.lowLatencyMode) {
+
+            double predictedMs = std::min(averageCpuFrameMs() + _settings.lowLatencySafetyMs, periodMs);
+            frameStart = _nextDeadline - std::chrono::duration_cast<Clock::duration>(Milliseconds(predictedMs));
+        }
+
+        if (frameStart > now)
+            preciseSleepUntil(frameStart);
+
+        _frameStart = Clock::now();
+        _nextDeadline += period;
+
+        return Milliseconds(_frameStart - now).count();
+    }
+
+    void FramePacer::markInput() {
+
+        if (_hasPendingInput)
+            return;
+
+        _pendingInput = Clock::now();
+        _hasPendingInput = true;
+    }
+
+    std::optional<FramePacer::Clock::time_point> FramePacer::consumeInput() {
+
+        if (!_hasPendingInput)
+            return std::nullopt;
+
+        _hasPendingInput = false;
+        return _pendingInput;
+    }
+
+    void FramePacer::markPresented(Clock::time_point frameStart, std::optional<Clock::time_point> inputTime) {
+
+        auto now = Clock::now();
+
+        double cpuMs = Milliseconds(now - frameStart).count();
+        double avgCpuMs = _avgCpuMs.load(std::memory_order_relaxed);
+        _avgCpuMs.store((avgCpuMs == 0.0) ? cpuMs : avgCpuMs * 0.9 + cpuMs * 0.1, std::memory_order_relaxed);
+
+        if (_lastPresent != Clock::time_point{}) {
+
+            double frameMs = Milliseconds(now - _lastPresent).count();
+            double avgFrameMs = _avgFrameMs.load(std::memory_order_relaxed);
+            _avgFrameMs.store((avgFrameMs == 0.0) ? frameMs : avgFrameMs * 0.9 + frameMs * 0.1, std::memory_order_relaxed);
+        }
+
+        _lastPresent = now;
+
+        if (!inputTime)
+            return;
+
+        double latencyMs = Milliseconds(now - *inputTime).count();
+
+        std::lock_guard<std::mutex> lock(_latencyMutex);
+
+        _latency.lastMs = latencyMs;
+        _latency.minMs = (_latency.samples == 0) ? latencyMs : std::min(_latency.minMs, latencyMs);
+        _latency.maxMs = std::max(_latency.maxMs, latencyMs);
+        _latency.averageMs = (_latency.averageMs * _latency.samples + latencyMs) / (_latency.samples + 1);
+        _latency.samples++;
+    }
+
+    LatencyStats FramePacer::latencyStats() const {
+
+        std::lock_guard<std::mutex> lock(_latencyMutex);
+        return _latency;
+    }
+}
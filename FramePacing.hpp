@@ -0,0 +1,106 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace EggyEngine {
+
+	// Which present mode family we want. The chosen mode is always checked against
+	// what the surface reports, FIFO is the only mode the spec guarantees so it is the last fallback.
+	enum class PresentModePolicy {
+		DeviceDefault,	// Mailbox on discrete GPUs, relaxed FIFO on integrated ones
+		LowLatency,		// Immediate > Mailbox > FIFO
+		NoTearing,		// Mailbox > FIFO
+		AdaptiveVSync,	// Relaxed FIFO > FIFO
+		VSync			// FIFO
+	};
+
+	struct FramePacingSettings {
+
+		PresentModePolicy presentModePolicy = PresentModePolicy::DeviceDefault;
+
+		// 0 disables the frame limiter
+		double targetFrameRate = 0.0;
+
+		// Delay the start of the CPU frame so input is sampled as late as possible
+		bool lowLatencyMode = false;
+
+		// Extra room left before the deadline when the low latency mode predicts the frame start
+		double lowLatencySafetyMs = 1.0;
+
+		// Lower bound of the busy-wait window at the end of a limiter wait, it grows with the measured oversleep
+		double minSpinMs = 0.5;
+	};
+
+	struct LatencyStats {
+
+		double lastMs = 0.0;
+		double averageMs = 0.0;
+		double minMs = 0.0;
+		double maxMs = 0.0;
+
+		uint64_t samples = 0;
+	};
+
+	class FramePacer {
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		void configure(const FramePacingSettings& settings);
+		const FramePacingSettings& settings() const { return _settings; }
+
+		VkPresentModeKHR selectPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPhysicalDeviceType deviceType) const;
+
+		// Called before events are polled, sleeps for the limiter and the low latency delay. Returns the time waited in ms
+		double waitForFrameStart();
+
+		// Start of the CPU frame begun by the last waitForFrameStart
+		Clock::time_point frameStart() const { return _frameStart; }
+
+		// Called from input callbacks, the first input after the last consumed one starts the latency measurement
+		void markInput();
+
+		// Takes the pending input timestamp so it can travel with the frame that samples it
+		std::optional<Clock::time_point> consumeInput();
+
+		// Called right after vkQueuePresentKHR returns, possibly from the render thread
+		void markPresented(Clock::time_point frameStart, std::optional<Clock::time_point> inputTime);
+
+		LatencyStats latencyStats() const;
+
+		double averageFrameMs() const { return _avgFrameMs.load(std::memory_order_relaxed); }
+		double averageCpuFrameMs() const { return _avgCpuMs.load(std::memory_order_relaxed); }
+
+	private:
+
+		void preciseSleepUntil(Clock::time_point deadline);
+
+		double framePeriodMs() const;
+
+		FramePacingSettings _settings{};
+
+		// Owned by the thread that polls events
+		Clock::time_point _frameStart{};
+		Clock::time_point _nextDeadline{};
+
+		Clock::time_point _pendingInput{};
+		bool _hasPendingInput = false;
+
+		// Worst oversleep seen from the OS scheduler, decays slowly
+		double _sleepErrorMs = 1.0;
+
+		// Owned by the thread that presents
+		Clock::time_point _lastPresent{};
+
+		std::atomic<double> _avgFrameMs{ 0.0 };
+		std::atomic<double> _avgCpuMs{ 0.0 };
+
+		mutable std::mutex _latencyMutex;
+		LatencyStats _latency{};
+	};
+}
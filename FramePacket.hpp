@@ -0,0 +1,60 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+#include "FrameQueue.hpp"
+#include "Batch2D.hpp"
+#include "ClusteredLighting.hpp"
+
+#include <chrono>
+#include <optional>
+
+namespace EggyEngine {
+
+	// Fixed timestep simulation state, the main thread keeps the previous and current step to interpolate between
+	struct SimulationState {
+
+		double time = 0.0;
+	};
+
+	// Values of the SHADING_MODE specialization constant in meshShader.frag
+	enum class MeshShading : uint32_t {
+		Lit,
+		Normals,
+		TexCoords,
+		Count
+	};
+
+	// Everything the render thread needs to draw a frame, copied by value so the main thread
+	// can keep simulating while the packet is being recorded
+	struct SceneSnapshot {
+
+		VkClearColorValue clearColor = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+		// Simulation time interpolated to this frame, alpha is where it sits between the last two steps
+		double simulationTime = 0.0;
+		float interpolationAlpha = 0.0f;
+		float deltaTime = 0.0f;
+
+		MeshShading meshShading = MeshShading::Lit;
+	};
+
+	struct FramePacket {
+
+		uint64_t frameNumber = 0;
+
+		// When the CPU frame started and when the input it sampled arrived, used for latency stats
+		std::chrono::steady_clock::time_point frameStart{};
+		std::optional<std::chrono::steady_clock::time_point> inputTime{};
+
+		SceneSnapshot scene{};
+
+		// HUD and tool overlays, drawn over the scene in submission order
+		Batch2D overlay{};
+
+		// Dynamic point lights of this frame, binned into clusters on the GPU
+		std::vector<PointLight> lights{};
+	};
+
+	// Triple buffered: one packet being recorded by the render thread and two queued behind it
+	using FramePacketQueue = FrameQueue<FramePacket, FRAME_PACKET_QUEUE_DEPTH>;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace EggyEngine {
+
+	// Lock-free single producer / single consumer ring of frame packets.
+	// The producer never blocks, tryPush fails when the consumer is Capacity packets behind.
+	// The consumer can block in waitPop, which sleeps on an atomic wait instead of spinning.
+	// Items are swapped in and out of the slots, so with tryPushSwap the same few items circulate between producer,
+	// slots and consumer and their containers keep their capacity.
+	template <typename T, size_t Capacity>
+	class FrameQueue {
+
+		static_assert(Capacity >= 2, "A frame queue needs at least two slots to overlap producer and consumer");
+
+	public:
+
+		bool tryPush(const T& item) {
+
+			size_t write = _writeIndex.load(std::memory_order_relaxed);
+
+			if (write - _readIndex.load(std::memory_order_acquire) == Capacity)
+				return false;
+
+			_slots[write % Capacity] = item;
+			_writeIndex.store(write + 1, std::memory_order_release);
+
+			_signal.fetch_add(1, std::memory_order_release);
+			_signal.notify_one();
+
+			return true;
+		}
+
+		// Without a copy: on success item holds what the slot held before, an item the consumer is done with.
+		// On failure item is left as it was
+		bool tryPushSwap(T& item) {
+
+			size_t write = _writeIndex.load(std::memory_order_relaxed);
+
+			if (write - _readIndex.load(std::memory_order_acquire) == Capacity)
+				return false;
+
+			using std::swap;
+			swap(_slots[write % Capacity], item);
+
+			_writeIndex.store(write + 1, std::memory_order_release);
+
+			_signal.fetch_add(1, std::memory_order_release);
+			_signal.notify_one();
+
+			return true;
+		}
+
+		bool tryPop(T& item) {
+
+			size_t read = _readIndex.load(std::memory_order_relaxed);
+
+			if (read == _writeIndex.load(std::memory_order_acquire))
+				return false;
+
+			//The consumer's previous item goes back into the slot for the producer to reuse
+			using std::swap;
+			swap(item, _slots[read % Capacity]);
+
+			_readIndex.store(read + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		// Returns false once the queue is closed and drained
+		bool waitPop(T& item) {
+
+			while (true) {
+
+				uint32_t observed = _signal.load(std::memory_order_acquire);
+
+				if (tryPop(item))
+					return true;
+
+				if (_closed.load(std::memory_order_acquire))
+					return false;
+
+				_signal.wait(observed, std::memory_order_acquire);
+			}
+		}
+
+		void close() {
+
+			_closed.store(true, std::memory_order_release);
+
+			_signal.fetch_add(1, std::memory_order_release);
+			_signal.notify_all();
+		}
+
+		bool full() const { return _writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_acquire) == Capacity; }
+
+		size_t size() const { return _writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_acquire); }
+
+	private:
+
+		// Indices live on their own cache lines so producer and consumer don't false share
+		alignas(64) std::atomic<size_t> _writeIndex{ 0 };
+		alignas(64) std::atomic<size_t> _readIndex{ 0 };
+
+		alignas(64) std::atomic<uint32_t> _signal{ 0 };
+		std::atomic<bool> _closed{ false };
+
+		std::array<T, Capacity> _slots{};
+	};
+}
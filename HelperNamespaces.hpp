@@ -1,16 +1,9 @@
 #pragma once
 
-#define VK_USE_PLATFORM_WIN32_KHR
-#include <vulkan/vulkan.h>
-#include <vulkan/vulkan_win32.h>
-
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-#define GLFW_EXPOSE_NATIVE_WIN32
-#include <GLFW/glfw3native.h>
-
-#include <Windows.h>
+#include "Platform.hpp"
+#include "DebugSink.hpp"
 
+#include <cstring>
 #include <set>
 #include <map>
 #include <limits>
@@ -22,11 +15,11 @@
 #include <iostream>
 #include <stdexcept>
 
-#undef max
-#undef min
+// Frames the CPU may record ahead of the GPU
+constexpr auto MAX_FRAMES_IN_FLIGHT = 2;
 
-constexpr auto WIDTH = 800;
-constexpr auto HEIGHT = 600;
+// Packets the main thread may queue ahead of the render thread
+constexpr auto FRAME_PACKET_QUEUE_DEPTH = 2;
 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
@@ -66,13 +59,10 @@ namespace Debug {
         return true;
     }
 
-    static std::vector<const char*> getRequiredExtensions() {
+    // windowExtensions are the ones the window backend needs for its surface
+    static std::vector<const char*> getRequiredExtensions(std::vector<const char*> windowExtensions) {
 
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        std::vector<const char*> extensions = std::move(windowExtensions);
 
         if (enableValidationLayers)
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -90,20 +80,15 @@ namespace Debug {
             return VK_ERROR_EXTENSION_NOT_PRESENT;
     }
 
-    static VKAPI_ATTR VkBool32 VKAPI_CALL getDebugCallback( VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData ) {
-
-        std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-
-        return VK_FALSE;
-    }
-
-    static void populateDebugMessengerCreateInfo( VkDebugUtilsMessengerCreateInfoEXT& debugCreateInfo ) {
+    // Every severity reaches the sink, its filter decides at runtime what gets through
+    static void populateDebugMessengerCreateInfo( VkDebugUtilsMessengerCreateInfoEXT& debugCreateInfo, DebugSink* sink ) {
         
         debugCreateInfo = {};
         debugCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-        debugCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        debugCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
         debugCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-        debugCreateInfo.pfnUserCallback = getDebugCallback;
+        debugCreateInfo.pfnUserCallback = DebugSink::messengerCallback;
+        debugCreateInfo.pUserData = sink;
     }
 
     static void destroyDebugUtilsMessengerEXT( VkInstance instance, const VkAllocationCallbacks* pAllocator ) {
@@ -116,31 +101,13 @@ namespace Debug {
 
     static void errorWindow(const wchar_t* errorMessage) {
 
-        MessageBox(NULL, errorMessage, L"Error", MB_OK | MB_ICONERROR);
-        throw std::runtime_error("");
-    }
-}
-
-namespace Loader {
-    
-    static std::vector<char> readShaderFile(const std::string& filename) {
-
-        // ate: Start reading at the end of the file
-
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> Shaderbuffer(fileSize);
+        Platform::showError(errorMessage);
 
-        file.seekg(0);
-        file.read(Shaderbuffer.data(), fileSize);
+        std::string message;
 
-        file.close();
+        for (const wchar_t* c = errorMessage; *c; c++)
+            message += (*c < 0x80) ? static_cast<char>(*c) : '?';
 
-        return Shaderbuffer;
+        throw std::runtime_error(message);
     }
 }
\ No newline at end of file
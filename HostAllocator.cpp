@@ -0,0 +1,224 @@
+#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace EggyEngine {
+
+    // Sits right in front of every pointer handed to the driver, pfnFree gets nothing but the pointer
+    struct AllocationHeader {
+
+        // Start of the heap allocation or pool block
+        void* base;
+
+        // As asked for by the driver
+        uint64_t size;
+
+        uint32_t scope;
+        uint32_t poolClass;
+    };
+
+    HostAllocator::~HostAllocator() {
+
+        for (auto& poolClass : _pool)
+            for (void* slab : poolClass.slabs)
+                std::free(slab);
+    }
+
+    HostAllocatorStats HostAllocator::stats() const {
+
+        HostAllocatorStats stats{};
+
+        for (uint32_t i = 0; i < HOST_ALLOCATION_SCOPE_COUNT; i++)
+            stats.scopes[i] = {
+                .bytes = _scopes[i].bytes.load(std::memory_order_relaxed),
+                .peakBytes = _scopes[i].peakBytes.load(std::memory_order_relaxed),
+                .liveAllocations = _scopes[i].liveAllocations.load(std::memory_order_relaxed),
+                .allocations = _scopes[i].allocations.load(std::memory_order_relaxed),
+                .internalBytes = _scopes[i].internalBytes.load(std::memory_order_relaxed)
+            };
+
+        stats.pooledAllocations = _pooledAllocations.load(std::memory_order_relaxed);
+        stats.pooledFallbacks = _pooledFallbacks.load(std::memory_order_relaxed);
+        stats.poolSlabBytes = _poolSlabBytes.load(std::memory_order_relaxed);
+
+        return stats;
+    }
+
+    void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+        if (size == 0)
+            return nullptr;
+
+        //Alignment is a power of two, the header needs its own alignment too
+        alignment = std::max(alignment, alignof(AllocationHeader));
+
+        size_t total = size + sizeof(AllocationHeader) + alignment - 1;
+
+        void* base = nullptr;
+        uint32_t poolClass = NO_POOL;
+
+        if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && _settings.poolCommandScope) {
+
+            for (uint32_t i = 0; i < POOL_CLASS_COUNT; i++)
+                if (total <= POOL_MIN_BLOCK << i) {
+                    poolClass = i;
+                    break;
+                }
+
+            if (poolClass != NO_POOL) {
+
+                base = allocatePooled(poolClass);
+
+                //A failed slab allocation returns nullptr below, it isn't counted
+                if (base != nullptr)
+                    _pooledAllocations.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+                _pooledFallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (poolClass == NO_POOL)
+            base = std::malloc(total);
+
+        if (base == nullptr)
+            return nullptr;
+
+        uintptr_t memory = (reinterpret_cast<uintptr_t>(base) + sizeof(AllocationHeader) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+
+        AllocationHeader* header = reinterpret_cast<AllocationHeader*>(memory) - 1;
+
+        header->base = base;
+        header->size = size;
+        header->scope = static_cast<uint32_t>(scope);
+        header->poolClass = poolClass;
+
+        track(header->scope, static_cast<int64_t>(size));
+
+        return reinterpret_cast<void*>(memory);
+    }
+
+    void* HostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+        if (original == nullptr)
+            return allocate(size, alignment, scope);
+
+        if (size == 0) {
+            free(original);
+            return nullptr;
+        }
+
+        //Always moves, the driver rarely reallocates and growing in place would need the heap's own realloc
+        void* memory = allocate(size, alignment, scope);
+
+        //On failure the original stays valid, as the spec asks
+        if (memory == nullptr)
+            return nullptr;
+
+        const AllocationHeader* header = static_cast<const AllocationHeader*>(original) - 1;
+
+        std::memcpy(memory, original, std::min<size_t>(header->size, size));
+        free(original);
+
+        return memory;
+    }
+
+    void HostAllocator::free(void* memory) {
+
+        if (memory == nullptr)
+            return;
+
+        const AllocationHeader* header = static_cast<const AllocationHeader*>(memory) - 1;
+
+        track(header->scope, -static_cast<int64_t>(header->size));
+
+        if (header->poolClass != NO_POOL)
+            freePooled(header->poolClass, header->base);
+        else
+            std::free(header->base);
+    }
+
+    void* HostAllocator::allocatePooled(uint32_t poolClass) {
+
+        auto& pool = _pool[poolClass];
+
+        std::lock_guard lock(pool.mutex);
+
+        if (pool.freeBlocks.empty()) {
+
+            uint8_t* slab = static_cast<uint8_t*>(std::malloc(POOL_SLAB_SIZE));
+
+            if (slab == nullptr)
+                return nullptr;
+
+            pool.slabs.push_back(slab);
+            _poolSlabBytes.fetch_add(POOL_SLAB_SIZE, std::memory_order_relaxed);
+
+            size_t blockSize = POOL_MIN_BLOCK << poolClass;
+
+            for (size_t offset = 0; offset + blockSize <= POOL_SLAB_SIZE; offset += blockSize)
+                pool.freeBlocks.push_back(slab + offset);
+        }
+
+        void* block = pool.freeBlocks.back();
+        pool.freeBlocks.pop_back();
+
+        return block;
+    }
+
+    void HostAllocator::freePooled(uint32_t poolClass, void* block) {
+
+        auto& pool = _pool[poolClass];
+
+        std::lock_guard lock(pool.mutex);
+        pool.freeBlocks.push_back(block);
+    }
+
+    void HostAllocator::track(uint32_t scope, int64_t bytes) {
+
+        auto& counters = _scopes[std::min(scope, HOST_ALLOCATION_SCOPE_COUNT - 1)];
+
+        if (bytes < 0) {
+            counters.bytes.fetch_sub(static_cast<uint64_t>(-bytes), std::memory_order_relaxed);
+            counters.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+
+        uint64_t current = counters.bytes.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed) + bytes;
+
+        counters.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+
+        while (current > peak && !counters.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+    }
+
+    void* VKAPI_CALL HostAllocator::allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+        return static_cast<HostAllocator*>(userData)->allocate(size, alignment, scope);
+    }
+
+    void* VKAPI_CALL HostAllocator::reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+
+        return static_cast<HostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+    }
+
+    void VKAPI_CALL HostAllocator::freeCallback(void* userData, void* memory) {
+
+        static_cast<HostAllocator*>(userData)->free(memory);
+    }
+
+    void VKAPI_CALL HostAllocator::internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+
+        auto& counters = static_cast<HostAllocator*>(userData)->_scopes[std::min<uint32_t>(scope, HOST_ALLOCATION_SCOPE_COUNT - 1)];
+        counters.internalBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void VKAPI_CALL HostAllocator::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+
+        auto& counters = static_cast<HostAllocator*>(userData)->_scopes[std::min<uint32_t>(scope, HOST_ALLOCATION_SCOPE_COUNT - 1)];
+        counters.internalBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace EggyEngine {
+
+	struct HostAllocatorSettings {
+
+		// Off hands nullptr to Vulkan, the driver then uses its own heap
+		bool enabled = true;
+
+		// COMMAND scope allocations only live for one Vulkan call and come in a few small sizes, they are served from
+		// free lists of fixed size blocks instead of the heap
+		bool poolCommandScope = true;
+	};
+
+	// VkSystemAllocationScope values, COMMAND to INSTANCE
+	constexpr uint32_t HOST_ALLOCATION_SCOPE_COUNT = 5;
+
+	struct HostScopeStats {
+
+		// Bytes as asked for by the driver, without headers or alignment padding
+		uint64_t bytes = 0;
+		uint64_t peakBytes = 0;
+
+		uint64_t liveAllocations = 0;
+
+		// Every allocation and reallocation since start
+		uint64_t allocations = 0;
+
+		// Driver allocations that didn't go through the callbacks, executable memory for shaders. Reported only
+		uint64_t internalBytes = 0;
+	};
+
+	struct HostAllocatorStats {
+
+		HostScopeStats scopes[HOST_ALLOCATION_SCOPE_COUNT] = {};
+
+		// COMMAND scope requests served from a free list and the ones too big or too aligned that fell back to the heap
+		uint64_t pooledAllocations = 0;
+		uint64_t pooledFallbacks = 0;
+
+		// Slabs carved into blocks so far, they are only returned when the allocator goes away
+		uint64_t poolSlabBytes = 0;
+	};
+
+	// Engine VkAllocationCallbacks. Every call may come from any thread: the counters are atomics and each block size
+	// of the pool has its own lock. Has to outlive every Vulkan object created with it
+	class HostAllocator {
+	public:
+
+		HostAllocator() = default;
+		~HostAllocator();
+
+		HostAllocator(const HostAllocator&) = delete;
+		HostAllocator& operator=(const HostAllocator&) = delete;
+
+		void configure(const HostAllocatorSettings& settings) { _settings = settings; }
+
+		// nullptr while disabled, what every vkCreate and vkDestroy gets as pAllocator
+		const VkAllocationCallbacks* callbacks() const { return _settings.enabled ? &_callbacks : nullptr; }
+
+		HostAllocatorStats stats() const;
+
+	private:
+
+		// Blocks of 64 to 4096 bytes, alignment and the header come out of the block
+		static constexpr uint32_t POOL_CLASS_COUNT = 7;
+		static constexpr size_t POOL_MIN_BLOCK = 64;
+		static constexpr size_t POOL_SLAB_SIZE = 64 * 1024;
+
+		// Non pooled allocations
+		static constexpr uint32_t NO_POOL = ~0u;
+
+		struct ScopeCounters {
+
+			std::atomic<uint64_t> bytes{ 0 };
+			std::atomic<uint64_t> peakBytes{ 0 };
+			std::atomic<uint64_t> liveAllocations{ 0 };
+			std::atomic<uint64_t> allocations{ 0 };
+			std::atomic<uint64_t> internalBytes{ 0 };
+		};
+
+		struct PoolClass {
+
+			std::mutex mutex;
+			std::vector<void*> freeBlocks;
+			std::vector<void*> slabs;
+		};
+
+		void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void free(void* memory);
+
+		void* allocatePooled(uint32_t poolClass);
+		void freePooled(uint32_t poolClass, void* block);
+
+		void track(uint32_t scope, int64_t bytes);
+
+		static void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static void VKAPI_CALL freeCallback(void* userData, void* memory);
+		static void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+		HostAllocatorSettings _settings{};
+
+		const VkAllocationCallbacks _callbacks{
+			.pUserData = this,
+			.pfnAllocation = allocationCallback,
+			.pfnReallocation = reallocationCallback,
+			.pfnFree = freeCallback,
+			.pfnInternalAllocation = internalAllocationCallback,
+			.pfnInternalFree = internalFreeCallback
+		};
+
+		ScopeCounters _scopes[HOST_ALLOCATION_SCOPE_COUNT];
+
+		PoolClass _pool[POOL_CLASS_COUNT];
+
+		std::atomic<uint64_t> _pooledAllocations{ 0 };
+		std::atomic<uint64_t> _pooledFallbacks{ 0 };
+		std::atomic<uint64_t> _poolSlabBytes{ 0 };
+	};
+}
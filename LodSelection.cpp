@@ -0,0 +1,66 @@
+#include "LodSelection.hpp"
+
+#include <cmath>
+
+namespace EggyEngine {
+
+    float LodSelector::projectionScale(float viewportHeight, float fovY) {
+
+        return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+    }
+
+    void LodSelector::beginFrame(size_t instanceCount) {
+
+        if (_currentLods.size() != instanceCount)
+            _currentLods.assign(instanceCount, 0);
+
+        _stats = {};
+        _stats.instances = static_cast<uint32_t>(instanceCount);
+    }
+
+    uint32_t LodSelector::select(uint32_t instance, std::span<const Loader::MeshPackLod> lods, float distance, float projectionScale) {
+
+        if (lods.empty())
+            return 0;
+
+        uint32_t lastLod = static_cast<uint32_t>(lods.size() - 1);
+
+        //Inside the bounding sphere everything is full detail
+        float pixelsPerUnit = projectionScale / std::max(distance, 1e-4f);
+
+        auto fits = [&](uint32_t lod, float limit) { return lods[lod].error * pixelsPerUnit <= limit; };
+
+        uint32_t current = std::min(_currentLods[instance], lastLod);
+
+        //Errors only grow along the chain, the coarsest level that fits is the one we want
+        uint32_t ideal = 0;
+
+        while (ideal < lastLod && fits(ideal + 1, _settings.maxScreenError))
+            ideal++;
+
+        uint32_t lod = ideal;
+
+        if (ideal > current) {
+
+            float strictLimit = _settings.maxScreenError * (1.0f - _settings.hysteresis);
+
+            lod = current;
+
+            while (lod < ideal && fits(lod + 1, strictLimit))
+                lod++;
+        }
+
+        if (lod != current)
+            _stats.lodSwitches++;
+
+        _currentLods[instance] = lod;
+
+        lod = static_cast<uint32_t>(std::clamp(static_cast<int32_t>(lod) + _settings.lodBias, 0, static_cast<int32_t>(lastLod)));
+
+        _stats.lodHistogram[lod]++;
+        _stats.trianglesDrawn += lods[lod].indexCount / 3;
+        _stats.trianglesFullDetail += lods[0].indexCount / 3;
+
+        return lod;
+    }
+}
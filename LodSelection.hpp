@@ -0,0 +1,61 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+#include "MeshPack.hpp"
+
+#include <span>
+
+namespace EggyEngine {
+
+	struct LodSelectionSettings {
+
+		// Largest error a level may show on screen, in pixels
+		float maxScreenError = 1.0f;
+
+		// Going coarser needs the error to be this much below the limit, so an object sitting right at
+		// the threshold doesn't flip between two levels every frame. Going finer is always immediate.
+		float hysteresis = 0.25f;
+
+		// Added to the selected level, positive trades quality for vertex throughput
+		int32_t lodBias = 0;
+	};
+
+	struct LodSelectionStats {
+
+		uint32_t instances = 0;
+		uint32_t lodSwitches = 0;
+
+		uint64_t trianglesDrawn = 0;
+		uint64_t trianglesFullDetail = 0;
+
+		uint32_t lodHistogram[Loader::MESH_PACK_MAX_LODS] = {};
+	};
+
+	// Picks a level per instance from the projected screen space error of its LOD chain.
+	// Keeps the level every instance used last frame, so it is owned by whoever records the draws.
+	class LodSelector {
+	public:
+
+		void configure(const LodSelectionSettings& settings) { _settings = settings; }
+		const LodSelectionSettings& settings() const { return _settings; }
+
+		// Pixels per unit of object space error at distance 1: viewportHeight / (2 * tan(fovY / 2))
+		static float projectionScale(float viewportHeight, float fovY);
+
+		// Call once per frame before select, drops the history when the instance count changes
+		void beginFrame(size_t instanceCount);
+
+		// lods is the chain of one mesh, distance is from the camera to the closest point of the bounding sphere
+		uint32_t select(uint32_t instance, std::span<const Loader::MeshPackLod> lods, float distance, float projectionScale);
+
+		const LodSelectionStats& stats() const { return _stats; }
+
+	private:
+
+		LodSelectionSettings _settings{};
+
+		std::vector<uint32_t> _currentLods;
+
+		LodSelectionStats _stats{};
+	};
+}
@@ -0,0 +1,111 @@
+#include "LoopScheduler.hpp"
+
+namespace EggyEngine {
+
+    using Seconds = std::chrono::duration<double>;
+
+    LoopState LoopScheduler::queryState(const Platform::Window& window) const {
+
+        if (window.minimized() || !window.visible())
+            return LoopState::Idle;
+
+        //A zero sized framebuffer means there is nothing to present to (occluded on some compositors)
+        int width, height;
+        window.framebufferSize(width, height);
+
+        if (width == 0 || height == 0)
+            return LoopState::Idle;
+
+        if (!window.focused() && _settings.backgroundFrameRate > 0.0)
+            return LoopState::Background;
+
+        return LoopState::Active;
+    }
+
+    void LoopScheduler::waitEvents(Platform::Window& window, double timeout) {
+
+        auto start = Clock::now();
+
+        window.waitEvents(timeout);
+
+        _waitedSeconds += Seconds(Clock::now() - start).count();
+    }
+
+    bool LoopScheduler::pumpEvents(Platform::Window& window) {
+
+        updateReport();
+
+        if (_settings.mode == LoopSchedulingMode::Continuous) {
+
+            window.pollEvents();
+
+            //if window is minized, we skip frame
+            _state = window.minimized() ? LoopState::Idle : LoopState::Active;
+
+            return _state == LoopState::Active;
+        }
+
+        _state = queryState(window);
+
+        if (_state == LoopState::Idle) {
+
+            //Block until something happens to the window, the timeout only bounds how stale the stats get
+            waitEvents(window, _settings.idleWaitTimeout);
+            _report.idleWakeups++;
+
+            _state = queryState(window);
+            return false;
+        }
+
+        if (_state == LoopState::Active) {
+
+            window.pollEvents();
+            return true;
+        }
+
+        //Background: keep handling events while waiting for the next throttled frame, focusing the window ends the wait
+        auto deadline = _lastFrame + std::chrono::duration_cast<Clock::duration>(Seconds(1.0 / _settings.backgroundFrameRate));
+
+        window.pollEvents();
+
+        while (!window.shouldClose()) {
+
+            double remaining = Seconds(deadline - Clock::now()).count();
+
+            if (remaining <= 0.0)
+                break;
+
+            waitEvents(window, remaining);
+
+            _state = queryState(window);
+
+            if (_state != LoopState::Background)
+                break;
+        }
+
+        return _state != LoopState::Idle;
+    }
+
+    void LoopScheduler::markFrameDrawn() {
+
+        _lastFrame = Clock::now();
+        _framesInWindow++;
+    }
+
+    void LoopScheduler::updateReport() {
+
+        auto now = Clock::now();
+        double elapsed = Seconds(now - _windowStart).count();
+
+        if (elapsed < _settings.reportInterval)
+            return;
+
+        _report.utilization = std::clamp(1.0 - _waitedSeconds / elapsed, 0.0, 1.0);
+        _report.framesPerSecond = _framesInWindow / elapsed;
+        _report.state = _state;
+
+        _windowStart = now;
+        _waitedSeconds = 0.0;
+        _framesInWindow = 0;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <chrono>
+
+namespace EggyEngine {
+
+	enum class LoopSchedulingMode {
+		Continuous,	// Poll and draw as fast as possible, skip drawing while minimized
+		IdleAware	// Block while minimized/occluded, throttle while unfocused
+	};
+
+	enum class LoopState {
+		Active,		// Focused and visible, full rate
+		Background,	// Visible but unfocused, throttled to backgroundFrameRate
+		Idle		// Minimized, hidden or zero sized, nothing is drawn
+	};
+
+	struct LoopSchedulingSettings {
+
+		LoopSchedulingMode mode = LoopSchedulingMode::IdleAware;
+
+		// 0 keeps drawing unfocused windows at full rate
+		double backgroundFrameRate = 15.0;
+
+		// Upper bound of a single blocking wait while idle, events wake it earlier
+		double idleWaitTimeout = 0.5;
+
+		// Length of the window the utilization is averaged over
+		double reportInterval = 1.0;
+	};
+
+	struct LoopUtilization {
+
+		// Fraction of wall time the loop thread was not blocked waiting, 0..1
+		double utilization = 0.0;
+
+		double framesPerSecond = 0.0;
+
+		LoopState state = LoopState::Active;
+
+		uint64_t idleWakeups = 0;
+	};
+
+	class LoopScheduler {
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		void configure(const LoopSchedulingSettings& settings) { _settings = settings; }
+		const LoopSchedulingSettings& settings() const { return _settings; }
+
+		// Polls or waits for window events depending on the window state, returns whether a frame should be drawn
+		bool pumpEvents(Platform::Window& window);
+
+		void markFrameDrawn();
+
+		// Time spent blocked outside the scheduler (e.g. the frame limiter sleeping)
+		void addWaitTime(double seconds) { _waitedSeconds += seconds; }
+
+		LoopState state() const { return _state; }
+
+		LoopUtilization utilization() const { return _report; }
+
+	private:
+
+		LoopState queryState(const Platform::Window& window) const;
+
+		void waitEvents(Platform::Window& window, double timeout);
+
+		void updateReport();
+
+		LoopSchedulingSettings _settings{};
+
+		LoopState _state = LoopState::Active;
+
+		Clock::time_point _lastFrame{};
+		Clock::time_point _windowStart = Clock::now();
+
+		double _waitedSeconds = 0.0;
+		uint64_t _framesInWindow = 0;
+
+		LoopUtilization _report{};
+	};
+}
@@ -0,0 +1,147 @@
+#include "MemoryBudget.hpp"
+
+namespace EggyEngine {
+
+    //Without the extension there's no way to know what else lives on the heap, assume we can have most of it
+    constexpr double FALLBACK_BUDGET_SHARE = 0.8;
+
+    void MemoryTracker::init(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtension) {
+
+        std::lock_guard lock(_mutex);
+
+        _physicalDevice = physicalDevice;
+
+        vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+        if (budgetExtension)
+            _getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2");
+
+        _stats = MemoryStats{};
+        _stats.budgetExtension = _getMemoryProperties2 != nullptr;
+        _stats.heapCount = _memoryProperties.memoryHeapCount;
+
+        for (uint32_t i = 0; i < _stats.heapCount; i++) {
+
+            _stats.heaps[i].size = _memoryProperties.memoryHeaps[i].size;
+            _stats.heaps[i].deviceLocal = _memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        }
+    }
+
+    void MemoryTracker::trackAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category) {
+
+        std::lock_guard lock(_mutex);
+
+        uint32_t heapIndex = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+        _allocations[memory] = { heapIndex, size, category };
+
+        _stats.heaps[heapIndex].engineUsage += size;
+        _stats.categoryBytes[static_cast<size_t>(category)] += size;
+        _stats.allocationCount++;
+    }
+
+    void MemoryTracker::trackFree(VkDeviceMemory memory) {
+
+        std::lock_guard lock(_mutex);
+
+        auto allocation = _allocations.find(memory);
+
+        if (allocation == _allocations.end())
+            return;
+
+        _stats.heaps[allocation->second.heapIndex].engineUsage -= allocation->second.size;
+        _stats.categoryBytes[static_cast<size_t>(allocation->second.category)] -= allocation->second.size;
+        _stats.allocationCount--;
+
+        _allocations.erase(allocation);
+    }
+
+    void MemoryTracker::addPressureCallback(MemoryPressureCallback callback) {
+
+        std::lock_guard lock(_mutex);
+        _callbacks.push_back(std::move(callback));
+    }
+
+    void MemoryTracker::update() {
+
+        if (++_framesSinceUpdate < _settings.updateInterval)
+            return;
+
+        refresh();
+    }
+
+    void MemoryTracker::refresh() {
+
+        _framesSinceUpdate = 0;
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties.pNext = &budgetProperties;
+
+        //The query happens outside the lock, it can take a while on some drivers
+        if (_getMemoryProperties2)
+            _getMemoryProperties2(_physicalDevice, &memoryProperties);
+
+        std::vector<std::pair<uint32_t, MemoryHeapBudget>> changed;
+        std::vector<MemoryPressureCallback> callbacks;
+
+        {
+            std::lock_guard lock(_mutex);
+
+            for (uint32_t i = 0; i < _stats.heapCount; i++) {
+
+                MemoryHeapBudget& heap = _stats.heaps[i];
+
+                if (_getMemoryProperties2) {
+                    heap.budget = budgetProperties.heapBudget[i];
+                    heap.usage = budgetProperties.heapUsage[i];
+                }
+                else {
+                    heap.budget = static_cast<VkDeviceSize>(heap.size * FALLBACK_BUDGET_SHARE);
+                    heap.usage = heap.engineUsage;
+                }
+
+                double ratio = heap.budget ? double(heap.usage) / double(heap.budget) : 0.0;
+
+                MemoryPressure pressure = MemoryPressure::Normal;
+
+                if (ratio >= _settings.criticalThreshold)
+                    pressure = MemoryPressure::Critical;
+                else if (ratio >= _settings.warningThreshold)
+                    pressure = MemoryPressure::Warning;
+
+                //Going up is immediate, going down needs to clear the threshold by the hysteresis
+                if (pressure < heap.pressure) {
+
+                    if (heap.pressure == MemoryPressure::Critical && ratio > _settings.criticalThreshold - _settings.hysteresis)
+                        pressure = MemoryPressure::Critical;
+                    else if (ratio > _settings.warningThreshold - _settings.hysteresis)
+                        pressure = MemoryPressure::Warning;
+                }
+
+                if (pressure == heap.pressure)
+                    continue;
+
+                heap.pressure = pressure;
+                changed.emplace_back(i, heap);
+            }
+
+            if (!changed.empty())
+                callbacks = _callbacks;
+        }
+
+        //Callbacks may free memory or read the stats, so they run without the lock
+        for (const auto& [heapIndex, heap] : changed)
+            for (const auto& callback : callbacks)
+                callback(heapIndex, heap);
+    }
+
+    MemoryStats MemoryTracker::stats() const {
+
+        std::lock_guard lock(_mutex);
+        return _stats;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace EggyEngine {
+
+	enum class MemoryCategory : uint32_t {
+		Buffer,
+		Image,
+		Staging,
+		Pipeline,
+		Count
+	};
+
+	enum class MemoryPressure : uint32_t {
+		Normal,
+		Warning,
+		Critical
+	};
+
+	struct MemoryBudgetSettings {
+
+		// Fractions of the heap budget, crossing one fires the pressure callbacks
+		float warningThreshold = 0.80f;
+		float criticalThreshold = 0.95f;
+
+		// Usage has to drop this much below a threshold before the level goes back down
+		float hysteresis = 0.05f;
+
+		// Frames between budget queries, the query goes to the driver
+		uint32_t updateInterval = 30;
+	};
+
+	struct MemoryHeapBudget {
+
+		VkDeviceSize size = 0;
+
+		// From VK_EXT_memory_budget when available: what the process may use and what it uses, other
+		// allocations of the process included. Without it budget is a fixed share of the heap and usage is ours
+		VkDeviceSize budget = 0;
+		VkDeviceSize usage = 0;
+
+		// Allocated through the engine
+		VkDeviceSize engineUsage = 0;
+
+		bool deviceLocal = false;
+
+		MemoryPressure pressure = MemoryPressure::Normal;
+	};
+
+	struct MemoryStats {
+
+		bool budgetExtension = false;
+
+		uint32_t heapCount = 0;
+		MemoryHeapBudget heaps[VK_MAX_MEMORY_HEAPS] = {};
+
+		VkDeviceSize categoryBytes[static_cast<size_t>(MemoryCategory::Count)] = {};
+		uint32_t allocationCount = 0;
+	};
+
+	// Called from the render thread when a heap changes pressure level
+	using MemoryPressureCallback = std::function<void(uint32_t heapIndex, const MemoryHeapBudget& heap)>;
+
+	// Keeps count of every device allocation made by the engine and polls the heap budgets, so streaming
+	// can evict before the driver starts paging. Safe to read from any thread.
+	class MemoryTracker {
+	public:
+
+		void configure(const MemoryBudgetSettings& settings) { _settings = settings; }
+
+		// budgetExtension is whether VK_EXT_memory_budget was enabled on the device
+		void init(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtension);
+
+		void trackAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category);
+		void trackFree(VkDeviceMemory memory);
+
+		void addPressureCallback(MemoryPressureCallback callback);
+
+		// Call once per frame, queries the budgets every updateInterval frames
+		void update();
+
+		// Queries the budgets now and fires the callbacks
+		void refresh();
+
+		MemoryStats stats() const;
+
+	private:
+
+		struct Allocation {
+			uint32_t heapIndex;
+			VkDeviceSize size;
+			MemoryCategory category;
+		};
+
+		MemoryBudgetSettings _settings{};
+
+		VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+		PFN_vkGetPhysicalDeviceMemoryProperties2 _getMemoryProperties2 = nullptr;
+
+		VkPhysicalDeviceMemoryProperties _memoryProperties{};
+
+		MemoryStats _stats{};
+		std::unordered_map<VkDeviceMemory, Allocation> _allocations;
+
+		std::vector<MemoryPressureCallback> _callbacks;
+
+		uint32_t _framesSinceUpdate = 0;
+
+		mutable std::mutex _mutex;
+	};
+}
@@ -0,0 +1,179 @@
+#include "MeshPack.hpp"
+#include "MeshImport.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+// Offline tool: MeshConverter <input.obj|.gltf|.glb> <output.emp>
+// Does all the parsing, optimization and quantization once so the engine only has to map the pack and upload it
+
+struct PackedVertex {
+
+    uint16_t position[4];
+    int16_t normal[2];
+    uint32_t texCoord;
+};
+
+static_assert(sizeof(PackedVertex) == 16, "packed vertex should stay 16 bytes");
+
+struct ConverterStats {
+
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    size_t lodCount = 0;
+
+    // Triangle weighted sums, divided by triangleCount for the report
+    double acmrBefore = 0.0;
+    double acmrAfter = 0.0;
+};
+
+// 16 bytes per vertex instead of 32: positions relative to the mesh bounds, octahedral normals and half float UVs
+static Loader::MeshPackLayout packLayout() {
+
+    Loader::MeshPackLayout layout{};
+    layout.flags = Loader::MESH_PACK_FLAG_QUANTIZED_POSITIONS;
+    layout.vertexStride = sizeof(PackedVertex);
+    layout.attributes = {
+        { Loader::VertexSemantic::Position, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position), 0 },
+        { Loader::VertexSemantic::Normal, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal), 1 },
+        { Loader::VertexSemantic::TexCoord, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, texCoord), 2 }
+    };
+
+    return layout;
+}
+
+static Loader::MeshPackSourceMesh buildPackMesh(Loader::MeshSource source, ConverterStats& stats) {
+
+    Loader::MeshPackSourceMesh mesh{};
+    mesh.name = source.name;
+
+    stats.acmrBefore += Loader::analyzeVertexCache(source.indices, source.vertexCount()).acmr * (source.indices.size() / 3);
+
+    for (int axis = 0; axis < 3; axis++) {
+        mesh.boundsMin[axis] = std::numeric_limits<float>::max();
+        mesh.boundsMax[axis] = -std::numeric_limits<float>::max();
+    }
+
+    for (uint32_t v : source.indices)
+        for (int axis = 0; axis < 3; axis++) {
+            mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], source.positions[v * 3 + axis]);
+            mesh.boundsMax[axis] = std::max(mesh.boundsMax[axis], source.positions[v * 3 + axis]);
+        }
+
+    //Sphere around the box center, loose but good enough for culling and LOD distance
+    for (int axis = 0; axis < 3; axis++)
+        mesh.sphereCenter[axis] = (mesh.boundsMin[axis] + mesh.boundsMax[axis]) * 0.5f;
+
+    float radiusSquared = 0.0f;
+
+    for (uint32_t v : source.indices) {
+
+        float dx = source.positions[v * 3] - mesh.sphereCenter[0];
+        float dy = source.positions[v * 3 + 1] - mesh.sphereCenter[1];
+        float dz = source.positions[v * 3 + 2] - mesh.sphereCenter[2];
+
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+
+    mesh.sphereRadius = std::sqrt(radiusSquared);
+
+    //LODs only collapse onto existing vertices, so all levels share the vertex data of LOD 0
+    Loader::LodChainSettings lodSettings{};
+    lodSettings.maxLevels = Loader::MESH_PACK_MAX_LODS;
+
+    Loader::generateLodChain(source.indices, source.positions, mesh.sphereRadius, lodSettings, mesh.lodIndices, mesh.lodErrors);
+
+    //Cache order first, then overdraw clusters on top of it (LOD 0 only, the far levels are tiny on screen)
+    for (size_t lod = 0; lod < mesh.lodIndices.size(); lod++) {
+
+        Loader::optimizeVertexCache(mesh.lodIndices[lod], source.vertexCount());
+
+        if (lod == 0)
+            Loader::optimizeOverdraw(mesh.lodIndices[lod], source.positions);
+    }
+
+    //Then vertices renumbered in the order LOD 0 fetches them, every level is remapped with the same table
+    std::vector<uint32_t> allIndices;
+
+    for (const auto& indices : mesh.lodIndices)
+        allIndices.insert(allIndices.end(), indices.begin(), indices.end());
+
+    std::vector<uint32_t> remap = Loader::optimizeVertexFetch(allIndices, source.vertexCount());
+
+    size_t cursor = 0;
+
+    for (auto& indices : mesh.lodIndices) {
+
+        std::copy(allIndices.begin() + cursor, allIndices.begin() + cursor + indices.size(), indices.begin());
+        cursor += indices.size();
+    }
+
+    stats.acmrAfter += Loader::analyzeVertexCache(mesh.lodIndices[0], remap.size()).acmr * (source.indices.size() / 3);
+
+    mesh.vertexCount = static_cast<uint32_t>(remap.size());
+    mesh.vertices.resize(remap.size() * sizeof(PackedVertex));
+
+    for (size_t i = 0; i < remap.size(); i++) {
+
+        uint32_t v = remap[i];
+        PackedVertex vertex{};
+
+        for (int axis = 0; axis < 3; axis++) {
+
+            float extent = mesh.boundsMax[axis] - mesh.boundsMin[axis];
+            vertex.position[axis] = Loader::quantizeUnorm16(extent > 0.0f ? (source.positions[v * 3 + axis] - mesh.boundsMin[axis]) / extent : 0.0f);
+        }
+
+        //w decodes to 1.0 so the shader can use the position as is
+        vertex.position[3] = 65535;
+
+        Loader::encodeOctahedral(&source.normals[v * 3], vertex.normal);
+
+        vertex.texCoord = source.texCoords.empty() ? 0u : Loader::packHalf2(source.texCoords[v * 2], source.texCoords[v * 2 + 1]);
+
+        std::memcpy(mesh.vertices.data() + i * sizeof(PackedVertex), &vertex, sizeof(PackedVertex));
+    }
+
+    stats.vertexCount += remap.size();
+    stats.triangleCount += source.indices.size() / 3;
+    stats.lodCount += mesh.lodIndices.size();
+
+    return mesh;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 3) {
+        std::cerr << "usage: MeshConverter <input.obj|.gltf|.glb> <output.emp>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+
+        std::vector<Loader::MeshSource> sources = Loader::importMesh(argv[1]);
+
+        if (sources.empty())
+            throw std::runtime_error("no triangle meshes found!");
+
+        std::vector<Loader::MeshPackSourceMesh> meshes;
+        ConverterStats stats{};
+
+        for (auto& source : sources)
+            meshes.push_back(buildPackMesh(std::move(source), stats));
+
+        Loader::writeMeshPack(argv[2], packLayout(), meshes);
+
+        std::cout << argv[2] << ": " << meshes.size() << " meshes, " << stats.vertexCount << " vertices, " << stats.triangleCount << " triangles" << std::endl;
+        std::cout << stats.lodCount << " LOD levels" << std::endl;
+        std::cout << "ACMR " << stats.acmrBefore / stats.triangleCount << " -> " << stats.acmrAfter / stats.triangleCount << std::endl;
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,747 @@
+#include "MeshImport.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <variant>
+#include <memory>
+
+namespace Loader {
+
+    static std::string fileExtension(const std::string& filename) {
+
+        auto dot = filename.find_last_of('.');
+
+        if (dot == std::string::npos)
+            return "";
+
+        std::string extension = filename.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        return extension;
+    }
+
+    static std::string directoryOf(const std::string& filename) {
+
+        auto slash = filename.find_last_of("/\\");
+        return (slash == std::string::npos) ? "" : filename.substr(0, slash + 1);
+    }
+
+    static std::vector<char> readWholeFile(const std::string& filename) {
+
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+        if (!file.is_open())
+            throw std::runtime_error("failed to open file! " + filename);
+
+        size_t fileSize = (size_t)file.tellg();
+        std::vector<char> buffer(fileSize);
+
+        file.seekg(0);
+        file.read(buffer.data(), fileSize);
+
+        return buffer;
+    }
+
+    void generateNormals(MeshSource& mesh) {
+
+        mesh.normals.assign(mesh.positions.size(), 0.0f);
+
+        const float* p = mesh.positions.data();
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+
+            uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+
+            float e1[3] = { p[b * 3] - p[a * 3], p[b * 3 + 1] - p[a * 3 + 1], p[b * 3 + 2] - p[a * 3 + 2] };
+            float e2[3] = { p[c * 3] - p[a * 3], p[c * 3 + 1] - p[a * 3 + 1], p[c * 3 + 2] - p[a * 3 + 2] };
+
+            //Unnormalized cross product, its length is twice the triangle area so big triangles weigh more
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+            for (uint32_t vertex : { a, b, c })
+                for (int axis = 0; axis < 3; axis++)
+                    mesh.normals[vertex * 3 + axis] += n[axis];
+        }
+
+        for (size_t v = 0; v < mesh.vertexCount(); v++) {
+
+            float* n = &mesh.normals[v * 3];
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            if (length > 0.0f) {
+                n[0] /= length; n[1] /= length; n[2] /= length;
+            }
+            else {
+                n[0] = 0.0f; n[1] = 1.0f; n[2] = 0.0f;
+            }
+        }
+    }
+
+//OBJ
+
+    std::vector<MeshSource> importObj(const std::string& filename) {
+
+        std::ifstream file(filename);
+
+        if (!file.is_open())
+            throw std::runtime_error("failed to open file! " + filename);
+
+        std::vector<float> positions, texCoords, normals;
+
+        std::vector<MeshSource> meshes;
+        std::unordered_map<uint64_t, uint32_t> vertexCache;
+
+        bool hasTexCoords = false, hasNormals = false;
+
+        auto startMesh = [&](const std::string& name) {
+
+            //Reuse the current mesh if nothing was emitted yet
+            if (meshes.empty() || !meshes.back().indices.empty())
+                meshes.emplace_back();
+
+            meshes.back().name = name;
+            vertexCache.clear();
+        };
+
+        //OBJ indices are 1 based and negative ones count from the end
+        auto resolve = [](long index, size_t count) -> long {
+            return (index < 0) ? static_cast<long>(count) + index : index - 1;
+        };
+
+        startMesh("default");
+
+        std::string line;
+
+        while (std::getline(file, line)) {
+
+            std::istringstream stream(line);
+            std::string keyword;
+            stream >> keyword;
+
+            if (keyword == "v") {
+                float x, y, z;
+                stream >> x >> y >> z;
+                positions.insert(positions.end(), { x, y, z });
+            }
+            else if (keyword == "vt") {
+                float u, v;
+                stream >> u >> v;
+                //OBJ has v pointing up, Vulkan samples top down
+                texCoords.insert(texCoords.end(), { u, 1.0f - v });
+            }
+            else if (keyword == "vn") {
+                float x, y, z;
+                stream >> x >> y >> z;
+                normals.insert(normals.end(), { x, y, z });
+            }
+            else if (keyword == "o" || keyword == "g") {
+                std::string name;
+                stream >> name;
+                startMesh(name.empty() ? "default" : name);
+            }
+            else if (keyword == "f") {
+
+                MeshSource& mesh = meshes.back();
+                std::vector<uint32_t> polygon;
+                std::string corner;
+
+                while (stream >> corner) {
+
+                    long v = 0, vt = 0, vn = 0;
+
+                    // v, v/vt, v//vn or v/vt/vn
+                    auto firstSlash = corner.find('/');
+                    v = std::stol(corner.substr(0, firstSlash));
+
+                    if (firstSlash != std::string::npos) {
+
+                        auto secondSlash = corner.find('/', firstSlash + 1);
+                        std::string texCoord = corner.substr(firstSlash + 1, secondSlash - firstSlash - 1);
+
+                        if (!texCoord.empty())
+                            vt = std::stol(texCoord);
+
+                        if (secondSlash != std::string::npos)
+                            vn = std::stol(corner.substr(secondSlash + 1));
+                    }
+
+                    long position = resolve(v, positions.size() / 3);
+                    long texCoord = vt ? resolve(vt, texCoords.size() / 2) : -1;
+                    long normal = vn ? resolve(vn, normals.size() / 3) : -1;
+
+                    //vt and vn are only checked when the corner has them, 0 means left out
+                    if (position < 0 || position >= static_cast<long>(positions.size() / 3) ||
+                        (vt && (texCoord < 0 || texCoord >= static_cast<long>(texCoords.size() / 2))) ||
+                        (vn && (normal < 0 || normal >= static_cast<long>(normals.size() / 3))))
+                        throw std::runtime_error("invalid OBJ! - face index out of range in " + filename);
+
+                    uint64_t key = (uint64_t(position) << 42) ^ (uint64_t(texCoord + 1) << 21) ^ uint64_t(normal + 1);
+
+                    auto cached = vertexCache.find(key);
+
+                    if (cached != vertexCache.end()) {
+                        polygon.push_back(cached->second);
+                        continue;
+                    }
+
+                    uint32_t index = static_cast<uint32_t>(mesh.vertexCount());
+
+                    mesh.positions.insert(mesh.positions.end(), { positions[position * 3], positions[position * 3 + 1], positions[position * 3 + 2] });
+
+                    if (texCoord >= 0) {
+                        hasTexCoords = true;
+                        mesh.texCoords.insert(mesh.texCoords.end(), { texCoords[texCoord * 2], texCoords[texCoord * 2 + 1] });
+                    }
+                    else
+                        mesh.texCoords.insert(mesh.texCoords.end(), { 0.0f, 0.0f });
+
+                    if (normal >= 0) {
+                        hasNormals = true;
+                        mesh.normals.insert(mesh.normals.end(), { normals[normal * 3], normals[normal * 3 + 1], normals[normal * 3 + 2] });
+                    }
+                    else
+                        mesh.normals.insert(mesh.normals.end(), { 0.0f, 0.0f, 0.0f });
+
+                    vertexCache.emplace(key, index);
+                    polygon.push_back(index);
+                }
+
+                //Fan triangulation, fine for the convex polygons exporters write
+                for (size_t i = 1; i + 1 < polygon.size(); i++)
+                    mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i], polygon[i + 1] });
+            }
+        }
+
+        meshes.erase(std::remove_if(meshes.begin(), meshes.end(), [](const MeshSource& mesh) { return mesh.indices.empty(); }), meshes.end());
+
+        for (auto& mesh : meshes) {
+
+            if (!hasTexCoords)
+                mesh.texCoords.clear();
+
+            if (!hasNormals)
+                generateNormals(mesh);
+        }
+
+        return meshes;
+    }
+
+//JSON (just enough for glTF)
+
+    struct JsonValue;
+
+    using JsonObject = std::vector<std::pair<std::string, JsonValue>>;
+    using JsonArray = std::vector<JsonValue>;
+
+    struct JsonValue {
+
+        std::variant<std::nullptr_t, bool, double, std::string, std::shared_ptr<JsonArray>, std::shared_ptr<JsonObject>> value = nullptr;
+
+        const JsonValue* find(const std::string& key) const {
+
+            auto object = std::get_if<std::shared_ptr<JsonObject>>(&value);
+
+            if (object == nullptr)
+                return nullptr;
+
+            for (const auto& [name, member] : **object)
+                if (name == key)
+                    return &member;
+
+            return nullptr;
+        }
+
+        const JsonArray& array() const {
+
+            static const JsonArray empty;
+            auto array = std::get_if<std::shared_ptr<JsonArray>>(&value);
+
+            return (array != nullptr) ? **array : empty;
+        }
+
+        double number(double fallback = 0.0) const {
+
+            auto number = std::get_if<double>(&value);
+            return (number != nullptr) ? *number : fallback;
+        }
+
+        std::string string() const {
+
+            auto string = std::get_if<std::string>(&value);
+            return (string != nullptr) ? *string : std::string();
+        }
+
+        double numberAt(const std::string& key, double fallback) const {
+
+            auto member = find(key);
+            return (member != nullptr) ? member->number(fallback) : fallback;
+        }
+    };
+
+    class JsonParser {
+    public:
+
+        JsonParser(const char* begin, const char* end) : _cursor(begin), _end(end) {}
+
+        JsonValue parse() {
+
+            JsonValue value = parseValue();
+            skipWhitespace();
+
+            return value;
+        }
+
+    private:
+
+        [[noreturn]] void fail() { throw std::runtime_error("invalid glTF! - malformed JSON"); }
+
+        void skipWhitespace() {
+
+            while (_cursor < _end && (*_cursor == ' ' || *_cursor == '\n' || *_cursor == '\r' || *_cursor == '\t'))
+                _cursor++;
+        }
+
+        void expect(char c) {
+
+            skipWhitespace();
+
+            if (_cursor >= _end || *_cursor != c)
+                fail();
+
+            _cursor++;
+        }
+
+        JsonValue parseValue() {
+
+            skipWhitespace();
+
+            if (_cursor >= _end)
+                fail();
+
+            JsonValue result;
+
+            switch (*_cursor) {
+            case '{': result.value = parseObject(); break;
+            case '[': result.value = parseArray(); break;
+            case '"': result.value = parseString(); break;
+            case 't': expectWord("true"); result.value = true; break;
+            case 'f': expectWord("false"); result.value = false; break;
+            case 'n': expectWord("null"); result.value = nullptr; break;
+            default: result.value = parseNumber(); break;
+            }
+
+            return result;
+        }
+
+        void expectWord(const char* word) {
+
+            size_t length = std::strlen(word);
+
+            if (static_cast<size_t>(_end - _cursor) < length || std::strncmp(_cursor, word, length) != 0)
+                fail();
+
+            _cursor += length;
+        }
+
+        double parseNumber() {
+
+            char* numberEnd = nullptr;
+            std::string text(_cursor, std::min<size_t>(_end - _cursor, 64));
+
+            double number = std::strtod(text.c_str(), &numberEnd);
+
+            if (numberEnd == text.c_str())
+                fail();
+
+            _cursor += numberEnd - text.c_str();
+            return number;
+        }
+
+        std::string parseString() {
+
+            expect('"');
+
+            std::string string;
+
+            while (_cursor < _end && *_cursor != '"') {
+
+                if (*_cursor == '\\' && _cursor + 1 < _end) {
+
+                    _cursor++;
+
+                    switch (*_cursor) {
+                    case 'n': string += '\n'; break;
+                    case 't': string += '\t'; break;
+                    case 'r': string += '\r'; break;
+                    case 'b': string += '\b'; break;
+                    case 'f': string += '\f'; break;
+                    case 'u': string += '?'; _cursor += 4; break; //Names only, no need for real unicode
+                    default: string += *_cursor; break;
+                    }
+
+                    _cursor++;
+                    continue;
+                }
+
+                string += *_cursor++;
+            }
+
+            expect('"');
+            return string;
+        }
+
+        std::shared_ptr<JsonArray> parseArray() {
+
+            auto array = std::make_shared<JsonArray>();
+            expect('[');
+            skipWhitespace();
+
+            if (_cursor < _end && *_cursor == ']') {
+                _cursor++;
+                return array;
+            }
+
+            while (true) {
+
+                array->push_back(parseValue());
+                skipWhitespace();
+
+                if (_cursor < _end && *_cursor == ',') {
+                    _cursor++;
+                    continue;
+                }
+
+                expect(']');
+                return array;
+            }
+        }
+
+        std::shared_ptr<JsonObject> parseObject() {
+
+            auto object = std::make_shared<JsonObject>();
+            expect('{');
+            skipWhitespace();
+
+            if (_cursor < _end && *_cursor == '}') {
+                _cursor++;
+                return object;
+            }
+
+            while (true) {
+
+                skipWhitespace();
+                std::string key = parseString();
+                expect(':');
+                object->emplace_back(std::move(key), parseValue());
+                skipWhitespace();
+
+                if (_cursor < _end && *_cursor == ',') {
+                    _cursor++;
+                    continue;
+                }
+
+                expect('}');
+                return object;
+            }
+        }
+
+        const char* _cursor;
+        const char* _end;
+    };
+
+//glTF
+
+    static std::vector<char> decodeBase64(const std::string& text) {
+
+        std::vector<char> output;
+        uint32_t accumulator = 0;
+        int bits = 0;
+
+        for (char c : text) {
+
+            int value;
+
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '+') value = 62;
+            else if (c == '/') value = 63;
+            else continue;
+
+            accumulator = (accumulator << 6) | value;
+            bits += 6;
+
+            if (bits >= 8) {
+                bits -= 8;
+                output.push_back(static_cast<char>((accumulator >> bits) & 0xFF));
+            }
+        }
+
+        return output;
+    }
+
+    // Member a valid file always has
+    static const JsonValue& requireMember(const JsonValue& object, const std::string& key, const std::string& owner) {
+
+        const JsonValue* member = object.find(key);
+
+        if (member == nullptr)
+            throw std::runtime_error("invalid glTF! - " + owner + " without " + key);
+
+        return *member;
+    }
+
+    // Index into a list of count entries, anything but a whole number below count is rejected
+    static uint32_t requireIndex(const JsonValue& value, size_t count, const std::string& what) {
+
+        double index = value.number(-1.0);
+
+        if (!(index >= 0.0) || index >= static_cast<double>(count) || index != std::floor(index))
+            throw std::runtime_error("invalid glTF! - " + what + " out of range");
+
+        return static_cast<uint32_t>(index);
+    }
+
+    // Reads accessor elements as floats (or integers for indices), handles strides and normalized integer types
+    static std::vector<double> readAccessor(const JsonValue& document, const std::vector<std::vector<char>>& buffers, const JsonValue& accessorIndex, uint32_t& componentCount) {
+
+        const auto& accessors = requireMember(document, "accessors", "file").array();
+
+        const JsonValue& accessor = accessors[requireIndex(accessorIndex, accessors.size(), "accessor")];
+
+        std::string type = requireMember(accessor, "type", "accessor").string();
+        componentCount = (type == "SCALAR") ? 1 : (type == "VEC2") ? 2 : (type == "VEC3") ? 3 : (type == "VEC4") ? 4 : 0;
+
+        if (componentCount == 0)
+            throw std::runtime_error("invalid glTF! - unsupported accessor type " + type);
+
+        auto count = static_cast<size_t>(accessor.numberAt("count", 0));
+        auto componentType = static_cast<uint32_t>(accessor.numberAt("componentType", 5126));
+        bool normalized = accessor.find("normalized") != nullptr && std::get_if<bool>(&accessor.find("normalized")->value) && std::get<bool>(accessor.find("normalized")->value);
+
+        size_t componentSize = (componentType == 5120 || componentType == 5121) ? 1 : (componentType == 5122 || componentType == 5123) ? 2 : 4;
+
+        //Accessors without a buffer view are all zeros (sparse accessors are not supported)
+        if (accessor.find("bufferView") == nullptr)
+            return std::vector<double>(count * componentCount, 0.0);
+
+        const auto& views = requireMember(document, "bufferViews", "file").array();
+        const JsonValue& view = views[requireIndex(*accessor.find("bufferView"), views.size(), "buffer view")];
+        const auto& buffer = buffers[requireIndex(requireMember(view, "buffer", "buffer view"), buffers.size(), "buffer")];
+
+        double offsetValue = view.numberAt("byteOffset", 0) + accessor.numberAt("byteOffset", 0);
+        double strideValue = view.numberAt("byteStride", double(componentSize * componentCount));
+
+        if (offsetValue < 0.0 || strideValue < 0.0)
+            throw std::runtime_error("invalid glTF! - negative accessor offset or stride");
+
+        size_t offset = static_cast<size_t>(offsetValue);
+        size_t stride = static_cast<size_t>(strideValue);
+        size_t elementSize = componentSize * componentCount;
+
+        //Written so nothing overflows on a made up count
+        if (count > 0 && (offset > buffer.size() || elementSize > buffer.size() - offset ||
+            (stride != 0 && count - 1 > (buffer.size() - offset - elementSize) / stride)))
+            throw std::runtime_error("invalid glTF! - accessor reads past its buffer");
+
+        std::vector<double> values(count * componentCount, 0.0);
+
+        for (size_t element = 0; element < count; element++)
+            for (uint32_t component = 0; component < componentCount; component++) {
+
+                const char* source = buffer.data() + offset + element * stride + component * componentSize;
+                double value = 0.0;
+
+                switch (componentType) {
+                case 5120: { int8_t v; std::memcpy(&v, source, 1); value = normalized ? std::max(v / 127.0, -1.0) : v; break; }
+                case 5121: { uint8_t v; std::memcpy(&v, source, 1); value = normalized ? v / 255.0 : v; break; }
+                case 5122: { int16_t v; std::memcpy(&v, source, 2); value = normalized ? std::max(v / 32767.0, -1.0) : v; break; }
+                case 5123: { uint16_t v; std::memcpy(&v, source, 2); value = normalized ? v / 65535.0 : v; break; }
+                case 5125: { uint32_t v; std::memcpy(&v, source, 4); value = v; break; }
+                case 5126: { float v; std::memcpy(&v, source, 4); value = v; break; }
+                default: throw std::runtime_error("invalid glTF! - unknown component type");
+                }
+
+                values[element * componentCount + component] = value;
+            }
+
+        return values;
+    }
+
+    std::vector<MeshSource> importGltf(const std::string& filename) {
+
+        std::vector<char> file = readWholeFile(filename);
+
+        const char* jsonBegin = file.data();
+        const char* jsonEnd = file.data() + file.size();
+
+        std::vector<char> glbBinary;
+
+        //GLB: 12 byte header, then a JSON chunk and an optional BIN chunk
+        if (file.size() >= 20 && std::memcmp(file.data(), "glTF", 4) == 0) {
+
+            uint32_t jsonLength;
+            std::memcpy(&jsonLength, file.data() + 12, 4);
+
+            jsonBegin = file.data() + 20;
+            jsonEnd = jsonBegin + jsonLength;
+
+            size_t binaryChunk = 20 + jsonLength;
+
+            if (jsonEnd > file.data() + file.size())
+                throw std::runtime_error("invalid glTF! - truncated GLB");
+
+            if (binaryChunk + 8 <= file.size()) {
+
+                uint32_t binaryLength;
+                std::memcpy(&binaryLength, file.data() + binaryChunk, 4);
+
+                if (binaryChunk + 8 + binaryLength > file.size())
+                    throw std::runtime_error("invalid glTF! - truncated GLB");
+
+                glbBinary.assign(file.data() + binaryChunk + 8, file.data() + binaryChunk + 8 + binaryLength);
+            }
+        }
+
+        JsonValue document = JsonParser(jsonBegin, jsonEnd).parse();
+
+        if (document.find("meshes") == nullptr || document.find("accessors") == nullptr)
+            return {};
+
+        std::vector<std::vector<char>> buffers;
+
+        if (auto bufferList = document.find("buffers")) {
+
+            for (const auto& buffer : bufferList->array()) {
+
+                auto uri = buffer.find("uri");
+
+                if (uri == nullptr) {
+                    buffers.push_back(glbBinary);
+                    continue;
+                }
+
+                std::string location = uri->string();
+                auto comma = location.find(',');
+
+                if (location.rfind("data:", 0) == 0 && comma != std::string::npos)
+                    buffers.push_back(decodeBase64(location.substr(comma + 1)));
+                else
+                    buffers.push_back(readWholeFile(directoryOf(filename) + location));
+            }
+        }
+
+        std::vector<MeshSource> meshes;
+
+        for (const auto& gltfMesh : document.find("meshes")->array()) {
+
+            MeshSource mesh;
+            mesh.name = gltfMesh.find("name") ? gltfMesh.find("name")->string() : "mesh" + std::to_string(meshes.size());
+
+            bool hasNormals = true, hasTexCoords = true;
+
+            for (const auto& primitive : requireMember(gltfMesh, "primitives", "mesh " + mesh.name).array()) {
+
+                //Triangles only
+                if (primitive.numberAt("mode", 4) != 4)
+                    continue;
+
+                const JsonValue* attributes = primitive.find("attributes");
+                const JsonValue* position = attributes ? attributes->find("POSITION") : nullptr;
+
+                if (position == nullptr)
+                    continue;
+
+                uint32_t components;
+                auto positions = readAccessor(document, buffers, *position, components);
+
+                if (components != 3)
+                    throw std::runtime_error("invalid glTF! - POSITION has to be VEC3 in mesh " + mesh.name);
+
+                size_t baseVertex = mesh.vertexCount();
+                size_t vertexCount = positions.size() / 3;
+
+                for (double value : positions)
+                    mesh.positions.push_back(static_cast<float>(value));
+
+                //Every attribute array is indexed by the same vertex, one that is off misaligns all the rest
+                auto readAttribute = [&](const JsonValue& accessor, uint32_t expectedComponents, const char* name) {
+
+                    auto values = readAccessor(document, buffers, accessor, components);
+
+                    if (components != expectedComponents || values.size() != vertexCount * expectedComponents)
+                        throw std::runtime_error(std::string("invalid glTF! - ") + name + " doesn't match POSITION in mesh " + mesh.name);
+
+                    return values;
+                };
+
+                if (auto normal = attributes->find("NORMAL")) {
+                    for (double value : readAttribute(*normal, 3, "NORMAL"))
+                        mesh.normals.push_back(static_cast<float>(value));
+                }
+                else {
+                    hasNormals = false;
+                    mesh.normals.resize(mesh.positions.size(), 0.0f);
+                }
+
+                if (auto texCoord = attributes->find("TEXCOORD_0")) {
+                    for (double value : readAttribute(*texCoord, 2, "TEXCOORD_0"))
+                        mesh.texCoords.push_back(static_cast<float>(value));
+                }
+                else {
+                    hasTexCoords = false;
+                    mesh.texCoords.resize(mesh.vertexCount() * 2, 0.0f);
+                }
+
+                if (auto indices = primitive.find("indices")) {
+
+                    auto values = readAccessor(document, buffers, *indices, components);
+
+                    //The optimizer and the simplifier index straight into the vertex arrays
+                    if (components != 1 || values.size() % 3 != 0)
+                        throw std::runtime_error("invalid glTF! - indices aren't a list of triangles in mesh " + mesh.name);
+
+                    for (double value : values) {
+
+                        if (value < 0.0 || value >= static_cast<double>(vertexCount))
+                            throw std::runtime_error("invalid glTF! - vertex index out of range in mesh " + mesh.name);
+
+                        mesh.indices.push_back(static_cast<uint32_t>(baseVertex + static_cast<size_t>(value)));
+                    }
+                }
+                else {
+                    for (size_t i = 0; i < vertexCount; i++)
+                        mesh.indices.push_back(static_cast<uint32_t>(baseVertex + i));
+                }
+            }
+
+            if (mesh.indices.empty())
+                continue;
+
+            if (!hasTexCoords)
+                mesh.texCoords.clear();
+
+            if (!hasNormals)
+                generateNormals(mesh);
+
+            meshes.push_back(std::move(mesh));
+        }
+
+        return meshes;
+    }
+
+    std::vector<MeshSource> importMesh(const std::string& filename) {
+
+        std::string extension = fileExtension(filename);
+
+        if (extension == "obj")
+            return importObj(filename);
+
+        if (extension == "gltf" || extension == "glb")
+            return importGltf(filename);
+
+        throw std::runtime_error("unsupported mesh format! - expected .obj, .gltf or .glb");
+    }
+}
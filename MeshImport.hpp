@@ -0,0 +1,34 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+// Offline importers for the mesh converter, text formats are never parsed by the engine at runtime
+
+namespace Loader {
+
+    // Deindexed-per-attribute formats are flattened so every vertex has all attributes
+    struct MeshSource {
+
+        std::string name;
+
+        std::vector<float> positions;   // xyz
+        std::vector<float> normals;     // xyz, empty when the source had none
+        std::vector<float> texCoords;   // uv, empty when the source had none
+
+        std::vector<uint32_t> indices;  // triangle list
+
+        size_t vertexCount() const { return positions.size() / 3; }
+    };
+
+    // One MeshSource per OBJ object/group
+    std::vector<MeshSource> importObj(const std::string& filename);
+
+    // One MeshSource per glTF mesh (primitives merged), .gltf with external or embedded buffers and .glb.
+    // Node transforms are not applied.
+    std::vector<MeshSource> importGltf(const std::string& filename);
+
+    std::vector<MeshSource> importMesh(const std::string& filename);
+
+    // Area weighted smooth normals, used when the source has none
+    void generateNormals(MeshSource& mesh);
+}
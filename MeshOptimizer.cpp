@@ -0,0 +1,355 @@
+#include "MeshOptimizer.hpp"
+
+#include <cmath>
+#include <numeric>
+
+#include <glm/gtc/packing.hpp>
+
+namespace Loader {
+
+    constexpr uint32_t INVALID_TRIANGLE = ~0u;
+
+    VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+
+        VertexCacheStats stats{};
+
+        if (indices.empty() || vertexCount == 0)
+            return stats;
+
+        //FIFO by timestamp: a vertex is cached while less than cacheSize misses happened since it was loaded
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        size_t misses = 0;
+
+        for (uint32_t index : indices)
+            if (time - cacheTime[index] > cacheSize) {
+                cacheTime[index] = time++;
+                misses++;
+            }
+
+        stats.acmr = float(misses) / float(indices.size() / 3);
+        stats.atvr = float(misses) / float(vertexCount);
+
+        return stats;
+    }
+
+//Vertex Cache
+
+    // Forsyth's scoring: the last triangle's vertices get a flat score so we don't just continue the strip,
+    // older cache entries fall off with a power curve and vertices with few triangles left get a boost
+    static float forsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+
+        if (cachePosition >= 0) {
+
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / float(VERTEX_CACHE_SIZE - 3), 1.5f);
+        }
+
+        return score + 2.0f / std::sqrt(float(remainingTriangles));
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+
+        size_t triangleCount = indices.size() / 3;
+
+        if (triangleCount == 0)
+            return;
+
+        //Triangles per vertex as one flat array, the live range of each vertex shrinks as triangles get emitted
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+
+        for (uint32_t index : indices)
+            remaining[index]++;
+
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + remaining[v];
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int corner = 0; corner < 3; corner++)
+                adjacency[fill[indices[t * 3 + corner]]++] = static_cast<uint32_t>(t);
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+
+        uint32_t bestTriangle = 0;
+
+        for (size_t t = 0; t < triangleCount; t++) {
+
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+            if (triangleScore[t] > triangleScore[bestTriangle])
+                bestTriangle = static_cast<uint32_t>(t);
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        std::vector<uint32_t> cache, nextCache;
+        size_t scanCursor = 0;
+
+        while (result.size() < indices.size()) {
+
+            //Nothing in the cache has triangles left, fall back to the next unemitted one in input order
+            if (bestTriangle == INVALID_TRIANGLE) {
+
+                while (emitted[scanCursor])
+                    scanCursor++;
+
+                bestTriangle = static_cast<uint32_t>(scanCursor);
+            }
+
+            const uint32_t* triangle = &indices[bestTriangle * 3];
+
+            result.insert(result.end(), triangle, triangle + 3);
+            emitted[bestTriangle] = true;
+
+            nextCache.assign(triangle, triangle + 3);
+
+            for (int corner = 0; corner < 3; corner++) {
+
+                uint32_t v = triangle[corner];
+
+                uint32_t* begin = &adjacency[offsets[v]];
+                uint32_t* end = begin + remaining[v];
+
+                auto found = std::find(begin, end, bestTriangle);
+
+                //Degenerate triangle, this vertex was already handled by another corner
+                if (found == end)
+                    continue;
+
+                std::iter_swap(found, end - 1);
+                remaining[v]--;
+            }
+
+            for (uint32_t v : cache)
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    nextCache.push_back(v);
+
+            //Entries that fall off the end still need their score updated
+            for (size_t i = 0; i < nextCache.size(); i++)
+                cachePosition[nextCache[i]] = (i < VERTEX_CACHE_SIZE) ? static_cast<int>(i) : -1;
+
+            bestTriangle = INVALID_TRIANGLE;
+            float bestScore = -1.0f;
+
+            for (uint32_t v : nextCache)
+                vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+
+            for (uint32_t v : nextCache)
+                for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+
+                    uint32_t t = adjacency[i];
+
+                    triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+
+            if (nextCache.size() > VERTEX_CACHE_SIZE)
+                nextCache.resize(VERTEX_CACHE_SIZE);
+
+            std::swap(cache, nextCache);
+        }
+
+        indices.swap(result);
+    }
+
+//Overdraw
+
+    void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& positions, float threshold) {
+
+        const uint32_t cacheSize = 16;
+
+        size_t triangleCount = indices.size() / 3;
+        size_t vertexCount = positions.size() / 3;
+
+        if (triangleCount < 2)
+            return;
+
+        float targetAcmr = analyzeVertexCache(indices, vertexCount, cacheSize).acmr * threshold;
+
+        //Cluster boundaries: hard ones where the cache was flushed anyway (all 3 vertices missed),
+        //soft ones inside those once the cluster already reached the target miss ratio
+        std::vector<uint32_t> clusterStarts;
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+
+        size_t clusterMisses = 0, clusterTriangles = 0;
+
+        for (size_t t = 0; t < triangleCount; t++) {
+
+            uint32_t misses = 0;
+
+            for (int corner = 0; corner < 3; corner++) {
+
+                uint32_t v = indices[t * 3 + corner];
+
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                    misses++;
+                }
+            }
+
+            bool hardBoundary = (misses == 3);
+            bool softBoundary = clusterTriangles >= 16 && float(clusterMisses) <= targetAcmr * float(clusterTriangles);
+
+            if (t == 0 || hardBoundary || softBoundary) {
+
+                clusterStarts.push_back(static_cast<uint32_t>(t));
+                clusterMisses = 0;
+                clusterTriangles = 0;
+
+                //Treat the cache as cold again so the next cluster doesn't rely on its neighbour
+                if (softBoundary && !hardBoundary)
+                    time += cacheSize;
+            }
+
+            clusterMisses += misses;
+            clusterTriangles++;
+        }
+
+        clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+        float meshCenter[3] = {};
+
+        for (size_t v = 0; v < vertexCount; v++)
+            for (int axis = 0; axis < 3; axis++)
+                meshCenter[axis] += positions[v * 3 + axis] / float(vertexCount);
+
+        //Clusters facing away from the center are more likely to be in front, draw them first
+        std::vector<float> clusterKeys(clusterStarts.size() - 1);
+
+        for (size_t c = 0; c + 1 < clusterStarts.size(); c++) {
+
+            float centroid[3] = {}, normal[3] = {};
+            float area = 0.0f;
+
+            for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+
+                const float* a = &positions[indices[t * 3] * 3];
+                const float* b = &positions[indices[t * 3 + 1] * 3];
+                const float* d = &positions[indices[t * 3 + 2] * 3];
+
+                float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+                float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+                float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                for (int axis = 0; axis < 3; axis++) {
+                    centroid[axis] += (a[axis] + b[axis] + d[axis]) / 3.0f * triangleArea;
+                    normal[axis] += n[axis];
+                }
+
+                area += triangleArea;
+            }
+
+            float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            if (area <= 0.0f || normalLength <= 0.0f)
+                continue;
+
+            float key = 0.0f;
+
+            for (int axis = 0; axis < 3; axis++)
+                key += (centroid[axis] / area - meshCenter[axis]) * normal[axis] / normalLength;
+
+            clusterKeys[c] = key;
+        }
+
+        std::vector<uint32_t> clusterOrder(clusterKeys.size());
+        std::iota(clusterOrder.begin(), clusterOrder.end(), 0u);
+
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) { return clusterKeys[a] > clusterKeys[b]; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        for (uint32_t c : clusterOrder)
+            result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+
+        indices.swap(result);
+    }
+
+//Vertex Fetch
+
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+
+        std::vector<uint32_t> newIndex(vertexCount, INVALID_TRIANGLE);
+        std::vector<uint32_t> remap;
+        remap.reserve(vertexCount);
+
+        for (uint32_t& index : indices) {
+
+            if (newIndex[index] == INVALID_TRIANGLE) {
+                newIndex[index] = static_cast<uint32_t>(remap.size());
+                remap.push_back(index);
+            }
+
+            index = newIndex[index];
+        }
+
+        return remap;
+    }
+
+//Quantization
+
+    uint16_t quantizeUnorm16(float value) {
+
+        return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    }
+
+    void encodeOctahedral(const float normal[3], int16_t encoded[2]) {
+
+        //Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+        float sum = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+
+        if (sum <= 0.0f) {
+            encoded[0] = 0;
+            encoded[1] = 0;
+            return;
+        }
+
+        float x = normal[0] / sum;
+        float y = normal[1] / sum;
+
+        if (normal[2] < 0.0f) {
+
+            float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+            x = foldedX;
+            y = foldedY;
+        }
+
+        encoded[0] = static_cast<int16_t>(std::round(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+        encoded[1] = static_cast<int16_t>(std::round(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    uint32_t packHalf2(float x, float y) {
+
+        return glm::packHalf2x16(glm::vec2(x, y));
+    }
+}
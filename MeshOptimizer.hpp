@@ -0,0 +1,45 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+// Offline mesh processing run by the converter before a mesh is written to a pack.
+// Order matters: vertex cache first, overdraw second (it keeps the cache order inside each cluster),
+// vertex fetch last since it renumbers the vertices the other two were working on.
+
+namespace Loader {
+
+    constexpr uint32_t VERTEX_CACHE_SIZE = 32;
+
+    struct VertexCacheStats {
+
+        // Average cache miss ratio: transformed vertices per triangle, 0.5 is ideal and 3 is no reuse at all
+        float acmr = 0.0f;
+        // Average transform to vertex ratio: 1 means each vertex is transformed exactly once
+        float atvr = 0.0f;
+    };
+
+    // Simulates a FIFO post transform cache, a rough stand in for what the GPU does
+    VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+    // Forsyth's linear speed vertex cache optimization, reorders triangles in place
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    // Splits the cache optimized list into clusters and sorts them so outward facing ones come first.
+    // threshold is how much ACMR we are willing to lose, 1.05 allows 5% more vertex transforms.
+    void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& positions, float threshold = 1.05f);
+
+    // Renumbers vertices in the order the index buffer first touches them and drops unreferenced ones.
+    // Returns the remap table, remap[newIndex] = oldIndex, to be applied to every attribute stream.
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    // Quantization helpers, decoded by the vertex input formats
+
+    // [0, 1] -> VK_FORMAT_R16G16B16A16_UNORM component
+    uint16_t quantizeUnorm16(float value);
+
+    // Unit vector -> octahedral VK_FORMAT_R16G16_SNORM
+    void encodeOctahedral(const float normal[3], int16_t encoded[2]);
+
+    // -> VK_FORMAT_R16G16_SFLOAT
+    uint32_t packHalf2(float x, float y);
+}
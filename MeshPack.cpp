@@ -0,0 +1,249 @@
+#include "MeshPack.hpp"
+
+#include <cstring>
+
+namespace Loader {
+
+    static uint64_t alignOffset(uint64_t offset) {
+
+        return (offset + MESH_PACK_ALIGNMENT - 1) & ~uint64_t(MESH_PACK_ALIGNMENT - 1);
+    }
+
+    uint64_t meshPackChecksum(const uint8_t* data, size_t size) {
+
+        // 8 bytes per step with a multiply/xorshift mix, the tail is folded in byte by byte
+        const uint64_t prime = 0x9E3779B97F4A7C15ull;
+        uint64_t hash = 0xCBF29CE484222325ull ^ (size * prime);
+
+        size_t i = 0;
+
+        for (; i + 8 <= size; i += 8) {
+
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+
+            hash ^= word * prime;
+            hash = (hash << 27) | (hash >> 37);
+            hash *= 0xBF58476D1CE4E5B9ull;
+        }
+
+        for (; i < size; i++) {
+
+            hash ^= data[i];
+            hash *= 0x100000001B3ull;
+        }
+
+        hash ^= hash >> 31;
+        hash *= 0x94D049BB133111EBull;
+        hash ^= hash >> 29;
+
+        return hash;
+    }
+
+//Mesh Pack View
+
+    void MeshPackView::open(const std::string& filename, bool verifyChecksum) {
+
+        _file.open(filename);
+
+        if (_file.size() < sizeof(MeshPackHeader))
+            throw std::runtime_error("invalid mesh pack! - file too small");
+
+        _header = reinterpret_cast<const MeshPackHeader*>(_file.data());
+
+        if (_header->magic != MESH_PACK_MAGIC)
+            throw std::runtime_error("invalid mesh pack! - bad magic");
+
+        if (_header->version != MESH_PACK_VERSION || _header->headerSize != sizeof(MeshPackHeader))
+            throw std::runtime_error("invalid mesh pack! - unsupported version, rerun the converter");
+
+        if (_header->fileSize != _file.size())
+            throw std::runtime_error("invalid mesh pack! - truncated file");
+
+        if (_header->attributeCount > MESH_PACK_MAX_ATTRIBUTES)
+            throw std::runtime_error("invalid mesh pack! - too many attributes");
+
+        auto inside = [this](uint64_t offset, uint64_t size) { return offset <= _file.size() && size <= _file.size() - offset; };
+
+        if (!inside(_header->meshTableOffset, uint64_t(_header->meshCount) * sizeof(MeshPackMesh)) ||
+            !inside(_header->lodTableOffset, uint64_t(_header->lodCount) * sizeof(MeshPackLod)) ||
+            !inside(_header->vertexDataOffset, _header->vertexDataSize) ||
+            !inside(_header->indexDataOffset, _header->indexDataSize))
+            throw std::runtime_error("invalid mesh pack! - section out of bounds");
+
+        if (_header->indexType != VK_INDEX_TYPE_UINT16 && _header->indexType != VK_INDEX_TYPE_UINT32)
+            throw std::runtime_error("invalid mesh pack! - bad index type");
+
+        if (_header->vertexStride == 0)
+            throw std::runtime_error("invalid mesh pack! - zero vertex stride");
+
+        //Checked with or without the checksum, the mesh and lod ranges are what the vertex and index spans are cut from
+        uint64_t vertexCount = _header->vertexDataSize / _header->vertexStride;
+        uint64_t indexCount = _header->indexDataSize / (_header->indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4);
+
+        for (const auto& lod : lods())
+            if (uint64_t(lod.firstIndex) + lod.indexCount > indexCount)
+                throw std::runtime_error("invalid mesh pack! - lod index range out of bounds");
+
+        for (const auto& mesh : meshes())
+            if (mesh.lodCount == 0 || mesh.lodCount > MESH_PACK_MAX_LODS ||
+                uint64_t(mesh.firstLod) + mesh.lodCount > _header->lodCount ||
+                uint64_t(mesh.firstVertex) + mesh.vertexCount > vertexCount)
+                throw std::runtime_error("invalid mesh pack! - mesh range out of bounds");
+
+        if (verifyChecksum && meshPackChecksum(_file.data() + _header->headerSize, _file.size() - _header->headerSize) != _header->checksum)
+            throw std::runtime_error("invalid mesh pack! - checksum mismatch");
+    }
+
+    std::span<const MeshPackMesh> MeshPackView::meshes() const {
+
+        return { reinterpret_cast<const MeshPackMesh*>(_file.data() + _header->meshTableOffset), _header->meshCount };
+    }
+
+    std::span<const MeshPackLod> MeshPackView::lods() const {
+
+        return { reinterpret_cast<const MeshPackLod*>(_file.data() + _header->lodTableOffset), _header->lodCount };
+    }
+
+    const MeshPackAttribute* MeshPackView::findAttribute(VertexSemantic semantic) const {
+
+        for (uint32_t i = 0; i < _header->attributeCount; i++)
+            if (_header->attributes[i].semantic == semantic)
+                return &_header->attributes[i];
+
+        return nullptr;
+    }
+
+//Writer
+
+    void writeMeshPack(const std::string& filename, const MeshPackLayout& layout, const std::vector<MeshPackSourceMesh>& meshes) {
+
+        if (layout.attributes.size() > MESH_PACK_MAX_ATTRIBUTES)
+            throw std::runtime_error("too many vertex attributes for a mesh pack!");
+
+        if (layout.vertexStride == 0)
+            throw std::runtime_error("mesh pack layout needs a vertex stride!");
+
+        MeshPackHeader header{};
+        header.magic = MESH_PACK_MAGIC;
+        header.version = MESH_PACK_VERSION;
+        header.headerSize = sizeof(MeshPackHeader);
+        header.flags = layout.flags;
+        header.meshCount = static_cast<uint32_t>(meshes.size());
+        header.vertexStride = layout.vertexStride;
+        header.attributeCount = static_cast<uint32_t>(layout.attributes.size());
+
+        std::copy(layout.attributes.begin(), layout.attributes.end(), header.attributes);
+
+        //16 bit indices when every mesh fits, indices are relative to the mesh first vertex
+        header.indexType = VK_INDEX_TYPE_UINT16;
+
+        for (const auto& mesh : meshes)
+            if (mesh.vertexCount > 65536)
+                header.indexType = VK_INDEX_TYPE_UINT32;
+
+        size_t indexSize = (header.indexType == VK_INDEX_TYPE_UINT16) ? 2 : 4;
+
+        std::vector<MeshPackMesh> meshTable(meshes.size());
+        std::vector<MeshPackLod> lodTable;
+
+        uint64_t vertexBytes = 0, indexCount = 0;
+
+        for (int axis = 0; axis < 3; axis++) {
+            header.boundsMin[axis] = std::numeric_limits<float>::max();
+            header.boundsMax[axis] = -std::numeric_limits<float>::max();
+        }
+
+        for (size_t i = 0; i < meshes.size(); i++) {
+
+            const auto& source = meshes[i];
+            auto& entry = meshTable[i];
+
+            if (source.lodIndices.empty() || source.lodIndices.size() > MESH_PACK_MAX_LODS)
+                throw std::runtime_error("mesh needs between 1 and MESH_PACK_MAX_LODS index lists!");
+
+            //Otherwise every mesh after this one is shifted and the pack no longer matches its own tables
+            if (source.vertices.size() != size_t(source.vertexCount) * layout.vertexStride)
+                throw std::runtime_error("mesh vertex data doesn't match its vertex count and the layout stride!");
+
+            std::strncpy(entry.name, source.name.c_str(), sizeof(entry.name) - 1);
+
+            entry.firstVertex = static_cast<uint32_t>(vertexBytes / layout.vertexStride);
+            entry.vertexCount = source.vertexCount;
+            entry.firstLod = static_cast<uint32_t>(lodTable.size());
+            entry.lodCount = static_cast<uint32_t>(source.lodIndices.size());
+            entry.sphereRadius = source.sphereRadius;
+
+            for (int axis = 0; axis < 3; axis++) {
+
+                entry.boundsMin[axis] = source.boundsMin[axis];
+                entry.boundsMax[axis] = source.boundsMax[axis];
+                entry.sphereCenter[axis] = source.sphereCenter[axis];
+
+                header.boundsMin[axis] = std::min(header.boundsMin[axis], source.boundsMin[axis]);
+                header.boundsMax[axis] = std::max(header.boundsMax[axis], source.boundsMax[axis]);
+            }
+
+            for (size_t lod = 0; lod < source.lodIndices.size(); lod++) {
+
+                MeshPackLod lodEntry{};
+                lodEntry.firstIndex = static_cast<uint32_t>(indexCount);
+                lodEntry.indexCount = static_cast<uint32_t>(source.lodIndices[lod].size());
+                lodEntry.error = (lod < source.lodErrors.size()) ? source.lodErrors[lod] : 0.0f;
+
+                lodTable.push_back(lodEntry);
+                indexCount += lodEntry.indexCount;
+            }
+
+            vertexBytes += source.vertices.size();
+        }
+
+        header.lodCount = static_cast<uint32_t>(lodTable.size());
+
+        header.meshTableOffset = alignOffset(sizeof(MeshPackHeader));
+        header.lodTableOffset = alignOffset(header.meshTableOffset + meshTable.size() * sizeof(MeshPackMesh));
+        header.vertexDataOffset = alignOffset(header.lodTableOffset + lodTable.size() * sizeof(MeshPackLod));
+        header.vertexDataSize = vertexBytes;
+        header.indexDataOffset = alignOffset(header.vertexDataOffset + vertexBytes);
+        header.indexDataSize = indexCount * indexSize;
+        header.fileSize = alignOffset(header.indexDataOffset + header.indexDataSize);
+
+        std::vector<uint8_t> file(header.fileSize, 0);
+
+        std::memcpy(file.data() + header.meshTableOffset, meshTable.data(), meshTable.size() * sizeof(MeshPackMesh));
+        std::memcpy(file.data() + header.lodTableOffset, lodTable.data(), lodTable.size() * sizeof(MeshPackLod));
+
+        uint8_t* vertexCursor = file.data() + header.vertexDataOffset;
+        uint8_t* indexCursor = file.data() + header.indexDataOffset;
+
+        for (const auto& source : meshes) {
+
+            std::memcpy(vertexCursor, source.vertices.data(), source.vertices.size());
+            vertexCursor += source.vertices.size();
+
+            for (const auto& indices : source.lodIndices)
+                for (uint32_t index : indices) {
+
+                    if (indexSize == 2) {
+                        uint16_t shortIndex = static_cast<uint16_t>(index);
+                        std::memcpy(indexCursor, &shortIndex, 2);
+                    }
+                    else
+                        std::memcpy(indexCursor, &index, 4);
+
+                    indexCursor += indexSize;
+                }
+        }
+
+        header.checksum = meshPackChecksum(file.data() + sizeof(MeshPackHeader), file.size() - sizeof(MeshPackHeader));
+
+        std::memcpy(file.data(), &header, sizeof(MeshPackHeader));
+
+        std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+
+        if (!output.is_open())
+            throw std::runtime_error("failed to open file!");
+
+        output.write(reinterpret_cast<const char*>(file.data()), file.size());
+    }
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <span>
+
+// Binary mesh container.
+// The file is laid out so it can be memory mapped and used in place: a fixed header, a mesh table,
+// a LOD table and then the vertex and index blobs, every section starting on a MESH_PACK_ALIGNMENT boundary.
+// All meshes in a pack share one vertex layout so a single pipeline and vertex buffer can draw all of them.
+//
+//  [MeshPackHeader][MeshPackMesh * meshCount][MeshPackLod * lodCount][vertex blob][index blob]
+
+namespace Loader {
+
+    constexpr uint32_t MESH_PACK_MAGIC = 0x504D4745; // "EGMP"
+    constexpr uint32_t MESH_PACK_VERSION = 1;
+    constexpr uint32_t MESH_PACK_ALIGNMENT = 64;
+    constexpr uint32_t MESH_PACK_MAX_ATTRIBUTES = 8;
+    constexpr uint32_t MESH_PACK_MAX_LODS = 8;
+
+    // Positions are UNORM relative to each mesh's bounds, decode is boundsMin + position * (boundsMax - boundsMin)
+    constexpr uint32_t MESH_PACK_FLAG_QUANTIZED_POSITIONS = 1 << 0;
+
+    enum class VertexSemantic : uint32_t {
+        Position = 0,
+        Normal = 1,
+        TexCoord = 2,
+        Color = 3
+    };
+
+    struct MeshPackAttribute {
+
+        VertexSemantic semantic;
+        VkFormat format;        // Stored as the Vulkan format so it goes straight into the vertex input state
+        uint32_t offset;
+        uint32_t location;
+    };
+
+    struct MeshPackHeader {
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t flags;
+
+        uint64_t fileSize;
+
+        // Checksum of everything after the header, see meshPackChecksum
+        uint64_t checksum;
+
+        uint32_t meshCount;
+        uint32_t lodCount;
+
+        uint32_t vertexStride;
+        uint32_t attributeCount;
+        MeshPackAttribute attributes[MESH_PACK_MAX_ATTRIBUTES];
+
+        VkIndexType indexType;
+        uint32_t reserved;
+
+        uint64_t meshTableOffset;
+        uint64_t lodTableOffset;
+        uint64_t vertexDataOffset;
+        uint64_t vertexDataSize;
+        uint64_t indexDataOffset;
+        uint64_t indexDataSize;
+
+        // Bounds of the whole pack
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    struct MeshPackLod {
+
+        uint32_t firstIndex;
+        uint32_t indexCount;
+
+        // Object space error of this level compared to LOD 0
+        float error;
+        uint32_t reserved;
+    };
+
+    struct MeshPackMesh {
+
+        char name[48];
+
+        // Added to every index, so meshes can share the vertex buffer
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+
+        uint32_t firstLod;
+        uint32_t lodCount;
+
+        float boundsMin[3];
+        float boundsMax[3];
+
+        float sphereCenter[3];
+        float sphereRadius;
+    };
+
+    static_assert(sizeof(MeshPackHeader) % 8 == 0, "mesh pack header has to keep the tables 8 byte aligned");
+
+    // Fast non cryptographic 64 bit hash, catches truncated and corrupted files
+    uint64_t meshPackChecksum(const uint8_t* data, size_t size);
+
+    using MappedFile = Platform::MappedFile;
+
+    // Validated view of a mapped mesh pack, every pointer points into the mapping
+    class MeshPackView {
+    public:
+
+        void open(const std::string& filename, bool verifyChecksum = true);
+        void close() { _file.close(); _header = nullptr; }
+
+        const MeshPackHeader& header() const { return *_header; }
+
+        std::span<const MeshPackMesh> meshes() const;
+        std::span<const MeshPackLod> lods() const;
+
+        const uint8_t* vertexData() const { return _file.data() + _header->vertexDataOffset; }
+        const uint8_t* indexData() const { return _file.data() + _header->indexDataOffset; }
+
+        const MeshPackAttribute* findAttribute(VertexSemantic semantic) const;
+
+    private:
+
+        MappedFile _file;
+        const MeshPackHeader* _header = nullptr;
+    };
+
+    // Build side, used by the offline converter
+
+    struct MeshPackSourceMesh {
+
+        std::string name;
+
+        // Interleaved vertices following the pack layout
+        std::vector<uint8_t> vertices;
+        uint32_t vertexCount = 0;
+
+        // LOD 0 first, each level is a complete index list
+        std::vector<std::vector<uint32_t>> lodIndices;
+        std::vector<float> lodErrors;
+
+        float boundsMin[3] = {};
+        float boundsMax[3] = {};
+
+        float sphereCenter[3] = {};
+        float sphereRadius = 0.0f;
+    };
+
+    struct MeshPackLayout {
+
+        uint32_t flags = 0;
+        uint32_t vertexStride = 0;
+        std::vector<MeshPackAttribute> attributes;
+    };
+
+    void writeMeshPack(const std::string& filename, const MeshPackLayout& layout, const std::vector<MeshPackSourceMesh>& meshes);
+}
@@ -0,0 +1,336 @@
+#include "MeshSimplifier.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace Loader {
+
+    // Symmetric 4x4 error matrix plus the weight it was built with, error / weight is the mean squared plane distance
+    struct Quadric {
+
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double weight = 0;
+
+        void addPlane(const double n[3], double d, double w) {
+
+            a00 += w * n[0] * n[0]; a01 += w * n[0] * n[1]; a02 += w * n[0] * n[2];
+            a11 += w * n[1] * n[1]; a12 += w * n[1] * n[2]; a22 += w * n[2] * n[2];
+
+            b0 += w * n[0] * d; b1 += w * n[1] * d; b2 += w * n[2] * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric& other) {
+
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        double error(const float* p) const {
+
+            double x = p[0], y = p[1], z = p[2];
+
+            double result = a00 * x * x + a11 * y * y + a22 * z * z
+                + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                + 2.0 * (b0 * x + b1 * y + b2 * z)
+                + c;
+
+            return std::max(result, 0.0);
+        }
+    };
+
+    static bool triangleNormal(const float* a, const float* b, const float* c, double normal[3], double& area) {
+
+        double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        area = length * 0.5;
+
+        if (length <= 0.0)
+            return false;
+
+        normal[0] /= length; normal[1] /= length; normal[2] /= length;
+        return true;
+    }
+
+    // Vertices that may not move: the ones on open borders and the ones sharing a position with another vertex (attribute seams)
+    static std::vector<bool> findLockedVertices(const std::vector<uint32_t>& indices, const std::vector<float>& positions) {
+
+        size_t vertexCount = positions.size() / 3;
+
+        std::vector<bool> locked(vertexCount, false);
+
+        //Weld by exact position so seams don't count as borders
+        std::vector<uint32_t> weld(vertexCount);
+        std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+
+        for (uint32_t v = 0; v < vertexCount; v++) {
+
+            uint32_t bits[3];
+            std::memcpy(bits, &positions[v * 3], sizeof(bits));
+
+            uint64_t hash = (uint64_t(bits[0]) * 73856093ull) ^ (uint64_t(bits[1]) * 19349663ull) ^ (uint64_t(bits[2]) * 83492791ull);
+
+            weld[v] = v;
+
+            for (uint32_t other : buckets[hash])
+                if (std::memcmp(&positions[other * 3], &positions[v * 3], sizeof(bits)) == 0) {
+
+                    weld[v] = other;
+                    locked[v] = true;
+                    locked[other] = true;
+                    break;
+                }
+
+            if (weld[v] == v)
+                buckets[hash].push_back(v);
+        }
+
+        //An edge is on a border when the opposite half edge doesn't exist
+        std::unordered_map<uint64_t, uint32_t> halfEdges;
+
+        for (size_t i = 0; i < indices.size(); i += 3)
+            for (int corner = 0; corner < 3; corner++) {
+
+                uint64_t a = weld[indices[i + corner]], b = weld[indices[i + (corner + 1) % 3]];
+                halfEdges[(a << 32) | b]++;
+            }
+
+        for (size_t i = 0; i < indices.size(); i += 3)
+            for (int corner = 0; corner < 3; corner++) {
+
+                uint32_t a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+
+                if (halfEdges.find((uint64_t(weld[b]) << 32) | weld[a]) == halfEdges.end()) {
+                    locked[a] = true;
+                    locked[b] = true;
+                }
+            }
+
+        return locked;
+    }
+
+    SimplifyResult simplifyMesh(const std::vector<uint32_t>& indices, const std::vector<float>& positions, const SimplifySettings& settings) {
+
+        SimplifyResult result{ indices, 0.0f };
+
+        size_t vertexCount = positions.size() / 3;
+
+        if (indices.size() / 3 <= settings.targetTriangleCount)
+            return result;
+
+        std::vector<bool> locked = settings.lockBorders ? findLockedVertices(indices, positions) : std::vector<bool>(vertexCount, false);
+
+        std::vector<Quadric> quadrics(vertexCount);
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+
+            const float* a = &positions[indices[i] * 3];
+
+            double normal[3], area;
+
+            if (!triangleNormal(a, &positions[indices[i + 1] * 3], &positions[indices[i + 2] * 3], normal, area))
+                continue;
+
+            double d = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+
+            for (int corner = 0; corner < 3; corner++)
+                quadrics[indices[i + corner]].addPlane(normal, d, area);
+        }
+
+        double maxErrorSquared = double(settings.maxError) * double(settings.maxError);
+        double worstError = 0.0;
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double error;
+        };
+
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+
+        std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+        std::vector<uint32_t> vertexTriangles;
+
+        std::vector<uint32_t>& current = result.indices;
+
+        //Each pass collapses a set of independent edges, cheapest first, then rebuilds the index list
+        while (current.size() / 3 > settings.targetTriangleCount) {
+
+            size_t triangleCount = current.size() / 3;
+
+            std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+
+            for (uint32_t index : current)
+                triangleOffsets[index + 1]++;
+
+            for (size_t v = 0; v < vertexCount; v++)
+                triangleOffsets[v + 1] += triangleOffsets[v];
+
+            vertexTriangles.resize(current.size());
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+
+            for (size_t t = 0; t < triangleCount; t++)
+                for (int corner = 0; corner < 3; corner++)
+                    vertexTriangles[fill[current[t * 3 + corner]]++] = static_cast<uint32_t>(t);
+
+            collapses.clear();
+
+            for (size_t i = 0; i < current.size(); i += 3)
+                for (int corner = 0; corner < 3; corner++) {
+
+                    uint32_t a = current[i + corner], b = current[i + (corner + 1) % 3];
+
+                    for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+
+                        if (locked[from])
+                            continue;
+
+                        Quadric combined = quadrics[from];
+                        combined.add(quadrics[to]);
+
+                        double error = combined.weight > 0.0 ? combined.error(&positions[to * 3]) / combined.weight : 0.0;
+
+                        if (error <= maxErrorSquared)
+                            collapses.push_back({ from, to, error });
+                    }
+                }
+
+            if (collapses.empty())
+                break;
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+            for (size_t v = 0; v < vertexCount; v++)
+                remap[v] = static_cast<uint32_t>(v);
+
+            std::fill(touched.begin(), touched.end(), false);
+
+            //Every collapse removes about two triangles
+            size_t collapseBudget = (triangleCount - settings.targetTriangleCount + 1) / 2;
+            size_t collapsed = 0;
+
+            for (const auto& collapse : collapses) {
+
+                if (collapsed >= collapseBudget)
+                    break;
+
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                //Reject collapses that flip or squash one of the triangles that survive
+                bool flips = false;
+
+                for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1] && !flips; i++) {
+
+                    const uint32_t* triangle = &current[vertexTriangles[i] * 3];
+
+                    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                        continue;
+
+                    const float* before[3];
+                    const float* after[3];
+
+                    for (int corner = 0; corner < 3; corner++) {
+
+                        before[corner] = &positions[triangle[corner] * 3];
+                        after[corner] = (triangle[corner] == collapse.from) ? &positions[collapse.to * 3] : before[corner];
+                    }
+
+                    double oldNormal[3], newNormal[3], oldArea, newArea;
+
+                    if (!triangleNormal(before[0], before[1], before[2], oldNormal, oldArea))
+                        continue;
+
+                    if (!triangleNormal(after[0], after[1], after[2], newNormal, newArea) ||
+                        oldNormal[0] * newNormal[0] + oldNormal[1] * newNormal[1] + oldNormal[2] * newNormal[2] < 0.25)
+                        flips = true;
+                }
+
+                if (flips)
+                    continue;
+
+                //Neighbours are touched too so this pass never evaluates a collapse against stale geometry
+                for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++)
+                    for (int corner = 0; corner < 3; corner++)
+                        touched[current[vertexTriangles[i] * 3 + corner]] = true;
+
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+
+                worstError = std::max(worstError, collapse.error);
+                collapsed++;
+            }
+
+            if (collapsed == 0)
+                break;
+
+            size_t write = 0;
+
+            for (size_t i = 0; i < current.size(); i += 3) {
+
+                uint32_t a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+
+                if (a == b || b == c || a == c)
+                    continue;
+
+                current[write++] = a;
+                current[write++] = b;
+                current[write++] = c;
+            }
+
+            current.resize(write);
+        }
+
+        result.error = static_cast<float>(std::sqrt(worstError));
+        return result;
+    }
+
+    void generateLodChain(const std::vector<uint32_t>& indices, const std::vector<float>& positions, float meshRadius, const LodChainSettings& settings,
+        std::vector<std::vector<uint32_t>>& lodIndices, std::vector<float>& lodErrors) {
+
+        lodIndices = { indices };
+        lodErrors = { 0.0f };
+
+        float errorBudget = meshRadius * settings.maxRelativeError;
+
+        while (lodIndices.size() < settings.maxLevels) {
+
+            const auto& previous = lodIndices.back();
+
+            size_t target = static_cast<size_t>(double(previous.size() / 3) * settings.reduction);
+
+            if (target < settings.minTriangleCount)
+                break;
+
+            SimplifySettings simplify{};
+            simplify.targetTriangleCount = target;
+            simplify.maxError = errorBudget - lodErrors.back();
+
+            SimplifyResult level = simplifyMesh(previous, positions, simplify);
+
+            //Locked borders or the error budget stopped it early, another level would be almost the same
+            if (level.indices.size() > previous.size() * 85 / 100)
+                break;
+
+            //Errors add up since each level is simplified from the previous one
+            lodErrors.push_back(lodErrors.back() + level.error);
+            lodIndices.push_back(std::move(level.indices));
+        }
+    }
+}
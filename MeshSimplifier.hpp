@@ -0,0 +1,50 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+// Offline LOD generation for the converter.
+// Quadric error edge collapse (Garland & Heckbert) that only collapses vertices onto existing neighbours,
+// so every level is just another index list into the same vertex buffer.
+
+namespace Loader {
+
+    struct SimplifySettings {
+
+        // Stop once the level has this many triangles or less
+        size_t targetTriangleCount = 0;
+
+        // Largest object space distance a collapse may introduce
+        float maxError = std::numeric_limits<float>::max();
+
+        // Border and attribute seam vertices never move, keeps holes and UV/normal splits from tearing open
+        bool lockBorders = true;
+    };
+
+    struct SimplifyResult {
+
+        std::vector<uint32_t> indices;
+
+        // Object space error of the result compared to the input, the largest collapse distance so far
+        float error = 0.0f;
+    };
+
+    SimplifyResult simplifyMesh(const std::vector<uint32_t>& indices, const std::vector<float>& positions, const SimplifySettings& settings);
+
+    struct LodChainSettings {
+
+        uint32_t maxLevels = 8;
+
+        // Each level aims for this fraction of the previous level's triangles
+        float reduction = 0.5f;
+
+        // Levels below this triangle count are not worth a draw of their own
+        size_t minTriangleCount = 64;
+
+        // Relative to the mesh radius, a level that needs more error than this is not generated
+        float maxRelativeError = 0.25f;
+    };
+
+    // LOD 0 is the input, errors are accumulated object space errors relative to LOD 0
+    void generateLodChain(const std::vector<uint32_t>& indices, const std::vector<float>& positions, float meshRadius, const LodChainSettings& settings,
+        std::vector<std::vector<uint32_t>>& lodIndices, std::vector<float>& lodErrors);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <glm/glm.hpp>
+
+namespace EggyEngine {
+
+	// local_size of hiZReduce.comp and hiZReduceMultisample.comp, 8x8, and of occlusionCull.comp
+	constexpr uint32_t DEPTH_REDUCE_WORKGROUP_SIZE = 8;
+	constexpr uint32_t OCCLUSION_CULL_WORKGROUP_SIZE = 64;
+
+	// Culling phases, one indexed indirect command per mesh draw and phase
+	constexpr uint32_t OCCLUSION_PHASE_COUNT = 2;
+
+	// Layouts shared with occlusionCull.comp, std430
+
+	struct CullDraw {
+
+		// World space bounds, w unused
+		float boundsMin[4];
+		float boundsMax[4];
+
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
+
+	static_assert(sizeof(CullDraw) == 48, "CullDraw has to match occlusionCull.comp");
+
+	// Head of the per frame cull buffer, the CullDraw array follows it
+	struct CullDataHeader {
+
+		glm::mat4 viewProjection;
+
+		// xy size of level 0, z level count, w 0 until the pyramid has been built once
+		uint32_t pyramid[4];
+
+		// x draw count
+		uint32_t counts[4];
+	};
+
+	static_assert(sizeof(CullDataHeader) == 96, "CullDataHeader has to match CullData in occlusionCull.comp");
+
+	struct DepthReduceConstants {
+
+		uint32_t sourceSize[2];
+		uint32_t destinationSize[2];
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace EggyEngine {
+
+	struct ParticleSettings {
+
+		// Particles alive at once, 0 turns the particle system off. Two buffers of 32 bytes per particle
+		uint32_t capacity = 0;
+
+		// Particles per second, the emission past capacity is dropped on the GPU
+		float emitRate = 50000.0f;
+
+		// Upper bound, every particle lives between half of it and all of it
+		float lifetime = 3.0f;
+
+		float speed = 2.0f;
+
+		// Half angle of the emission cone around +Y, radians
+		float spread = 0.35f;
+
+		// Half size of the billboards, world units
+		float size = 0.01f;
+
+		float emitter[3] = { 0.0f, 0.0f, 0.0f };
+		float gravity[3] = { 0.0f, -1.0f, 0.0f };
+	};
+
+	// local_size_x of particleSimulate.comp and particleCompact.comp, particleFinalize.comp sizes their indirect dispatch with it
+	constexpr uint32_t PARTICLE_WORKGROUP_SIZE = 64;
+
+	// Layouts shared with the particle shaders, std430
+
+	struct GpuParticle {
+
+		float positionAge[4];
+		float velocityLifetime[4];
+	};
+
+	static_assert(sizeof(GpuParticle) == 32, "GpuParticle has to match Particle in the particle shaders");
+
+	// The indirect arguments live next to the counters so one storage buffer carries all the GPU side state
+	struct ParticleCounters {
+
+		uint32_t alive[2];
+
+		VkDispatchIndirectCommand dispatch;
+		VkDrawIndirectCommand draw;
+	};
+
+	static_assert(offsetof(ParticleCounters, dispatch) == 8 && offsetof(ParticleCounters, draw) == 20, "ParticleCounters has to match the particle shaders");
+
+	struct ParticleConstants {
+
+		// xyz position, w cone half angle
+		glm::vec4 emitter;
+		// xyz acceleration, w delta time
+		glm::vec4 gravity;
+
+		float speed;
+		float lifetime;
+
+		uint32_t emitCount;
+		uint32_t capacity;
+
+		// Buffer read this frame, the other one is written
+		uint32_t source;
+		uint32_t seed;
+	};
+
+	struct ParticleDrawConstants {
+
+		glm::mat4 viewProjection;
+
+		// w of the right axis is the particle size
+		glm::vec4 cameraRight;
+		glm::vec4 cameraUp;
+	};
+}
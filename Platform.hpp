@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Everything that differs between operating systems sits behind this header. PlatformWindows.cpp and
+// PlatformPosix.cpp hold the OS calls, PlatformWindow.cpp the GLFW (Win32, X11, Wayland) and headless windows.
+
+#if defined(_WIN32)
+#define EGGY_PLATFORM_WINDOWS 1
+#elif defined(__linux__)
+#define EGGY_PLATFORM_LINUX 1
+#endif
+
+namespace Platform {
+
+    const char* name();
+
+    // Message box on Windows, stderr everywhere else. Returns, throwing is up to the caller
+    void showError(const wchar_t* message);
+
+    // 1 ms scheduler granularity while the engine runs, timeBeginPeriod on Windows. Linux timers are already fine grained
+    void beginTimerResolution();
+    void endTimerResolution();
+
+    // High resolution waitable timer on Windows, clock_nanosleep on Linux
+    void sleepFor(double seconds);
+
+    // Read only mapping of a whole file, throws std::runtime_error when it can't be opened or is empty
+    class MappedFile {
+    public:
+
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        void open(const std::string& filename);
+        void close();
+
+        const uint8_t* data() const { return _data; }
+        size_t size() const { return _size; }
+
+    private:
+
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+
+        // Windows keeps the file and mapping handles open, POSIX only needs the mapping
+        void* _fileHandle = nullptr;
+        void* _mappingHandle = nullptr;
+    };
+
+    enum class WindowBackend : uint32_t {
+        Auto,       // Native GLFW platform, headless on Linux when there's no display
+        Win32,
+        X11,
+        Wayland,
+        Headless    // No window, VK_EXT_headless_surface. For servers and profiling runs
+    };
+
+    struct WindowSettings {
+
+        WindowBackend backend = WindowBackend::Auto;
+
+        uint32_t width = 800;
+        uint32_t height = 600;
+
+        std::string title = "9/11 was a inside job";
+
+        // Headless only, the window reports it should close after this many frames. 0 runs until stopped
+        uint64_t headlessFrameLimit = 0;
+    };
+
+    class Window {
+    public:
+
+        Window() = default;
+        ~Window();
+
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+
+        void create(const WindowSettings& settings);
+        void destroy();
+
+        // The backend that was picked, never Auto once created
+        WindowBackend backend() const { return _backend; }
+        bool headless() const { return _backend == WindowBackend::Headless; }
+
+        // nullptr when headless, input callbacks are registered on it
+        GLFWwindow* glfwWindow() const { return _window; }
+
+        std::vector<const char*> requiredInstanceExtensions() const;
+        VkResult createSurface(VkInstance instance, const VkAllocationCallbacks* allocator, VkSurfaceKHR* surface) const;
+
+        bool shouldClose() const;
+        void requestClose();
+
+        void pollEvents();
+        void waitEvents(double timeout);
+
+        // Any thread, wakes up waitEvents
+        void postEmptyEvent();
+
+        void framebufferSize(int& width, int& height) const;
+
+        bool minimized() const;
+        bool visible() const;
+        bool focused() const;
+
+        // Counts frames for the headless frame limit
+        void frameSubmitted() { _framesSubmitted++; }
+
+    private:
+
+        WindowSettings _settings{};
+        WindowBackend _backend = WindowBackend::Auto;
+
+        GLFWwindow* _window = nullptr;
+
+        //Headless event loop
+        std::atomic<bool> _closeRequested = false;
+        uint64_t _framesSubmitted = 0;
+
+        std::mutex _eventMutex;
+        std::condition_variable _eventSignal;
+        bool _eventPosted = false;
+    };
+}
@@ -0,0 +1,106 @@
+#include "Platform.hpp"
+
+#if !defined(EGGY_PLATFORM_WINDOWS)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+
+namespace Platform {
+
+    const char* name() {
+
+#if defined(EGGY_PLATFORM_LINUX)
+        return "Linux";
+#else
+        return "POSIX";
+#endif
+    }
+
+    void showError(const wchar_t* message) {
+
+        //Engine messages are plain ASCII, anything else is replaced
+        std::string text;
+
+        for (const wchar_t* c = message; *c; c++)
+            text += (*c < 0x80) ? static_cast<char>(*c) : '?';
+
+        std::cerr << "Error: " << text << std::endl;
+    }
+
+    void beginTimerResolution() {}
+
+    void endTimerResolution() {}
+
+    void sleepFor(double seconds) {
+
+        if (seconds <= 0.0)
+            return;
+
+        //Absolute deadline so an interrupted sleep resumes without drifting
+        timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+        long long nanoseconds = deadline.tv_nsec + static_cast<long long>(seconds * 1e9);
+
+        deadline.tv_sec += static_cast<time_t>(nanoseconds / 1000000000);
+        deadline.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+    }
+
+//Mapped File
+
+    MappedFile::~MappedFile() {
+
+        close();
+    }
+
+    void MappedFile::open(const std::string& filename) {
+
+        close();
+
+        int file = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (file < 0)
+            throw std::runtime_error("failed to open file!");
+
+        struct stat fileInfo;
+
+        if (fstat(file, &fileInfo) != 0 || fileInfo.st_size == 0) {
+            ::close(file);
+            throw std::runtime_error("failed to open file! - file is empty");
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+        //The mapping keeps the file alive on its own
+        ::close(file);
+
+        if (view == MAP_FAILED)
+            throw std::runtime_error("failed to map file!");
+
+        //Same hint as FILE_FLAG_SEQUENTIAL_SCAN on Windows
+        madvise(view, static_cast<size_t>(fileInfo.st_size), MADV_SEQUENTIAL);
+
+        _data = static_cast<const uint8_t*>(view);
+        _size = static_cast<size_t>(fileInfo.st_size);
+    }
+
+    void MappedFile::close() {
+
+        if (_data != nullptr)
+            munmap(const_cast<uint8_t*>(_data), _size);
+
+        _data = nullptr;
+        _size = 0;
+    }
+}
+
+#endif
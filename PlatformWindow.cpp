@@ -0,0 +1,189 @@
+#include "Platform.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace Platform {
+
+    static WindowBackend resolveBackend(WindowBackend requested) {
+
+        if (requested != WindowBackend::Auto)
+            return requested;
+
+#if defined(EGGY_PLATFORM_WINDOWS)
+        return WindowBackend::Win32;
+#else
+        //Servers and CI have no display, run headless there instead of failing to open a window
+        if (std::getenv("WAYLAND_DISPLAY") == nullptr && std::getenv("DISPLAY") == nullptr)
+            return WindowBackend::Headless;
+
+        return std::getenv("WAYLAND_DISPLAY") != nullptr ? WindowBackend::Wayland : WindowBackend::X11;
+#endif
+    }
+
+    Window::~Window() {
+
+        destroy();
+    }
+
+    void Window::create(const WindowSettings& settings) {
+
+        _settings = settings;
+        _backend = resolveBackend(settings.backend);
+
+        if (_backend == WindowBackend::Headless)
+            return;
+
+#if defined(GLFW_PLATFORM)
+        //GLFW 3.4 picks X11 or Wayland at runtime, older versions were built for one of them
+        if (_backend == WindowBackend::X11 && glfwPlatformSupported(GLFW_PLATFORM_X11))
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_X11);
+        else if (_backend == WindowBackend::Wayland && glfwPlatformSupported(GLFW_PLATFORM_WAYLAND))
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
+#endif
+
+        if (glfwInit() != GLFW_TRUE)
+            throw std::runtime_error("failed to initialize glfw!");
+
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+        _window = glfwCreateWindow(static_cast<int>(settings.width), static_cast<int>(settings.height), settings.title.c_str(),
+            nullptr, //No Fullscreen
+            nullptr  //No Shared Resources
+        );
+
+        if (_window == nullptr) {
+            glfwTerminate();
+            throw std::runtime_error("Unable to create glfw window");
+        }
+
+#if defined(GLFW_PLATFORM)
+        switch (glfwGetPlatform()) {
+        case GLFW_PLATFORM_WIN32: _backend = WindowBackend::Win32; break;
+        case GLFW_PLATFORM_X11: _backend = WindowBackend::X11; break;
+        case GLFW_PLATFORM_WAYLAND: _backend = WindowBackend::Wayland; break;
+        }
+#endif
+    }
+
+    void Window::destroy() {
+
+        if (_window == nullptr)
+            return;
+
+        glfwDestroyWindow(_window);
+        glfwTerminate();
+
+        _window = nullptr;
+    }
+
+    std::vector<const char*> Window::requiredInstanceExtensions() const {
+
+        if (headless())
+            return { VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME };
+
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        return std::vector<const char*>(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
+
+    VkResult Window::createSurface(VkInstance instance, const VkAllocationCallbacks* allocator, VkSurfaceKHR* surface) const {
+
+        if (!headless())
+            return glfwCreateWindowSurface(instance, _window, allocator, surface);
+
+        auto createHeadlessSurface = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+
+        if (createHeadlessSurface == nullptr)
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+
+        VkHeadlessSurfaceCreateInfoEXT surfaceInfo{
+            .sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT,
+            .pNext = nullptr,
+            .flags = 0
+        };
+
+        return createHeadlessSurface(instance, &surfaceInfo, allocator, surface);
+    }
+
+    bool Window::shouldClose() const {
+
+        if (!headless())
+            return glfwWindowShouldClose(_window);
+
+        return _closeRequested || (_settings.headlessFrameLimit > 0 && _framesSubmitted >= _settings.headlessFrameLimit);
+    }
+
+    void Window::requestClose() {
+
+        if (!headless())
+            glfwSetWindowShouldClose(_window, GLFW_TRUE);
+
+        _closeRequested = true;
+        postEmptyEvent();
+    }
+
+    void Window::pollEvents() {
+
+        if (!headless())
+            glfwPollEvents();
+    }
+
+    void Window::waitEvents(double timeout) {
+
+        if (!headless()) {
+            glfwWaitEventsTimeout(timeout);
+            return;
+        }
+
+        //Nothing but postEmptyEvent and requestClose can wake a headless window
+        std::unique_lock lock(_eventMutex);
+
+        _eventSignal.wait_for(lock, std::chrono::duration<double>(timeout), [this] { return _eventPosted; });
+        _eventPosted = false;
+    }
+
+    void Window::postEmptyEvent() {
+
+        if (!headless()) {
+            glfwPostEmptyEvent();
+            return;
+        }
+
+        {
+            std::lock_guard lock(_eventMutex);
+            _eventPosted = true;
+        }
+
+        _eventSignal.notify_one();
+    }
+
+    void Window::framebufferSize(int& width, int& height) const {
+
+        if (!headless()) {
+            glfwGetFramebufferSize(_window, &width, &height);
+            return;
+        }
+
+        width = static_cast<int>(_settings.width);
+        height = static_cast<int>(_settings.height);
+    }
+
+    bool Window::minimized() const {
+
+        return !headless() && glfwGetWindowAttrib(_window, GLFW_ICONIFIED) == GLFW_TRUE;
+    }
+
+    bool Window::visible() const {
+
+        return headless() || glfwGetWindowAttrib(_window, GLFW_VISIBLE) == GLFW_TRUE;
+    }
+
+    bool Window::focused() const {
+
+        return headless() || glfwGetWindowAttrib(_window, GLFW_FOCUSED) == GLFW_TRUE;
+    }
+}
@@ -0,0 +1,124 @@
+#include "Platform.hpp"
+
+#if defined(EGGY_PLATFORM_WINDOWS)
+
+#include <Windows.h>
+#include <timeapi.h>
+
+#include <stdexcept>
+
+#pragma comment(lib, "winmm.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace Platform {
+
+    const char* name() {
+
+        return "Windows";
+    }
+
+    void showError(const wchar_t* message) {
+
+        MessageBoxW(NULL, message, L"Error", MB_OK | MB_ICONERROR);
+    }
+
+    void beginTimerResolution() {
+
+        timeBeginPeriod(1);
+    }
+
+    void endTimerResolution() {
+
+        timeEndPeriod(1);
+    }
+
+    void sleepFor(double seconds) {
+
+        if (seconds <= 0.0)
+            return;
+
+        //One timer per thread, high resolution timers need Windows 10 1803 and fall back to a regular one
+        thread_local HANDLE timer = [] {
+
+            HANDLE handle = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            return handle ? handle : CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }();
+
+        //Relative due time in 100 ns units
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -static_cast<LONGLONG>(seconds * 1e7);
+
+        if (timer == nullptr || !SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+            Sleep(static_cast<DWORD>(seconds * 1000.0));
+            return;
+        }
+
+        WaitForSingleObject(timer, INFINITE);
+    }
+
+//Mapped File
+
+    MappedFile::~MappedFile() {
+
+        close();
+    }
+
+    void MappedFile::open(const std::string& filename) {
+
+        close();
+
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("failed to open file!");
+
+        LARGE_INTEGER fileSize;
+
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            throw std::runtime_error("failed to open file! - file is empty");
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            throw std::runtime_error("failed to map file!");
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("failed to map file!");
+        }
+
+        _fileHandle = file;
+        _mappingHandle = mapping;
+        _data = static_cast<const uint8_t*>(view);
+        _size = static_cast<size_t>(fileSize.QuadPart);
+    }
+
+    void MappedFile::close() {
+
+        if (_data != nullptr)
+            UnmapViewOfFile(_data);
+
+        if (_mappingHandle != nullptr)
+            CloseHandle(_mappingHandle);
+
+        if (_fileHandle != nullptr)
+            CloseHandle(_fileHandle);
+
+        _data = nullptr;
+        _size = 0;
+        _fileHandle = nullptr;
+        _mappingHandle = nullptr;
+    }
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include "Profiler.hpp"
+
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler {
+
+    enum class EventType : uint32_t {
+        Zone,
+        GpuZone,
+        Frame,
+        Counter
+    };
+
+    struct Event {
+
+        const char* name;
+        uint64_t timestamp;
+
+        // Duration of zones, the bits of the value of counters
+        uint64_t payload;
+
+        EventType type;
+    };
+
+    // Written by its own thread only. count is published with release so the exporter sees every event below it
+    struct ThreadBuffer {
+
+        std::unique_ptr<Event[]> events;
+        uint32_t capacity = 0;
+
+        std::atomic<uint32_t> count{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+
+        // Session the events belong to, a buffer left from an earlier one is reset on its next event
+        std::atomic<uint64_t> session{ 0 };
+
+        uint32_t threadId = 0;
+        std::string name;
+    };
+
+    struct Registry {
+
+        std::mutex mutex;
+
+        // Never freed, a thread that exits keeps its events until the export
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+        ProfilerSettings settings{};
+
+        std::atomic<uint64_t> session{ 0 };
+        uint64_t sessionStart = 0;
+    };
+
+    //Track of the GPU zones, threads are numbered from 1
+    constexpr uint32_t GPU_THREAD_ID = 0;
+
+    static Registry& registry() {
+
+        static Registry instance;
+        return instance;
+    }
+
+    static thread_local ThreadBuffer* t_buffer = nullptr;
+
+    static ThreadBuffer& threadBuffer() {
+
+        if (t_buffer != nullptr)
+            return *t_buffer;
+
+        auto& registry = Profiler::registry();
+
+        std::lock_guard lock(registry.mutex);
+
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->threadId = static_cast<uint32_t>(registry.buffers.size()) + 1;
+
+        t_buffer = buffer.get();
+        registry.buffers.push_back(std::move(buffer));
+
+        return *t_buffer;
+    }
+
+    static void record(const Event& event) {
+
+        if (!recording())
+            return;
+
+        auto& registry = Profiler::registry();
+        auto& buffer = threadBuffer();
+
+        uint64_t session = registry.session.load(std::memory_order_acquire);
+
+        if (buffer.session.load(std::memory_order_relaxed) != session) {
+
+            //Settings only change in start(), before the session is published
+            uint32_t capacity = registry.settings.eventsPerThread;
+
+            if (buffer.capacity != capacity) {
+                buffer.events = std::make_unique<Event[]>(capacity);
+                buffer.capacity = capacity;
+            }
+
+            buffer.count.store(0, std::memory_order_relaxed);
+            buffer.dropped.store(0, std::memory_order_relaxed);
+            buffer.session.store(session, std::memory_order_release);
+        }
+
+        uint32_t index = buffer.count.load(std::memory_order_relaxed);
+
+        if (index == buffer.capacity) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer.events[index] = event;
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    void start(const ProfilerSettings& settings) {
+
+        auto& registry = Profiler::registry();
+
+        std::lock_guard lock(registry.mutex);
+
+        registry.settings = settings;
+        registry.sessionStart = now();
+        registry.session.fetch_add(1, std::memory_order_release);
+
+        recordingFlag.store(true, std::memory_order_relaxed);
+    }
+
+    void stop() {
+
+        recordingFlag.store(false, std::memory_order_relaxed);
+    }
+
+    uint64_t now() {
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void setThreadName(const char* name) {
+
+        threadBuffer().name = name;
+    }
+
+    void zone(const char* name, uint64_t start, uint64_t end) {
+
+        record({ .name = name, .timestamp = start, .payload = end - start, .type = EventType::Zone });
+    }
+
+    void frame(const char* name) {
+
+        record({ .name = name, .timestamp = now(), .payload = 0, .type = EventType::Frame });
+    }
+
+    void counter(const char* name, double value) {
+
+        record({ .name = name, .timestamp = now(), .payload = std::bit_cast<uint64_t>(value), .type = EventType::Counter });
+    }
+
+    void gpuZone(const char* name, uint64_t start, uint64_t end) {
+
+        record({ .name = name, .timestamp = start, .payload = end > start ? end - start : 0, .type = EventType::GpuZone });
+    }
+
+    ProfilerStats stats() {
+
+        auto& registry = Profiler::registry();
+
+        std::lock_guard lock(registry.mutex);
+
+        uint64_t session = registry.session.load(std::memory_order_relaxed);
+
+        ProfilerStats stats{};
+
+        for (const auto& buffer : registry.buffers) {
+
+            if (buffer->session.load(std::memory_order_acquire) != session)
+                continue;
+
+            stats.recorded += buffer->count.load(std::memory_order_acquire);
+            stats.dropped += buffer->dropped.load(std::memory_order_relaxed);
+            stats.threads++;
+        }
+
+        return stats;
+    }
+
+    //Names are literals from the code, only quotes, backslashes and control characters need escaping
+    static void writeString(std::ofstream& file, const char* text) {
+
+        file << '"';
+
+        for (const char* c = text; *c != '\0'; c++) {
+
+            if (*c == '"' || *c == '\\')
+                file << '\\' << *c;
+            else if (static_cast<unsigned char>(*c) < 0x20)
+                file << ' ';
+            else
+                file << *c;
+        }
+
+        file << '"';
+    }
+
+    static void writeThreadName(std::ofstream& file, uint32_t threadId, const char* name) {
+
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":";
+        writeString(file, name);
+        file << "}}";
+    }
+
+    bool writeChromeTrace(const std::string& path) {
+
+        auto& registry = Profiler::registry();
+
+        std::lock_guard lock(registry.mutex);
+
+        std::ofstream file(path, std::ios::trunc);
+
+        if (!file)
+            return false;
+
+        uint64_t session = registry.session.load(std::memory_order_relaxed);
+
+        //Microseconds since the session started, what trace_event timestamps are in
+        auto microseconds = [&](uint64_t timestamp) {
+            return static_cast<double>(static_cast<int64_t>(timestamp - registry.sessionStart)) / 1000.0;
+        };
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"EggyEngine\"}}";
+
+        writeThreadName(file, GPU_THREAD_ID, "GPU");
+
+        for (const auto& buffer : registry.buffers) {
+
+            if (buffer->session.load(std::memory_order_acquire) != session)
+                continue;
+
+            std::string fallbackName = "thread " + std::to_string(buffer->threadId);
+            writeThreadName(file, buffer->threadId, buffer->name.empty() ? fallbackName.c_str() : buffer->name.c_str());
+
+            uint32_t count = buffer->count.load(std::memory_order_acquire);
+
+            for (uint32_t i = 0; i < count; i++) {
+
+                const Event& event = buffer->events[i];
+
+                file << ",\n{\"name\":";
+                writeString(file, event.name);
+
+                switch (event.type) {
+
+                case EventType::Zone:
+                case EventType::GpuZone:
+                    file << ",\"cat\":\"" << (event.type == EventType::Zone ? "cpu" : "gpu") << "\",\"ph\":\"X\",\"ts\":" << microseconds(event.timestamp)
+                        << ",\"dur\":" << static_cast<double>(event.payload) / 1000.0;
+                    break;
+
+                case EventType::Frame:
+                    file << ",\"ph\":\"i\",\"s\":\"g\",\"ts\":" << microseconds(event.timestamp);
+                    break;
+
+                case EventType::Counter:
+                    file << ",\"ph\":\"C\",\"ts\":" << microseconds(event.timestamp) << ",\"args\":{\"value\":" << std::bit_cast<double>(event.payload) << '}';
+                    break;
+                }
+
+                file << ",\"pid\":1,\"tid\":" << (event.type == EventType::GpuZone ? GPU_THREAD_ID : buffer->threadId) << '}';
+            }
+
+            uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+
+            if (dropped != 0)
+                file << ",\n{\"name\":\"dropped events\",\"ph\":\"C\",\"ts\":0,\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"value\":" << dropped << "}}";
+        }
+
+        file << "\n]}\n";
+
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones, frame markers and counters, written by every thread into a buffer of its own and exported as
+// Chrome trace_event JSON for chrome://tracing or ui.perfetto.dev. Recording takes no lock, a thread only locks once
+// to register its buffer. The macros compile to nothing unless EGGY_PROFILER is defined.
+// Names are kept as pointers and have to outlive the session, string literals.
+
+namespace Profiler {
+
+#ifdef EGGY_PROFILER
+    constexpr bool enabled = true;
+#else
+    constexpr bool enabled = false;
+#endif
+
+    struct ProfilerSettings {
+
+        // Events kept per thread, 32 bytes each. Events past it are dropped and counted
+        uint32_t eventsPerThread = 1 << 18;
+    };
+
+    struct ProfilerStats {
+
+        uint64_t recorded = 0;
+        uint64_t dropped = 0;
+
+        uint32_t threads = 0;
+    };
+
+    // Starts a new session, what earlier sessions recorded is discarded
+    void start(const ProfilerSettings& settings = {});
+    void stop();
+
+    // Call after stop(), every thread that recorded has to be done with it. Returns false if the file can't be written
+    bool writeChromeTrace(const std::string& path);
+
+    ProfilerStats stats();
+
+    inline std::atomic<bool> recordingFlag{ false };
+
+    inline bool recording() { return recordingFlag.load(std::memory_order_relaxed); }
+
+    // Steady clock in nanoseconds, what every timestamp is in
+    uint64_t now();
+
+    // Shown as the track name, any time before or during the session
+    void setThreadName(const char* name);
+
+    void zone(const char* name, uint64_t start, uint64_t end);
+    void frame(const char* name);
+    void counter(const char* name, double value);
+
+    // GPU work already converted to the now() clock, shown on a track of its own
+    void gpuZone(const char* name, uint64_t start, uint64_t end);
+
+    class Zone {
+    public:
+
+        explicit Zone(const char* name) : _name(name), _active(recording()), _start(_active ? now() : 0) {}
+
+        ~Zone() {
+
+            if (_active)
+                zone(_name, _start, now());
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+
+        const char* _name;
+        bool _active;
+        uint64_t _start;
+    };
+}
+
+#ifdef EGGY_PROFILER
+
+#define EGGY_PROFILE_CONCAT_INNER(a, b) a##b
+#define EGGY_PROFILE_CONCAT(a, b) EGGY_PROFILE_CONCAT_INNER(a, b)
+
+// Until the end of the enclosing scope
+#define EGGY_PROFILE_ZONE(name) ::Profiler::Zone EGGY_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define EGGY_PROFILE_FRAME(name) do { if (::Profiler::recording()) ::Profiler::frame(name); } while (false)
+#define EGGY_PROFILE_COUNTER(name, value) do { if (::Profiler::recording()) ::Profiler::counter(name, static_cast<double>(value)); } while (false)
+#define EGGY_PROFILE_THREAD(name) ::Profiler::setThreadName(name)
+
+#else
+
+#define EGGY_PROFILE_ZONE(name) do {} while (false)
+#define EGGY_PROFILE_FRAME(name) do {} while (false)
+#define EGGY_PROFILE_COUNTER(name, value) do {} while (false)
+#define EGGY_PROFILE_THREAD(name) do {} while (false)
+
+#endif
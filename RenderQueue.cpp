@@ -0,0 +1,139 @@
+#include "RenderQueue.hpp"
+
+namespace EggyEngine {
+
+    uint32_t SortKey::quantizeDepth(float depth) {
+
+        constexpr float maxDepth = static_cast<float>((1u << DEPTH_BITS) - 1);
+
+        return static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * maxDepth);
+    }
+
+    void RenderQueue::clear() {
+
+        _entries.clear();
+        _stats = {};
+    }
+
+    void RenderQueue::sort() {
+
+        constexpr uint32_t RADIX_BITS = 8;
+        constexpr uint32_t BUCKETS = 1 << RADIX_BITS;
+        constexpr uint32_t PASSES = 64 / RADIX_BITS;
+
+        size_t count = _entries.size();
+
+        if (count < 2)
+            return;
+
+        //One read over the keys builds the histograms of every pass
+        uint32_t histograms[PASSES][BUCKETS] = {};
+
+        for (const auto& entry : _entries)
+            for (uint32_t pass = 0; pass < PASSES; pass++)
+                histograms[pass][(entry.key >> (pass * RADIX_BITS)) & (BUCKETS - 1)]++;
+
+        _sortScratch.resize(count);
+
+        Entry* source = _entries.data();
+        Entry* destination = _sortScratch.data();
+
+        for (uint32_t pass = 0; pass < PASSES; pass++) {
+
+            uint32_t shift = pass * RADIX_BITS;
+            uint32_t* histogram = histograms[pass];
+
+            //Usually the pass and pipeline bytes are the same for most of the queue
+            if (histogram[(source[0].key >> shift) & (BUCKETS - 1)] == count) {
+                _stats.sortPassesSkipped++;
+                continue;
+            }
+
+            uint32_t offset = 0;
+
+            for (uint32_t bucket = 0; bucket < BUCKETS; bucket++) {
+
+                uint32_t bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+
+            for (size_t i = 0; i < count; i++)
+                destination[histogram[(source[i].key >> shift) & (BUCKETS - 1)]++] = source[i];
+
+            std::swap(source, destination);
+        }
+
+        //An odd number of scatter passes leaves the result in the scratch buffer
+        if (source != _entries.data())
+            _entries.swap(_sortScratch);
+    }
+
+    void RenderQueue::bindPipeline(VkCommandBuffer commandBuffer, VkPipeline pipeline) {
+
+        if (pipeline == _boundPipeline) {
+            _stats.redundantBindsSkipped++;
+            return;
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+        _boundPipeline = pipeline;
+        _stats.pipelineBinds++;
+    }
+
+    void RenderQueue::bindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet) {
+
+        //Layouts come from the reflection cache, equal interfaces share the handle and keep their sets bound
+        if (set < MAX_DESCRIPTOR_SETS && descriptorSet == _boundDescriptorSets[set]) {
+            _stats.redundantBindsSkipped++;
+            return;
+        }
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &descriptorSet, 0, nullptr);
+
+        if (set < MAX_DESCRIPTOR_SETS)
+            _boundDescriptorSets[set] = descriptorSet;
+
+        _stats.descriptorBinds++;
+    }
+
+    void RenderQueue::bindVertexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) {
+
+        if (buffer == _boundVertexBuffer && offset == _boundVertexOffset) {
+            _stats.redundantBindsSkipped++;
+            return;
+        }
+
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+
+        _boundVertexBuffer = buffer;
+        _boundVertexOffset = offset;
+        _stats.vertexBufferBinds++;
+    }
+
+    void RenderQueue::bindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+
+        if (buffer == _boundIndexBuffer && offset == _boundIndexOffset && indexType == _boundIndexType) {
+            _stats.redundantBindsSkipped++;
+            return;
+        }
+
+        vkCmdBindIndexBuffer(commandBuffer, buffer, offset, indexType);
+
+        _boundIndexBuffer = buffer;
+        _boundIndexOffset = offset;
+        _boundIndexType = indexType;
+        _stats.indexBufferBinds++;
+    }
+
+    void RenderQueue::resetBindings() {
+
+        _boundPipeline = VK_NULL_HANDLE;
+        std::fill(std::begin(_boundDescriptorSets), std::end(_boundDescriptorSets), VkDescriptorSet(VK_NULL_HANDLE));
+        _boundVertexBuffer = VK_NULL_HANDLE;
+        _boundVertexOffset = 0;
+        _boundIndexBuffer = VK_NULL_HANDLE;
+        _boundIndexOffset = 0;
+    }
+}
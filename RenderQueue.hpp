@@ -0,0 +1,112 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+#include <span>
+
+namespace EggyEngine {
+
+	// 64 bit sort key, most significant field first so one integer sort orders by all of them:
+	// pass (4 bits) | pipeline (16 bits) | material (20 bits) | depth (24 bits)
+	namespace SortKey {
+
+		constexpr uint32_t PASS_BITS = 4;
+		constexpr uint32_t PIPELINE_BITS = 16;
+		constexpr uint32_t MATERIAL_BITS = 20;
+		constexpr uint32_t DEPTH_BITS = 24;
+
+		constexpr uint32_t DEPTH_SHIFT = 0;
+		constexpr uint32_t MATERIAL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+		constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+		constexpr uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+		static_assert(PASS_SHIFT + PASS_BITS == 64, "sort key fields have to fill 64 bits");
+
+		constexpr uint64_t field(uint64_t key, uint32_t shift, uint32_t bits) { return (key >> shift) & ((uint64_t(1) << bits) - 1); }
+
+		// Values wider than their field are truncated
+		constexpr uint64_t make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth) {
+
+			return (field(pass, 0, PASS_BITS) << PASS_SHIFT) | (field(pipeline, 0, PIPELINE_BITS) << PIPELINE_SHIFT) |
+				(field(material, 0, MATERIAL_BITS) << MATERIAL_SHIFT) | (field(depth, 0, DEPTH_BITS) << DEPTH_SHIFT);
+		}
+
+		constexpr uint32_t pass(uint64_t key) { return static_cast<uint32_t>(field(key, PASS_SHIFT, PASS_BITS)); }
+		constexpr uint32_t pipeline(uint64_t key) { return static_cast<uint32_t>(field(key, PIPELINE_SHIFT, PIPELINE_BITS)); }
+		constexpr uint32_t material(uint64_t key) { return static_cast<uint32_t>(field(key, MATERIAL_SHIFT, MATERIAL_BITS)); }
+		constexpr uint32_t depth(uint64_t key) { return static_cast<uint32_t>(field(key, DEPTH_SHIFT, DEPTH_BITS)); }
+
+		// Normalized view depth [0, 1] to the depth field. Front to back, invert it for back to front
+		uint32_t quantizeDepth(float depth);
+	}
+
+	struct RenderQueueStats {
+
+		uint32_t draws = 0;
+
+		// Binds that reached the command buffer and the ones skipped because the state was already bound
+		uint32_t pipelineBinds = 0;
+		uint32_t descriptorBinds = 0;
+		uint32_t vertexBufferBinds = 0;
+		uint32_t indexBufferBinds = 0;
+
+		uint32_t redundantBindsSkipped = 0;
+
+		// Radix passes skipped because every key had the same digit
+		uint32_t sortPassesSkipped = 0;
+	};
+
+	// Draws are submitted in any order as a key and an index into the caller's own draw data,
+	// sorted once per frame and then recorded in key order. Owned by the thread that records.
+	class RenderQueue {
+	public:
+
+		struct Entry {
+
+			uint64_t key;
+			uint32_t payload;
+		};
+
+		void clear();
+
+		void submit(uint64_t key, uint32_t payload) { _entries.push_back({ key, payload }); }
+
+		// Stable LSD radix sort, 8 bits per pass
+		void sort();
+
+		std::span<const Entry> entries() const { return _entries; }
+		size_t size() const { return _entries.size(); }
+
+		// Every bind goes through these, the call is dropped when the same state is already bound
+		void bindPipeline(VkCommandBuffer commandBuffer, VkPipeline pipeline);
+		void bindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet);
+		void bindVertexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset);
+		void bindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+
+		// Counts a draw recorded from the queue
+		void countDraw() { _stats.draws++; }
+
+		// Forgets the bound state, call at the start of every command buffer
+		void resetBindings();
+
+		// Counted since the last clear
+		const RenderQueueStats& stats() const { return _stats; }
+
+	private:
+
+		static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+
+		std::vector<Entry> _entries;
+		std::vector<Entry> _sortScratch;
+
+		VkPipeline _boundPipeline = VK_NULL_HANDLE;
+		VkDescriptorSet _boundDescriptorSets[MAX_DESCRIPTOR_SETS] = {};
+		VkBuffer _boundVertexBuffer = VK_NULL_HANDLE;
+		VkDeviceSize _boundVertexOffset = 0;
+		VkBuffer _boundIndexBuffer = VK_NULL_HANDLE;
+		VkDeviceSize _boundIndexOffset = 0;
+		VkIndexType _boundIndexType = VK_INDEX_TYPE_UINT16;
+
+		RenderQueueStats _stats{};
+	};
+}
@@ -0,0 +1,614 @@
+#include "ShaderReflection.hpp"
+
+namespace Shaders {
+
+    //Opcodes, decorations and storage classes from the SPIR-V spec, only the ones reflection looks at
+    constexpr uint32_t SPIRV_OP_EXECUTION_MODE = 16;
+    constexpr uint32_t SPIRV_OP_TYPE_INT = 21;
+    constexpr uint32_t SPIRV_OP_TYPE_FLOAT = 22;
+    constexpr uint32_t SPIRV_OP_TYPE_VECTOR = 23;
+    constexpr uint32_t SPIRV_OP_TYPE_MATRIX = 24;
+    constexpr uint32_t SPIRV_OP_TYPE_IMAGE = 25;
+    constexpr uint32_t SPIRV_OP_TYPE_SAMPLER = 26;
+    constexpr uint32_t SPIRV_OP_TYPE_SAMPLED_IMAGE = 27;
+    constexpr uint32_t SPIRV_OP_TYPE_ARRAY = 28;
+    constexpr uint32_t SPIRV_OP_TYPE_RUNTIME_ARRAY = 29;
+    constexpr uint32_t SPIRV_OP_TYPE_STRUCT = 30;
+    constexpr uint32_t SPIRV_OP_TYPE_POINTER = 32;
+    constexpr uint32_t SPIRV_OP_CONSTANT = 43;
+    constexpr uint32_t SPIRV_OP_VARIABLE = 59;
+    constexpr uint32_t SPIRV_OP_MEMBER_DECORATE = 72;
+
+    constexpr uint32_t SPIRV_DECORATION_BLOCK = 2;
+    constexpr uint32_t SPIRV_DECORATION_BUFFER_BLOCK = 3;
+    constexpr uint32_t SPIRV_DECORATION_ARRAY_STRIDE = 6;
+    constexpr uint32_t SPIRV_DECORATION_MATRIX_STRIDE = 7;
+    constexpr uint32_t SPIRV_DECORATION_BUILT_IN = 11;
+    constexpr uint32_t SPIRV_DECORATION_LOCATION = 30;
+    constexpr uint32_t SPIRV_DECORATION_BINDING = 33;
+    constexpr uint32_t SPIRV_DECORATION_DESCRIPTOR_SET = 34;
+    constexpr uint32_t SPIRV_DECORATION_OFFSET = 35;
+
+    constexpr uint32_t SPIRV_STORAGE_UNIFORM_CONSTANT = 0;
+    constexpr uint32_t SPIRV_STORAGE_INPUT = 1;
+    constexpr uint32_t SPIRV_STORAGE_UNIFORM = 2;
+    constexpr uint32_t SPIRV_STORAGE_PUSH_CONSTANT = 9;
+    constexpr uint32_t SPIRV_STORAGE_STORAGE_BUFFER = 12;
+
+    constexpr uint32_t SPIRV_EXECUTION_MODE_LOCAL_SIZE = 17;
+
+    constexpr uint32_t SPIRV_DIM_BUFFER = 5;
+    constexpr uint32_t SPIRV_DIM_SUBPASS_DATA = 6;
+
+    constexpr uint32_t NO_VALUE = ~0u;
+
+    // Everything the first pass finds out about one result id
+    struct SpirvId {
+
+        //Word offset of the instruction that defines it, types and constants only
+        uint32_t definition = NO_VALUE;
+
+        uint32_t location = NO_VALUE;
+        uint32_t binding = NO_VALUE;
+        uint32_t set = NO_VALUE;
+        uint32_t arrayStride = 0;
+
+        bool builtIn = false;
+        bool block = false;
+        bool bufferBlock = false;
+    };
+
+    struct SpirvModule {
+
+        const ShaderBinary& shader;
+
+        std::vector<SpirvId> ids;
+
+        //Keyed on struct id and member index
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> memberOffsets;
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> memberMatrixStrides;
+
+        const uint32_t* instruction(uint32_t id) const {
+
+            if (id >= ids.size() || ids[id].definition == NO_VALUE)
+                Debug::errorWindow(L"shader reflection found a reference to an undefined id!");
+
+            return &shader.code[ids[id].definition];
+        }
+
+        uint32_t opcode(uint32_t id) const { return instruction(id)[0] & 0xFFFF; }
+
+        uint32_t constant(uint32_t id) const {
+
+            if (opcode(id) != SPIRV_OP_CONSTANT)
+                Debug::errorWindow(L"shader reflection only supports array lengths from plain constants!");
+
+            return instruction(id)[3];
+        }
+
+        // Byte size with the offsets and strides the shader was laid out with
+        uint32_t sizeOf(uint32_t type, uint32_t matrixStride = 0) const {
+
+            const uint32_t* words = instruction(type);
+
+            switch (opcode(type)) {
+            case SPIRV_OP_TYPE_INT:
+            case SPIRV_OP_TYPE_FLOAT:
+                return words[2] / 8;
+
+            case SPIRV_OP_TYPE_VECTOR:
+                return words[3] * sizeOf(words[2]);
+
+            case SPIRV_OP_TYPE_MATRIX:
+                return words[3] * (matrixStride ? matrixStride : sizeOf(words[2]));
+
+            case SPIRV_OP_TYPE_ARRAY: {
+                uint32_t stride = ids[type].arrayStride ? ids[type].arrayStride : sizeOf(words[2]);
+                return constant(words[3]) * stride;
+            }
+
+            case SPIRV_OP_TYPE_STRUCT: {
+                uint32_t size = 0;
+                uint32_t memberCount = (words[0] >> 16) - 2;
+
+                for (uint32_t member = 0; member < memberCount; member++) {
+
+                    auto offset = memberOffsets.find({ type, member });
+                    auto stride = memberMatrixStrides.find({ type, member });
+
+                    uint32_t memberOffset = offset != memberOffsets.end() ? offset->second : size;
+                    uint32_t memberSize = sizeOf(words[2 + member], stride != memberMatrixStrides.end() ? stride->second : 0);
+
+                    size = std::max(size, memberOffset + memberSize);
+                }
+
+                return size;
+            }
+
+            default:
+                Debug::errorWindow(L"shader reflection can't size a type used in a push constant block!");
+                return 0;
+            }
+        }
+    };
+
+    static VkFormat vertexInputFormat(const SpirvModule& module, uint32_t type, uint32_t& componentCount) {
+
+        componentCount = 1;
+
+        if (module.opcode(type) == SPIRV_OP_TYPE_VECTOR) {
+
+            componentCount = module.instruction(type)[3];
+            type = module.instruction(type)[2];
+        }
+
+        const uint32_t* scalar = module.instruction(type);
+        uint32_t scalarOpcode = module.opcode(type);
+
+        if ((scalarOpcode != SPIRV_OP_TYPE_FLOAT && scalarOpcode != SPIRV_OP_TYPE_INT) || scalar[2] != 32 || componentCount < 1 || componentCount > 4) {
+            Debug::errorWindow(L"shader reflection only supports 32 bit scalar and vector vertex inputs!");
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        static constexpr VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        static constexpr VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+        static constexpr VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+        if (scalarOpcode == SPIRV_OP_TYPE_FLOAT)
+            return floatFormats[componentCount - 1];
+
+        //OpTypeInt: width, signedness
+        return scalar[3] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+    }
+
+    static VkDescriptorType descriptorType(const SpirvModule& module, uint32_t storageClass, uint32_t type) {
+
+        switch (storageClass) {
+        case SPIRV_STORAGE_UNIFORM:
+            if (module.ids[type].bufferBlock)
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+        case SPIRV_STORAGE_STORAGE_BUFFER:
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+        case SPIRV_STORAGE_UNIFORM_CONSTANT: {
+            const uint32_t* words = module.instruction(type);
+
+            switch (module.opcode(type)) {
+            case SPIRV_OP_TYPE_SAMPLER:
+                return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+            case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+                return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+            case SPIRV_OP_TYPE_IMAGE:
+                //OpTypeImage: sampled type, dim, depth, arrayed, multisampled, sampled (1 sampled, 2 storage)
+                if (words[3] == SPIRV_DIM_SUBPASS_DATA)
+                    return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+
+                if (words[3] == SPIRV_DIM_BUFFER)
+                    return words[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+
+                return words[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+
+            break;
+        }
+        }
+
+        Debug::errorWindow(L"shader reflection found a resource it has no descriptor type for!");
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+
+    ShaderReflection reflectShader(const ShaderBinary& shader) {
+
+        //Header word 3 is the id bound, every id is below it
+        SpirvModule module{ shader, std::vector<SpirvId>(shader.code[3]) };
+
+        ShaderReflection reflection{};
+        reflection.stage = shader.stage;
+
+        struct Variable {
+            uint32_t id;
+            uint32_t pointerType;
+            uint32_t storageClass;
+        };
+
+        std::vector<Variable> variables;
+
+        for (size_t word = SPIRV_HEADER_WORDS; word < shader.wordCount;) {
+
+            const uint32_t* words = &shader.code[word];
+
+            uint32_t instructionWords = words[0] >> 16;
+            uint32_t opcode = words[0] & 0xFFFF;
+
+            switch (opcode) {
+            case SPIRV_OP_EXECUTION_MODE:
+                if (words[2] == SPIRV_EXECUTION_MODE_LOCAL_SIZE)
+                    for (int axis = 0; axis < 3; axis++)
+                        reflection.workgroupSize[axis] = words[3 + axis];
+                break;
+
+            case SPIRV_OP_DECORATE: {
+                SpirvId& target = module.ids[words[1]];
+
+                switch (words[2]) {
+                case SPIRV_DECORATION_BLOCK: target.block = true; break;
+                case SPIRV_DECORATION_BUFFER_BLOCK: target.bufferBlock = true; break;
+                case SPIRV_DECORATION_ARRAY_STRIDE: target.arrayStride = words[3]; break;
+                case SPIRV_DECORATION_BUILT_IN: target.builtIn = true; break;
+                case SPIRV_DECORATION_LOCATION: target.location = words[3]; break;
+                case SPIRV_DECORATION_BINDING: target.binding = words[3]; break;
+                case SPIRV_DECORATION_DESCRIPTOR_SET: target.set = words[3]; break;
+                }
+                break;
+            }
+
+            case SPIRV_OP_MEMBER_DECORATE:
+                if (words[3] == SPIRV_DECORATION_OFFSET)
+                    module.memberOffsets[{ words[1], words[2] }] = words[4];
+                else if (words[3] == SPIRV_DECORATION_MATRIX_STRIDE)
+                    module.memberMatrixStrides[{ words[1], words[2] }] = words[4];
+                break;
+
+            case SPIRV_OP_TYPE_INT:
+            case SPIRV_OP_TYPE_FLOAT:
+            case SPIRV_OP_TYPE_VECTOR:
+            case SPIRV_OP_TYPE_MATRIX:
+            case SPIRV_OP_TYPE_IMAGE:
+            case SPIRV_OP_TYPE_SAMPLER:
+            case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            case SPIRV_OP_TYPE_ARRAY:
+            case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+            case SPIRV_OP_TYPE_STRUCT:
+            case SPIRV_OP_TYPE_POINTER:
+                module.ids[words[1]].definition = static_cast<uint32_t>(word);
+                break;
+
+            case SPIRV_OP_CONSTANT:
+                module.ids[words[2]].definition = static_cast<uint32_t>(word);
+                break;
+
+            case SPIRV_OP_VARIABLE:
+                variables.push_back({ words[2], words[1], words[3] });
+                break;
+            }
+
+            word += instructionWords;
+        }
+
+        for (const auto& variable : variables) {
+
+            const SpirvId& decorations = module.ids[variable.id];
+
+            //OpTypePointer: storage class, pointee
+            uint32_t type = module.instruction(variable.pointerType)[3];
+
+            switch (variable.storageClass) {
+            case SPIRV_STORAGE_INPUT: {
+                if (shader.stage != VK_SHADER_STAGE_VERTEX_BIT || decorations.builtIn || decorations.location == NO_VALUE)
+                    break;
+
+                VertexInput input{ .location = decorations.location };
+                input.format = vertexInputFormat(module, type, input.componentCount);
+
+                reflection.vertexInputs.push_back(input);
+                break;
+            }
+
+            case SPIRV_STORAGE_PUSH_CONSTANT: {
+                uint32_t offset = NO_VALUE;
+
+                for (const auto& [member, memberOffset] : module.memberOffsets)
+                    if (member.first == type)
+                        offset = std::min(offset, memberOffset);
+
+                reflection.pushConstants = {
+                    .stageFlags = static_cast<VkShaderStageFlags>(shader.stage),
+                    .offset = offset == NO_VALUE ? 0 : offset,
+                    .size = module.sizeOf(type) - (offset == NO_VALUE ? 0 : offset)
+                };
+                break;
+            }
+
+            case SPIRV_STORAGE_UNIFORM:
+            case SPIRV_STORAGE_UNIFORM_CONSTANT:
+            case SPIRV_STORAGE_STORAGE_BUFFER: {
+                if (decorations.binding == NO_VALUE)
+                    break;
+
+                uint32_t count = 1;
+
+                while (module.opcode(type) == SPIRV_OP_TYPE_ARRAY || module.opcode(type) == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+
+                    if (module.opcode(type) == SPIRV_OP_TYPE_RUNTIME_ARRAY)
+                        Debug::errorWindow(L"shader reflection doesn't support unbounded descriptor arrays!");
+
+                    count *= module.constant(module.instruction(type)[3]);
+                    type = module.instruction(type)[2];
+                }
+
+                reflection.bindings.push_back({
+                    .set = decorations.set == NO_VALUE ? 0 : decorations.set,
+                    .binding = decorations.binding,
+                    .type = descriptorType(module, variable.storageClass, type),
+                    .count = count,
+                    .stages = static_cast<VkShaderStageFlags>(shader.stage)
+                });
+                break;
+            }
+            }
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+
+        std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const VertexInput& a, const VertexInput& b) {
+            return a.location < b.location;
+        });
+
+        uint32_t stride = 0;
+
+        for (const auto& input : reflection.vertexInputs) {
+
+            reflection.vertexAttributes.push_back({
+                .location = input.location,
+                .binding = 0,
+                .format = input.format,
+                .offset = stride
+            });
+
+            stride += input.componentCount * 4;
+        }
+
+        reflection.vertexBinding = {
+            .binding = 0,
+            .stride = stride,
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        };
+
+        return reflection;
+    }
+
+    uint32_t formatComponentCount(VkFormat format) {
+
+        switch (format) {
+        case VK_FORMAT_R32_SFLOAT:
+        case VK_FORMAT_R32_SINT:
+        case VK_FORMAT_R32_UINT:
+            return 1;
+
+        case VK_FORMAT_R8G8_SNORM:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+        case VK_FORMAT_R32G32_SINT:
+        case VK_FORMAT_R32G32_UINT:
+            return 2;
+
+        case VK_FORMAT_R32G32B32_SFLOAT:
+        case VK_FORMAT_R32G32B32_SINT:
+        case VK_FORMAT_R32G32B32_UINT:
+            return 3;
+
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+        case VK_FORMAT_R32G32B32A32_SINT:
+        case VK_FORMAT_R32G32B32A32_UINT:
+            return 4;
+
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t formatSize(VkFormat format) {
+
+        switch (format) {
+        case VK_FORMAT_R8G8_SNORM:
+            return 2;
+
+        case VK_FORMAT_R32_SFLOAT:
+        case VK_FORMAT_R32_SINT:
+        case VK_FORMAT_R32_UINT:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+            return 4;
+
+        case VK_FORMAT_R32G32_SFLOAT:
+        case VK_FORMAT_R32G32_SINT:
+        case VK_FORMAT_R32G32_UINT:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+
+        case VK_FORMAT_R32G32B32_SFLOAT:
+        case VK_FORMAT_R32G32B32_SINT:
+        case VK_FORMAT_R32G32B32_UINT:
+            return 12;
+
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+        case VK_FORMAT_R32G32B32A32_SINT:
+        case VK_FORMAT_R32G32B32A32_UINT:
+            return 16;
+
+        default:
+            return 0;
+        }
+    }
+
+    const ShaderReflection& PipelineLayoutCache::reflection(ShaderId shader) {
+
+        auto& cached = _reflections[static_cast<size_t>(shader)];
+
+        if (!cached)
+            cached = reflectShader(get(shader));
+
+        return *cached;
+    }
+
+    VkDescriptorSetLayout PipelineLayoutCache::descriptorSetLayout(std::span<const DescriptorBinding> bindings) {
+
+        std::vector<uint32_t> key;
+
+        for (const auto& binding : bindings)
+            key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.type), binding.count, static_cast<uint32_t>(binding.stages) });
+
+        auto cached = _descriptorSetLayouts.find(key);
+
+        if (cached != _descriptorSetLayouts.end())
+            return cached->second;
+
+        std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+
+        for (const auto& binding : bindings)
+            layoutBindings.push_back({
+                .binding = binding.binding,
+                .descriptorType = binding.type,
+                .descriptorCount = binding.count,
+                .stageFlags = binding.stages,
+                .pImmutableSamplers = nullptr
+            });
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .bindingCount = static_cast<uint32_t>(layoutBindings.size()),
+            .pBindings = layoutBindings.data()
+        };
+
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+
+        if (vkCreateDescriptorSetLayout(_device, &layoutInfo, _allocator, &layout) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create descriptor set layout!");
+
+        _descriptorSetLayouts.emplace(std::move(key), layout);
+
+        return layout;
+    }
+
+    VkPipelineLayout PipelineLayoutCache::pipelineLayout(std::span<const ShaderId> shaders) {
+
+        std::vector<DescriptorBinding> bindings;
+        VkPushConstantRange pushConstants{};
+
+        for (ShaderId shader : shaders) {
+
+            const ShaderReflection& stage = reflection(shader);
+
+            for (const auto& binding : stage.bindings) {
+
+                auto merged = std::find_if(bindings.begin(), bindings.end(), [&](const DescriptorBinding& other) {
+                    return other.set == binding.set && other.binding == binding.binding;
+                });
+
+                if (merged == bindings.end()) {
+                    bindings.push_back(binding);
+                    continue;
+                }
+
+                if (merged->type != binding.type || merged->count != binding.count)
+                    Debug::errorWindow(L"two shader stages declare different resources on the same binding!");
+
+                merged->stages |= binding.stages;
+            }
+
+            if (stage.pushConstants.size == 0)
+                continue;
+
+            //One range covering every stage, so a single vkCmdPushConstants reaches all of them
+            if (pushConstants.size == 0) {
+                pushConstants = stage.pushConstants;
+                continue;
+            }
+
+            uint32_t end = std::max(pushConstants.offset + pushConstants.size, stage.pushConstants.offset + stage.pushConstants.size);
+
+            pushConstants.stageFlags |= stage.pushConstants.stageFlags;
+            pushConstants.offset = std::min(pushConstants.offset, stage.pushConstants.offset);
+            pushConstants.size = end - pushConstants.offset;
+        }
+
+        std::sort(bindings.begin(), bindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+
+        uint32_t setCount = bindings.empty() ? 0 : bindings.back().set + 1;
+
+        std::vector<VkDescriptorSetLayout> setLayouts;
+
+        for (uint32_t set = 0; set < setCount; set++) {
+
+            auto first = std::find_if(bindings.begin(), bindings.end(), [&](const DescriptorBinding& binding) { return binding.set == set; });
+            auto last = std::find_if(first, bindings.end(), [&](const DescriptorBinding& binding) { return binding.set != set; });
+
+            setLayouts.push_back(descriptorSetLayout({ first, last }));
+        }
+
+        std::vector<uint64_t> key;
+
+        for (auto setLayout : setLayouts)
+            key.push_back(reinterpret_cast<uint64_t>(setLayout));
+
+        key.insert(key.end(), { pushConstants.stageFlags, pushConstants.offset, pushConstants.size });
+
+        auto cached = _pipelineLayouts.find(key);
+
+        if (cached != _pipelineLayouts.end())
+            return cached->second;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+            .pushConstantRangeCount = pushConstants.size ? 1u : 0u,
+            .pPushConstantRanges = pushConstants.size ? &pushConstants : nullptr
+        };
+
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+
+        if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, _allocator, &layout) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create pipeline layout!");
+
+        _pipelineLayouts.emplace(std::move(key), layout);
+        _pipelineSetLayouts.emplace(layout, std::move(setLayouts));
+
+        return layout;
+    }
+
+    std::span<const VkDescriptorSetLayout> PipelineLayoutCache::setLayouts(VkPipelineLayout layout) const {
+
+        auto found = _pipelineSetLayouts.find(layout);
+
+        if (found == _pipelineSetLayouts.end())
+            return {};
+
+        return found->second;
+    }
+
+    void PipelineLayoutCache::destroy() {
+
+        for (auto& [key, layout] : _pipelineLayouts)
+            vkDestroyPipelineLayout(_device, layout, _allocator);
+
+        for (auto& [key, layout] : _descriptorSetLayouts)
+            vkDestroyDescriptorSetLayout(_device, layout, _allocator);
+
+        _pipelineLayouts.clear();
+        _pipelineSetLayouts.clear();
+        _descriptorSetLayouts.clear();
+
+        for (auto& reflection : _reflections)
+            reflection.reset();
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+#include "ShaderRegistry.hpp"
+
+#include <map>
+#include <optional>
+#include <span>
+
+// Reads descriptor bindings, push constants, vertex inputs and workgroup sizes straight from the SPIR-V words,
+// so pipeline layouts and vertex input state follow the shaders instead of being written by hand.
+
+namespace Shaders {
+
+    struct DescriptorBinding {
+
+        uint32_t set = 0;
+        uint32_t binding = 0;
+
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uint32_t count = 1;
+
+        VkShaderStageFlags stages = 0;
+
+        bool operator==(const DescriptorBinding& other) const = default;
+    };
+
+    struct VertexInput {
+
+        uint32_t location = 0;
+
+        // 32 bit format of the shader side type, the buffer may hold anything the format converts from
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t componentCount = 0;
+    };
+
+    struct ShaderReflection {
+
+        VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+
+        // Sorted by set then binding
+        std::vector<DescriptorBinding> bindings;
+
+        // Size 0 when the stage has no push constant block
+        VkPushConstantRange pushConstants{};
+
+        // Vertex stage only, sorted by location
+        std::vector<VertexInput> vertexInputs;
+
+        // Tightly packed layout of vertexInputs in binding 0, for shaders fed from plain float buffers
+        VkVertexInputBindingDescription vertexBinding{};
+        std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+        // Compute stage only, LocalSize execution mode
+        uint32_t workgroupSize[3] = { 1, 1, 1 };
+    };
+
+    // Anything it can't follow goes through Debug::errorWindow
+    ShaderReflection reflectShader(const ShaderBinary& shader);
+
+    uint32_t formatComponentCount(VkFormat format);
+
+    // Bytes per element of a vertex format, 0 for the ones formatComponentCount doesn't know either
+    uint32_t formatSize(VkFormat format);
+
+    // Owns every descriptor set layout and pipeline layout built from reflection. Layouts are keyed on their
+    // contents, so two pipelines whose shaders declare the same interface get the very same handles and
+    // descriptor sets bound for one stay valid for the other.
+    class PipelineLayoutCache {
+    public:
+
+        // allocator is passed to every create and destroy, nullptr for the driver's own
+        void init(VkDevice device, const VkAllocationCallbacks* allocator) {
+            _device = device;
+            _allocator = allocator;
+        }
+        void destroy();
+
+        // Parsed on first use
+        const ShaderReflection& reflection(ShaderId shader);
+
+        VkDescriptorSetLayout descriptorSetLayout(std::span<const DescriptorBinding> bindings);
+
+        // Merges the interface of every stage, gaps between used sets get an empty set layout
+        VkPipelineLayout pipelineLayout(std::span<const ShaderId> shaders);
+
+        // Set layouts of a pipeline layout from this cache, in set order
+        std::span<const VkDescriptorSetLayout> setLayouts(VkPipelineLayout layout) const;
+
+        size_t descriptorSetLayoutCount() const { return _descriptorSetLayouts.size(); }
+        size_t pipelineLayoutCount() const { return _pipelineLayouts.size(); }
+
+    private:
+
+        VkDevice _device = VK_NULL_HANDLE;
+        const VkAllocationCallbacks* _allocator = nullptr;
+
+        std::optional<ShaderReflection> _reflections[static_cast<size_t>(ShaderId::Count)];
+
+        // Keys are the layouts flattened to words, equal contents means equal keys
+        std::map<std::vector<uint32_t>, VkDescriptorSetLayout> _descriptorSetLayouts;
+        std::map<std::vector<uint64_t>, VkPipelineLayout> _pipelineLayouts;
+
+        std::map<VkPipelineLayout, std::vector<VkDescriptorSetLayout>> _pipelineSetLayouts;
+    };
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+
+// SPIR-V compiled by compileShader.bat (glslc -mfmt=num) and embedded at build time.
+// A shader that failed to compile leaves its .inc missing and the build stops here instead of at startup,
+// and every binary is checked at compile time for the SPIR-V magic and the stage of its entry point.
+
+namespace Shaders {
+
+    enum class ShaderId : uint32_t {
+        SimpleTriangleVert,
+        SimpleTriangleFrag,
+        MeshVert,
+        MeshFrag,
+        DepthPrepassVert,
+        DepthPrepassFrag,
+        Sprite2DVert,
+        Sprite2DFrag,
+        ParticleEmitComp,
+        ParticleSimulateComp,
+        ParticleCompactComp,
+        ParticleFinalizeComp,
+        ParticleVert,
+        ParticleFrag,
+        LightClusterComp,
+        HiZReduceComp,
+        HiZReduceMultisampleComp,
+        OcclusionCullComp,
+        Count
+    };
+
+    alignas(16) inline constexpr uint32_t simpletriangleShaderVert[] = {
+        #include "simpletriangleShader.vert.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t simpletriangleShaderFrag[] = {
+        #include "simpletriangleShader.frag.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t meshShaderVert[] = {
+        #include "meshShader.vert.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t meshShaderFrag[] = {
+        #include "meshShader.frag.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t depthPrepassVert[] = {
+        #include "depthPrepass.vert.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t depthPrepassFrag[] = {
+        #include "depthPrepass.frag.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t sprite2DVert[] = {
+        #include "sprite2D.vert.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t sprite2DFrag[] = {
+        #include "sprite2D.frag.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t particleEmitComp[] = {
+        #include "particleEmit.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t particleSimulateComp[] = {
+        #include "particleSimulate.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t particleCompactComp[] = {
+        #include "particleCompact.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t particleFinalizeComp[] = {
+        #include "particleFinalize.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t particleVert[] = {
+        #include "particle.vert.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t particleFrag[] = {
+        #include "particle.frag.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t lightClusterComp[] = {
+        #include "lightCluster.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t hiZReduceComp[] = {
+        #include "hiZReduce.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t hiZReduceMultisampleComp[] = {
+        #include "hiZReduceMultisample.comp.inc"
+    };
+
+    alignas(16) inline constexpr uint32_t occlusionCullComp[] = {
+        #include "occlusionCull.comp.inc"
+    };
+
+    struct ShaderBinary {
+
+        ShaderId id;
+        VkShaderStageFlagBits stage;
+
+        const uint32_t* code;
+        size_t wordCount;
+
+        const char* name;
+
+        size_t codeSize() const { return wordCount * sizeof(uint32_t); }
+    };
+
+    template <size_t N>
+    constexpr ShaderBinary makeShaderBinary(ShaderId id, VkShaderStageFlagBits stage, const uint32_t(&code)[N], const char* name) {
+        return { id, stage, code, N, name };
+    }
+
+    // Same order as ShaderId, checked below
+    inline constexpr ShaderBinary registry[] = {
+        makeShaderBinary(ShaderId::SimpleTriangleVert, VK_SHADER_STAGE_VERTEX_BIT, simpletriangleShaderVert, "simpletriangleShader.vert"),
+        makeShaderBinary(ShaderId::SimpleTriangleFrag, VK_SHADER_STAGE_FRAGMENT_BIT, simpletriangleShaderFrag, "simpletriangleShader.frag"),
+        makeShaderBinary(ShaderId::MeshVert, VK_SHADER_STAGE_VERTEX_BIT, meshShaderVert, "meshShader.vert"),
+        makeShaderBinary(ShaderId::MeshFrag, VK_SHADER_STAGE_FRAGMENT_BIT, meshShaderFrag, "meshShader.frag"),
+        makeShaderBinary(ShaderId::DepthPrepassVert, VK_SHADER_STAGE_VERTEX_BIT, depthPrepassVert, "depthPrepass.vert"),
+        makeShaderBinary(ShaderId::DepthPrepassFrag, VK_SHADER_STAGE_FRAGMENT_BIT, depthPrepassFrag, "depthPrepass.frag"),
+        makeShaderBinary(ShaderId::Sprite2DVert, VK_SHADER_STAGE_VERTEX_BIT, sprite2DVert, "sprite2D.vert"),
+        makeShaderBinary(ShaderId::Sprite2DFrag, VK_SHADER_STAGE_FRAGMENT_BIT, sprite2DFrag, "sprite2D.frag"),
+        makeShaderBinary(ShaderId::ParticleEmitComp, VK_SHADER_STAGE_COMPUTE_BIT, particleEmitComp, "particleEmit.comp"),
+        makeShaderBinary(ShaderId::ParticleSimulateComp, VK_SHADER_STAGE_COMPUTE_BIT, particleSimulateComp, "particleSimulate.comp"),
+        makeShaderBinary(ShaderId::ParticleCompactComp, VK_SHADER_STAGE_COMPUTE_BIT, particleCompactComp, "particleCompact.comp"),
+        makeShaderBinary(ShaderId::ParticleFinalizeComp, VK_SHADER_STAGE_COMPUTE_BIT, particleFinalizeComp, "particleFinalize.comp"),
+        makeShaderBinary(ShaderId::ParticleVert, VK_SHADER_STAGE_VERTEX_BIT, particleVert, "particle.vert"),
+        makeShaderBinary(ShaderId::ParticleFrag, VK_SHADER_STAGE_FRAGMENT_BIT, particleFrag, "particle.frag"),
+        makeShaderBinary(ShaderId::LightClusterComp, VK_SHADER_STAGE_COMPUTE_BIT, lightClusterComp, "lightCluster.comp"),
+        makeShaderBinary(ShaderId::HiZReduceComp, VK_SHADER_STAGE_COMPUTE_BIT, hiZReduceComp, "hiZReduce.comp"),
+        makeShaderBinary(ShaderId::HiZReduceMultisampleComp, VK_SHADER_STAGE_COMPUTE_BIT, hiZReduceMultisampleComp, "hiZReduceMultisample.comp"),
+        makeShaderBinary(ShaderId::OcclusionCullComp, VK_SHADER_STAGE_COMPUTE_BIT, occlusionCullComp, "occlusionCull.comp")
+    };
+
+    // Compile time validation
+
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+    constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+    constexpr uint32_t SPIRV_OP_ENTRY_POINT = 15;
+
+    constexpr uint32_t executionModel(VkShaderStageFlagBits stage) {
+
+        switch (stage) {
+        case VK_SHADER_STAGE_VERTEX_BIT: return 0;
+        case VK_SHADER_STAGE_FRAGMENT_BIT: return 4;
+        case VK_SHADER_STAGE_COMPUTE_BIT: return 5;
+        default: return ~0u;
+        }
+    }
+
+    // Walks the instruction stream and checks every OpEntryPoint "main" has the execution model of the stage
+    constexpr bool isValidShader(const ShaderBinary& shader) {
+
+        if (shader.wordCount <= SPIRV_HEADER_WORDS || shader.code[0] != SPIRV_MAGIC)
+            return false;
+
+        bool foundMain = false;
+
+        for (size_t word = SPIRV_HEADER_WORDS; word < shader.wordCount;) {
+
+            uint32_t instructionWords = shader.code[word] >> 16;
+            uint32_t opcode = shader.code[word] & 0xFFFF;
+
+            if (instructionWords == 0 || word + instructionWords > shader.wordCount)
+                return false;
+
+            //OpEntryPoint: model, function id, then the name as a null terminated string, "main" is 0x6E69616D
+            if (opcode == SPIRV_OP_ENTRY_POINT && instructionWords > 3 && shader.code[word + 3] == 0x6E69616D) {
+
+                if (shader.code[word + 1] != executionModel(shader.stage))
+                    return false;
+
+                foundMain = true;
+            }
+
+            word += instructionWords;
+        }
+
+        return foundMain;
+    }
+
+    constexpr uint32_t SPIRV_OP_DECORATE = 71;
+    constexpr uint32_t SPIRV_DECORATION_SPEC_ID = 1;
+
+    // True when the module has a specialization constant with this constant_id
+    constexpr bool declaresSpecConstant(const ShaderBinary& shader, uint32_t constantId) {
+
+        for (size_t word = SPIRV_HEADER_WORDS; word < shader.wordCount;) {
+
+            uint32_t instructionWords = shader.code[word] >> 16;
+            uint32_t opcode = shader.code[word] & 0xFFFF;
+
+            if (instructionWords == 0 || word + instructionWords > shader.wordCount)
+                return false;
+
+            //OpDecorate: target, decoration, literal
+            if (opcode == SPIRV_OP_DECORATE && instructionWords == 4 && shader.code[word + 2] == SPIRV_DECORATION_SPEC_ID && shader.code[word + 3] == constantId)
+                return true;
+
+            word += instructionWords;
+        }
+
+        return false;
+    }
+
+    constexpr bool registryIsValid() {
+
+        if (std::size(registry) != static_cast<size_t>(ShaderId::Count))
+            return false;
+
+        for (size_t i = 0; i < std::size(registry); i++)
+            if (registry[i].id != static_cast<ShaderId>(i) || !isValidShader(registry[i]))
+                return false;
+
+        return true;
+    }
+
+    static_assert(registryIsValid(), "embedded SPIR-V is missing, out of order or compiled for the wrong stage, rerun compileShader.bat");
+
+    template <ShaderId id>
+    constexpr const ShaderBinary& get() {
+
+        static_assert(id < ShaderId::Count, "unknown shader id");
+        return registry[static_cast<size_t>(id)];
+    }
+
+    constexpr const ShaderBinary& get(ShaderId id) {
+
+        return registry[static_cast<size_t>(id)];
+    }
+}
@@ -0,0 +1,110 @@
+#include "ShaderVariant.hpp"
+
+#include <cstring>
+
+namespace Shaders {
+
+    uint64_t hashCombine(uint64_t seed, uint64_t value) {
+
+        //splitmix style finalizer so close values don't land on close hashes
+        value += 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        value ^= value >> 31;
+
+        return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+    }
+
+    ShaderVariant& ShaderVariant::setWord(uint32_t constantId, uint32_t word) {
+
+        auto position = std::lower_bound(_ids.begin(), _ids.end(), constantId);
+        size_t index = position - _ids.begin();
+
+        if (position != _ids.end() && *position == constantId) {
+            _data[index] = word;
+            return *this;
+        }
+
+        _ids.insert(position, constantId);
+        _data.insert(_data.begin() + index, word);
+
+        return *this;
+    }
+
+    ShaderVariant& ShaderVariant::set(uint32_t constantId, uint32_t value) {
+
+        return setWord(constantId, value);
+    }
+
+    ShaderVariant& ShaderVariant::set(uint32_t constantId, int32_t value) {
+
+        return setWord(constantId, static_cast<uint32_t>(value));
+    }
+
+    ShaderVariant& ShaderVariant::set(uint32_t constantId, float value) {
+
+        uint32_t word;
+        std::memcpy(&word, &value, sizeof(word));
+
+        return setWord(constantId, word);
+    }
+
+    ShaderVariant& ShaderVariant::set(uint32_t constantId, bool value) {
+
+        return setWord(constantId, value ? VK_TRUE : VK_FALSE);
+    }
+
+    uint64_t ShaderVariant::hash() const {
+
+        uint64_t result = 0;
+
+        for (size_t i = 0; i < _ids.size(); i++)
+            result = hashCombine(hashCombine(result, _ids[i]), _data[i]);
+
+        return result;
+    }
+
+    const VkSpecializationInfo* ShaderVariant::specializationInfo() {
+
+        if (empty())
+            return nullptr;
+
+        _entries.resize(_ids.size());
+
+        for (size_t i = 0; i < _ids.size(); i++)
+            _entries[i] = {
+                .constantID = _ids[i],
+                .offset = static_cast<uint32_t>(i * sizeof(uint32_t)),
+                .size = sizeof(uint32_t)
+            };
+
+        _info = {
+            .mapEntryCount = static_cast<uint32_t>(_entries.size()),
+            .pMapEntries = _entries.data(),
+            .dataSize = _data.size() * sizeof(uint32_t),
+            .pData = _data.data()
+        };
+
+        return &_info;
+    }
+
+    bool ShaderVariant::matches(const ShaderBinary& shader) const {
+
+        for (uint32_t id : _ids)
+            if (!declaresSpecConstant(shader, id))
+                return false;
+
+        return true;
+    }
+
+    size_t PipelineKeyHash::operator()(const PipelineKey& key) const {
+
+        uint64_t result = hashCombine(static_cast<uint64_t>(key.vertexShader), static_cast<uint64_t>(key.fragmentShader));
+
+        result = hashCombine(result, key.vertexVariant);
+        result = hashCombine(result, key.fragmentVariant);
+        result = hashCombine(result, key.stateHash);
+
+        return static_cast<size_t>(result);
+    }
+}
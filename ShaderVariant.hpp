@@ -0,0 +1,66 @@
+#pragma once
+
+#include "HelperNamespaces.hpp"
+#include "ShaderRegistry.hpp"
+
+// Shader variants through specialization constants: one SPIR-V module, the values are baked in when the
+// pipeline is created so the driver folds the branches away. Every variant has a hash for pipeline keys.
+
+namespace Shaders {
+
+    // Every constant is 4 bytes: uint, int, float or bool (VkBool32)
+    class ShaderVariant {
+    public:
+
+        ShaderVariant& set(uint32_t constantId, uint32_t value);
+        ShaderVariant& set(uint32_t constantId, int32_t value);
+        ShaderVariant& set(uint32_t constantId, float value);
+        ShaderVariant& set(uint32_t constantId, bool value);
+
+        bool empty() const { return _ids.empty(); }
+
+        // Order independent, two variants with the same constants hash the same
+        uint64_t hash() const;
+
+        // nullptr when empty. Points into this object, keep it alive until the pipeline is created
+        const VkSpecializationInfo* specializationInfo();
+
+        // Every constant has to be declared in the module, catches typos in constant ids
+        bool matches(const ShaderBinary& shader) const;
+
+        bool operator==(const ShaderVariant& other) const { return _ids == other._ids && _data == other._data; }
+
+    private:
+
+        ShaderVariant& setWord(uint32_t constantId, uint32_t word);
+
+        // Sorted by constant id
+        std::vector<uint32_t> _ids;
+        std::vector<uint32_t> _data;
+
+        std::vector<VkSpecializationMapEntry> _entries;
+        VkSpecializationInfo _info{};
+    };
+
+    // Everything that makes two graphics pipelines different
+    struct PipelineKey {
+
+        ShaderId vertexShader = ShaderId::Count;
+        ShaderId fragmentShader = ShaderId::Count;
+
+        uint64_t vertexVariant = 0;
+        uint64_t fragmentVariant = 0;
+
+        // Fixed function state that differs between pipelines, vertex layout and render pass for now
+        uint64_t stateHash = 0;
+
+        bool operator==(const PipelineKey& other) const = default;
+    };
+
+    struct PipelineKeyHash {
+
+        size_t operator()(const PipelineKey& key) const;
+    };
+
+    uint64_t hashCombine(uint64_t seed, uint64_t value);
+}
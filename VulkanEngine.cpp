@@ -1,126 +1,469 @@
 #include "VulkanEngine.hpp"
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <bit>
+#include <iostream>
+
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+//Enabled when the device has them
+const std::vector<const char*> optionalDeviceExtensions = {
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+};
+
+//constant_id of SHADING_MODE in meshShader.frag
+constexpr uint32_t MESH_SHADING_CONSTANT_ID = 0;
+
+//Batch2D vertices, the layout sprite2D.vert reads
+const VkVertexInputBindingDescription overlayBinding = {
+    .binding = 0,
+    .stride = sizeof(EggyEngine::Vertex2D),
+    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+};
+
+const VkVertexInputAttributeDescription overlayAttributes[] = {
+    { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(EggyEngine::Vertex2D, position) },
+    { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(EggyEngine::Vertex2D, texCoord) },
+    { .location = 2, .binding = 0, .format = VK_FORMAT_R8G8B8A8_UNORM, .offset = offsetof(EggyEngine::Vertex2D, color) }
+};
+
+//Matches SpriteConstants in sprite2D.vert and sprite2D.frag
+struct SpriteConstants {
+
+    float pixelScale[2];
+    uint32_t layer;
+};
+
 namespace EggyEngine {
 
-    Engine::Engine() {
+    Engine::Engine(const EngineSettings& settings) : _settings(settings) {
+
+        //First so startup is in the trace
+        if (Profiler::enabled && !_settings.tracePath.empty())
+            Profiler::start(_settings.profiler);
+
+        EGGY_PROFILE_THREAD("main");
+        EGGY_PROFILE_ZONE("Engine::Engine");
+
+        _framePacer.configure(_settings.framePacing);
+        _loopScheduler.configure(_settings.loopScheduling);
+        _frameClock.configure(_settings.frameClock);
+        _lodSelector.configure(_settings.lodSelection);
+        _meshShading = _settings.meshShading;
+        _memoryTracker.configure(_settings.memoryBudget);
+        _deletionQueue.configure(_settings.deletionQueue);
+
+        //Fixed for the life of the engine, objects have to be destroyed with the callbacks they were created with
+        _hostAllocator.configure(_settings.hostAllocator);
+        _vkAllocator = _hostAllocator.callbacks();
+        _overlayBatch.configure(_settings.overlay.verticesPerChunk);
 
-        glfwInit();
+        if (enableValidationLayers)
+            _debugSink.start(_settings.debugSink);
 
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        Platform::beginTimerResolution();
 
-        _window = glfwCreateWindow(WIDTH, HEIGHT, "9/11 was a inside job",
-            nullptr, //No Fullscreen
-            nullptr  //No Shared Resources 
-        );
+        try {
+            _window.create(_settings.window);
+        }
+        catch (const std::exception&) {
+            Debug::errorWindow(L"Unable to create window");
+        }
 
-        if (_window == nullptr)
-            Debug::errorWindow(L"Unable to create glfw window");
+        //Headless runs have no input
+        if (_window.glfwWindow() != nullptr)
+            registerInputCallbacks();
 
         startEngine();
     }
 
     Engine::~Engine() {
 
+        stopRenderThread();
+
+        //Nothing runs on the GPU past this point, whatever was retired goes right away
+        vkDeviceWaitIdle(_vkDevice);
+
+        _retiredReady.clear();
+        _deletionQueue.flush(_retiredReady);
+        destroyRetired(_retiredReady);
+
+        destroyCapture();
+        destroyGpuTimestamps();
+
         destroyPipeline();
         destroySwapChain();
         destroyDraw();
+        destroyOverlay();
+        destroyParticles();
+        destroyOcclusionCulling();
+        destroyLighting();
+        destroyMeshes();
 
-        vkDestroyDevice(_vkDevice, nullptr);
+        vkDestroyDevice(_vkDevice, _vkAllocator);
 
         destroyInstance();
         destroyWindow();
+
+        _debugSink.stop();
+
+        if (Profiler::recording()) {
+
+            Profiler::stop();
+
+            if (!Profiler::writeChromeTrace(_settings.tracePath))
+                std::cerr << _settings.tracePath << ": failed to write the trace" << std::endl;
+        }
     }
 
     void Engine::destroyWindow() {
         
-        glfwDestroyWindow(_window);
-        glfwTerminate();
+        _window.destroy();
+
+        Platform::endTimerResolution();
     }
 
     void Engine::destroyInstance(){
         
         if (enableValidationLayers)
-            Debug::destroyDebugUtilsMessengerEXT(_vkInstance, nullptr);
+            Debug::destroyDebugUtilsMessengerEXT(_vkInstance, _vkAllocator);
 
-        vkDestroyInstance(_vkInstance, nullptr);
+        vkDestroyInstance(_vkInstance, _vkAllocator);
     }
 
     void Engine::destroyDraw() {
         
         for (auto framebuffer : _swapChainFramebuffers)
-            vkDestroyFramebuffer(_vkDevice, framebuffer, nullptr);
+            vkDestroyFramebuffer(_vkDevice, framebuffer, _vkAllocator);
         
-        vkDestroyCommandPool(_vkDevice, _vkCommandPool, nullptr);
+        vkDestroyCommandPool(_vkDevice, _vkCommandPool, _vkAllocator);
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
-        vkDestroySemaphore(_vkDevice, _vkImageAvailableSemaphore, nullptr);
-        vkDestroySemaphore(_vkDevice, _vkRenderFinishedSemaphore, nullptr);
-        vkDestroyFence(_vkDevice, _vkInFlightFence, nullptr);
+            vkDestroySemaphore(_vkDevice, _vkImageAvailableSemaphores[i], _vkAllocator);
+            vkDestroySemaphore(_vkDevice, _vkRenderFinishedSemaphores[i], _vkAllocator);
+            vkDestroyFence(_vkDevice, _vkInFlightFences[i], _vkAllocator);
+        }
     }
 
     void Engine::destroySwapChain(){
         
+        destroyRenderTargets();
+
         for (auto imageView : _swapChainImageViews)
-            vkDestroyImageView(_vkDevice, imageView, nullptr);
+            vkDestroyImageView(_vkDevice, imageView, _vkAllocator);
 
-        vkDestroySwapchainKHR(_vkDevice, _vkSwapChain, nullptr);
+        vkDestroySwapchainKHR(_vkDevice, _vkSwapChain, _vkAllocator);
 
-        vkDestroySurfaceKHR(_vkInstance, _vkSurface, nullptr);
+        vkDestroySurfaceKHR(_vkInstance, _vkSurface, _vkAllocator);
     }
 
     void Engine::destroyPipeline(){
         
-        vkDestroyShaderModule(_vkDevice, _fragShaderModule, nullptr);
-        vkDestroyShaderModule(_vkDevice, _vertShaderModule, nullptr);
+        for (auto shaderModule : _shaderModules)
+            vkDestroyShaderModule(_vkDevice, shaderModule, _vkAllocator);
 
-        vkDestroyPipeline(_vkDevice, _vkGraphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(_vkDevice, _vkPipelineLayout, nullptr);
-        vkDestroyRenderPass(_vkDevice, _vkRenderPass, nullptr);
+        //_vkGraphicsPipeline is one of the cached ones
+        for (auto pipeline : _pipelineTable)
+            vkDestroyPipeline(_vkDevice, pipeline, _vkAllocator);
+
+        for (auto pipeline : _computePipelines)
+            vkDestroyPipeline(_vkDevice, pipeline, _vkAllocator);
+
+        vkDestroyPipelineCache(_vkDevice, _vkPipelineCache, _vkAllocator);
+        _layoutCache.destroy();
+        vkDestroyRenderPass(_vkDevice, _vkLateRenderPass, _vkAllocator);
+        vkDestroyRenderPass(_vkDevice, _vkRenderPass, _vkAllocator);
     }
 
 //Window Pass
 
     void Engine::run()
     {
-        while (true) {
-            
-            if (glfwWindowShouldClose(_window)) {
-                vkDeviceWaitIdle(_vkDevice);
-                return;
+        startRenderThread();
+
+        while (!_window.shouldClose() && !_renderThreadFailed) {
+
+            EGGY_PROFILE_FRAME("main frame");
+
+            //Limiter and low latency delay happen before polling so the input is as fresh as possible
+            if (_loopScheduler.state() == LoopState::Active) {
+
+                EGGY_PROFILE_ZONE("waitForFrameStart");
+                _loopScheduler.addWaitTime(_framePacer.waitForFrameStart() / 1000.0);
             }
-            glfwPollEvents();
-            
-            //if window is minized, we skip frame
-            if (glfwGetWindowAttrib(_window, GLFW_ICONIFIED) == GLFW_TRUE)
-                continue;
 
-            drawFrame();
+            //Polls while active, blocks while minimized and throttles while unfocused
+            {
+                EGGY_PROFILE_ZONE("pumpEvents");
+
+                if (!_loopScheduler.pumpEvents(_window))
+                    continue;
+            }
+
+            submitFramePacket();
+            _window.frameSubmitted();
+
+            _loopScheduler.markFrameDrawn();
         }
+
+        stopRenderThread();
+
+        vkDeviceWaitIdle(_vkDevice);
+
+        if (_renderThreadError)
+            std::rethrow_exception(_renderThreadError);
     }
 
     void Engine::startEngine() {
 
-        createInstance();
-
-        createSwapChain();
+        EGGY_PROFILE_ZONE("startEngine");
 
-        createPipeline();
+        {
+            EGGY_PROFILE_ZONE("createInstance");
+            createInstance();
+        }
 
-        createFramebuffers();
+        {
+            EGGY_PROFILE_ZONE("createSwapChain");
+            createSwapChain();
+        }
 
         createCommandPool();
 
-        createCommandBuffer();
+        //Before the pipeline, the vertex input state comes from the pack layout
+        {
+            EGGY_PROFILE_ZONE("loadMeshPack");
+            loadMeshPack();
+        }
+
+        {
+            EGGY_PROFILE_ZONE("createPipeline");
+            createPipeline();
+        }
+
+        {
+            EGGY_PROFILE_ZONE("createOverlay");
+            createOverlay();
+        }
+
+        if (_captureEnabled)
+            createCapture();
+
+        if (hasMeshes()) {
+
+            EGGY_PROFILE_ZONE("createLighting");
+            createLighting();
+        }
+
+        if (_occlusionCulling) {
+
+            EGGY_PROFILE_ZONE("createOcclusionCulling");
+            createOcclusionCulling();
+        }
+
+        if (hasParticles()) {
+
+            EGGY_PROFILE_ZONE("createParticles");
+            createParticles();
+        }
+
+        if (Profiler::enabled && !_settings.tracePath.empty())
+            createGpuTimestamps();
+
+        createFramebuffers();
+
+        createCommandBuffers();
 
         createSyncObjects();
     }
 
 //End Pass
 
+//Frame Pacing Pass
+
+    void Engine::registerInputCallbacks() {
+
+        GLFWwindow* window = _window.glfwWindow();
+
+        glfwSetWindowUserPointer(window, this);
+
+        glfwSetKeyCallback(window, keyCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetCursorPosCallback(window, cursorPosCallback);
+    }
+
+    void Engine::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+
+        auto engine = reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
+        engine->_framePacer.markInput();
+
+        //F2 cycles the mesh shading variants
+        if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+            engine->_meshShading = static_cast<MeshShading>((static_cast<uint32_t>(engine->_meshShading) + 1) % static_cast<uint32_t>(MeshShading::Count));
+    }
+
+    void Engine::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+
+        auto engine = reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
+        engine->_framePacer.markInput();
+    }
+
+    void Engine::cursorPosCallback(GLFWwindow* window, double x, double y) {
+
+        auto engine = reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
+        engine->_framePacer.markInput();
+    }
+
+//End Pass
+
+//Render Thread Pass
+
+    void Engine::startRenderThread() {
+
+        _renderThread = std::thread(&Engine::renderThreadMain, this);
+    }
+
+    void Engine::stopRenderThread() {
+
+        if (!_renderThread.joinable())
+            return;
+
+        //The render thread drains the packets already queued and then leaves waitPop
+        _framePackets.close();
+        _renderThread.join();
+    }
+
+    void Engine::renderThreadMain() {
+
+        EGGY_PROFILE_THREAD("render");
+
+        try {
+
+            FramePacket packet;
+
+            while (_framePackets.waitPop(packet)) {
+
+                //A slot just freed up, wake the main thread if it is waiting on us
+                if (_packetProducerWaiting.exchange(false))
+                    _window.postEmptyEvent();
+
+                drawFrame(packet);
+            }
+        }
+        catch (...) {
+
+            _renderThreadError = std::current_exception();
+            _renderThreadFailed = true;
+
+            _window.postEmptyEvent();
+        }
+    }
+
+    void Engine::submitFramePacket() {
+
+        EGGY_PROFILE_ZONE("submitFramePacket");
+
+        FramePacket packet{
+            .frameNumber = _framesSubmitted,
+            .frameStart = _framePacer.frameStart(),
+            .inputTime = _framePacer.consumeInput(),
+            .scene = advanceSimulation()
+        };
+
+        if (_overlayCallback) {
+
+            EGGY_PROFILE_ZONE("overlayCallback");
+
+            int width, height;
+            _window.framebufferSize(width, height);
+
+            //Configured every time, the batch is one that came back from the queue
+            _overlayBatch.configure(_settings.overlay.verticesPerChunk);
+            _overlayCallback(_overlayBatch, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+
+            std::swap(packet.overlay, _overlayBatch);
+        }
+
+        if (_lightCallback) {
+
+            EGGY_PROFILE_ZONE("lightCallback");
+
+            _frameLights.clear();
+            _lightCallback(_frameLights, packet.scene);
+
+            packet.lights.swap(_frameLights);
+        }
+
+        // GPU backpressure: the render thread is a full queue behind. Keep handling window events while it catches up,
+        // the wait is woken by the render thread as soon as a slot frees up
+        while (!_framePackets.tryPushSwap(packet)) {
+
+            EGGY_PROFILE_ZONE("waitForRenderThread");
+
+            _packetProducerWaiting = true;
+
+            if (_framePackets.full())
+                _window.waitEvents(0.1);
+
+            if (_window.shouldClose() || _renderThreadFailed)
+                return;
+
+            //Input handled while waiting belongs to this packet unless it already carries an older one
+            auto inputTime = _framePacer.consumeInput();
+
+            if (!packet.inputTime)
+                packet.inputTime = inputTime;
+
+            //Keep simulating while blocked so the packet that finally goes out is current
+            packet.scene = advanceSimulation();
+        }
+
+        //The packet now holds one the render thread is done with, its buffers are kept for the next fill
+        if (_overlayCallback)
+            std::swap(_overlayBatch, packet.overlay);
+
+        if (_lightCallback)
+            _frameLights.swap(packet.lights);
+
+        _packetProducerWaiting = false;
+        _framesSubmitted++;
+    }
+
+//End Pass
+
+//Simulation Pass
+
+    SceneSnapshot Engine::advanceSimulation() {
+
+        EGGY_PROFILE_ZONE("advanceSimulation");
+
+        const FrameTiming& timing = _frameClock.tick([this](double deltaTime) { updateSimulation(deltaTime); });
+
+        double alpha = timing.interpolationAlpha;
+
+        SceneSnapshot scene{};
+        scene.simulationTime = _previousState.time + (_currentState.time - _previousState.time) * alpha;
+        scene.interpolationAlpha = static_cast<float>(alpha);
+        scene.deltaTime = static_cast<float>(timing.deltaTime);
+        scene.meshShading = _meshShading;
+
+        return scene;
+    }
+
+    void Engine::updateSimulation(double deltaTime) {
+
+        _previousState = _currentState;
+
+        _currentState.time += deltaTime;
+    }
+
+//End Pass
+
 //Instance Pass
 
 	void Engine::createInstance() {
@@ -137,13 +480,13 @@ namespace EggyEngine {
             .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
             .pEngineName = "EggyEngine",
             .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-            .apiVersion = VK_API_VERSION_1_0
+            .apiVersion = VK_API_VERSION_1_1
 
         };
 
         // Vulkan Instance Information Struct
 
-        auto extensions = Debug::getRequiredExtensions();
+        auto extensions = Debug::getRequiredExtensions(_window.requiredInstanceExtensions());
 
         VkInstanceCreateInfo _instanceInfo{
             .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
@@ -158,7 +501,7 @@ namespace EggyEngine {
         };
 
         if (!enableValidationLayers) {
-            if (vkCreateInstance(&_instanceInfo, nullptr, &_vkInstance) != VK_SUCCESS)
+            if (vkCreateInstance(&_instanceInfo, _vkAllocator, &_vkInstance) != VK_SUCCESS)
                 Debug::errorWindow(L"failed to create instance!");
 
             return;
@@ -168,20 +511,115 @@ namespace EggyEngine {
         _instanceInfo.ppEnabledLayerNames = validationLayers.data();
 
         VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
-        Debug::populateDebugMessengerCreateInfo(debugCreateInfo);
+        Debug::populateDebugMessengerCreateInfo(debugCreateInfo, &_debugSink);
 
         _instanceInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
 
-        if (vkCreateInstance(&_instanceInfo, nullptr, &_vkInstance) != VK_SUCCESS)
+        if (vkCreateInstance(&_instanceInfo, _vkAllocator, &_vkInstance) != VK_SUCCESS)
             Debug::errorWindow(L"failed to create instance!");
 
-        if (Debug::CreateDebugUtilsMessengerEXT(_vkInstance, &debugCreateInfo, nullptr) != VK_SUCCESS)
+        if (Debug::CreateDebugUtilsMessengerEXT(_vkInstance, &debugCreateInfo, _vkAllocator) != VK_SUCCESS)
             Debug::errorWindow(L"validation enabled but failed to create debug messenger!");
 	    
     }
 
 //End Pass
 
+//Memory Pass
+
+    VkDeviceMemory Engine::allocateMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category) {
+
+        uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+        VkMemoryAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .allocationSize = requirements.size,
+            .memoryTypeIndex = memoryTypeIndex
+        };
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+
+        if (vkAllocateMemory(_vkDevice, &allocInfo, _vkAllocator, &memory) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate device memory!");
+
+        _memoryTracker.trackAllocation(memory, memoryTypeIndex, requirements.size, category);
+
+        return memory;
+    }
+
+    void Engine::freeMemory(VkDeviceMemory memory) {
+
+        _memoryTracker.trackFree(memory);
+        vkFreeMemory(_vkDevice, memory, _vkAllocator);
+    }
+
+    void Engine::destroyRetired(const std::vector<RetiredObject>& objects) {
+
+        for (const auto& object : objects) {
+
+            switch (object.type) {
+            case VK_OBJECT_TYPE_BUFFER:
+                vkDestroyBuffer(_vkDevice, reinterpret_cast<VkBuffer>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_IMAGE:
+                vkDestroyImage(_vkDevice, reinterpret_cast<VkImage>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_IMAGE_VIEW:
+                vkDestroyImageView(_vkDevice, reinterpret_cast<VkImageView>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_SAMPLER:
+                vkDestroySampler(_vkDevice, reinterpret_cast<VkSampler>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_PIPELINE:
+                vkDestroyPipeline(_vkDevice, reinterpret_cast<VkPipeline>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_SHADER_MODULE:
+                vkDestroyShaderModule(_vkDevice, reinterpret_cast<VkShaderModule>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+                vkDestroyDescriptorPool(_vkDevice, reinterpret_cast<VkDescriptorPool>(object.handle), _vkAllocator);
+                break;
+            case VK_OBJECT_TYPE_FRAMEBUFFER:
+                vkDestroyFramebuffer(_vkDevice, reinterpret_cast<VkFramebuffer>(object.handle), _vkAllocator);
+                break;
+            //Objects go in retire order, retire memory after what is bound to it
+            case VK_OBJECT_TYPE_DEVICE_MEMORY:
+                freeMemory(reinterpret_cast<VkDeviceMemory>(object.handle));
+                break;
+            default:
+                Debug::errorWindow(L"retired object type can't be destroyed!");
+            }
+        }
+    }
+
+    uint32_t Engine::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
+
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+                return i;
+
+        Debug::errorWindow(L"failed to find suitable memory type!");
+        return 0;
+    }
+
+    bool Engine::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
+
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+                return true;
+
+        return false;
+    }
+
+//End Pass
+
 //SwapChain Pass
 
     int Engine::rateDeviceSuitability(VkPhysicalDevice device) {
@@ -226,6 +664,21 @@ namespace EggyEngine {
         return requiredExtensions.empty();
     }
 
+    bool Engine::isDeviceExtensionAvailable(const char* extensionName) {
+
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions)
+            if (strcmp(extension.extensionName, extensionName) == 0)
+                return true;
+
+        return false;
+    }
+
     void Engine::findQueueFamilies() {
         // Logic to find graphics queue family
 
@@ -239,7 +692,8 @@ namespace EggyEngine {
         for (const auto& queueFamily : queueFamilies) {
 
             vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, i, _vkSurface, &indices.presentFamilySet);
-            indices.graphicsFamilySet = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            //Compute is recorded in the same command buffers as the draws, the graphics family has to run both
+            indices.graphicsFamilySet = (queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
 
             if (indices.presentFamilySet)
                 indices.presentFamily = i;
@@ -298,14 +752,7 @@ namespace EggyEngine {
         VkPhysicalDeviceProperties deviceProperties;
         vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
 
-        switch (deviceProperties.deviceType) {
-            // This is a discrete GPU (e.g. Nvidia or AMD)
-        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return VK_PRESENT_MODE_MAILBOX_KHR; break;
-            // This is an integrated GPU (e.g. Intel HD Graphics)
-        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return VK_PRESENT_MODE_FIFO_RELAXED_KHR; break;
-            // Other device type
-        default: return VK_PRESENT_MODE_FIFO_KHR; break;
-        }
+        return _framePacer.selectPresentMode(availablePresentModes, deviceProperties.deviceType);
     }
 
     VkExtent2D Engine::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
@@ -315,7 +762,7 @@ namespace EggyEngine {
         }
         else {
             int width, height;
-            glfwGetFramebufferSize(_window, &width, &height);
+            _window.framebufferSize(width, height);
 
             VkExtent2D actualExtent = {
                 static_cast<uint32_t>(width),
@@ -331,7 +778,7 @@ namespace EggyEngine {
     
     void Engine::createSurface() {
 
-        if (glfwCreateWindowSurface(_vkInstance, _window, nullptr, &_vkSurface) != VK_SUCCESS)
+        if (_window.createSurface(_vkInstance, _vkAllocator, &_vkSurface) != VK_SUCCESS)
             Debug::errorWindow(L"failed to create window surface!");
 
     }
@@ -397,6 +844,12 @@ namespace EggyEngine {
         
         VkPhysicalDeviceFeatures deviceFeatures{};
 
+        _enabledDeviceExtensions = deviceExtensions;
+
+        for (const char* extension : optionalDeviceExtensions)
+            if (isDeviceExtensionAvailable(extension))
+                _enabledDeviceExtensions.push_back(extension);
+
         VkDeviceCreateInfo deviceCreateInfo{
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
             .pNext = nullptr,
@@ -405,8 +858,8 @@ namespace EggyEngine {
             .pQueueCreateInfos = queueCreateInfos.data(),
             .enabledLayerCount = 0,
             .ppEnabledLayerNames = nullptr,
-            .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-            .ppEnabledExtensionNames = deviceExtensions.data(),
+            .enabledExtensionCount = static_cast<uint32_t>(_enabledDeviceExtensions.size()),
+            .ppEnabledExtensionNames = _enabledDeviceExtensions.data(),
             .pEnabledFeatures = &deviceFeatures
         };
 
@@ -416,11 +869,18 @@ namespace EggyEngine {
             deviceCreateInfo.ppEnabledLayerNames = validationLayers.data();
         }
 
-        if (vkCreateDevice(_physicalDevice, &deviceCreateInfo, nullptr, &_vkDevice) != VK_SUCCESS)
+        if (vkCreateDevice(_physicalDevice, &deviceCreateInfo, _vkAllocator, &_vkDevice) != VK_SUCCESS)
             Debug::errorWindow(L"failed to create logical device!");
 
         vkGetDeviceQueue(_vkDevice, indices.graphicsFamily, 0, &_graphicsQueue);
         vkGetDeviceQueue(_vkDevice, indices.presentFamily, 0, &_presentQueue);
+
+        bool memoryBudget = std::find_if(_enabledDeviceExtensions.begin(), _enabledDeviceExtensions.end(), [](const char* extension) {
+            return strcmp(extension, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+        }) != _enabledDeviceExtensions.end();
+
+        _memoryTracker.init(_vkInstance, _physicalDevice, memoryBudget);
+        _memoryTracker.refresh();
     }
 
     void Engine::startSwapChain() {
@@ -438,6 +898,31 @@ namespace EggyEngine {
 
         uint32_t queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
 
+        VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+        //Frame capture copies straight out of the swapchain images, the readback buffers take 4 bytes per pixel
+        if (!_settings.capture.directory.empty()) {
+
+            switch (surfaceFormat.format) {
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+                _capturePixelLayout = CapturePixelLayout::BGRA;
+                break;
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                _capturePixelLayout = CapturePixelLayout::RGBA;
+                break;
+            default:
+                Debug::errorWindow(L"swapchain format can't be captured!");
+            }
+
+            if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+                Debug::errorWindow(L"swapchain images can't be copied for capture!");
+
+            imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            _captureEnabled = true;
+        }
+
         VkSwapchainCreateInfoKHR swapchainCreateInfo{
             .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
             .pNext = nullptr,
@@ -448,7 +933,7 @@ namespace EggyEngine {
             .imageColorSpace = surfaceFormat.colorSpace,
             .imageExtent = extent,
             .imageArrayLayers = 1,
-            .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            .imageUsage = imageUsage,
             .imageSharingMode = VK_SHARING_MODE_CONCURRENT,
             .queueFamilyIndexCount = 2,
             .pQueueFamilyIndices = queueFamilyIndices,
@@ -466,7 +951,7 @@ namespace EggyEngine {
             swapchainCreateInfo.pQueueFamilyIndices = nullptr;
         }
 
-        if (vkCreateSwapchainKHR(_vkDevice, &swapchainCreateInfo, nullptr, &_vkSwapChain) != VK_SUCCESS)
+        if (vkCreateSwapchainKHR(_vkDevice, &swapchainCreateInfo, _vkAllocator, &_vkSwapChain) != VK_SUCCESS)
             Debug::errorWindow(L"failed to create swap chain!");
 
         vkGetSwapchainImagesKHR(_vkDevice, _vkSwapChain, &imageCount, nullptr);
@@ -475,6 +960,7 @@ namespace EggyEngine {
 
         _swapChainImageFormat = surfaceFormat.format;
         _swapChainExtent = extent;
+        _swapChainGeneration++;
 
     }
     
@@ -505,7 +991,7 @@ namespace EggyEngine {
 
             viewCreateInfo.image = _swapChainImages[i];
             
-            if (vkCreateImageView(_vkDevice, &viewCreateInfo, nullptr, &_swapChainImageViews[i]) != VK_SUCCESS)
+            if (vkCreateImageView(_vkDevice, &viewCreateInfo, _vkAllocator, &_swapChainImageViews[i]) != VK_SUCCESS)
                 Debug::errorWindow(L"failed to create image views!");
         }
     }
@@ -521,66 +1007,197 @@ namespace EggyEngine {
         startSwapChain();
 
         createImageViews();
+
+        createRenderTargets();
     }
 //End Pass
 
-//Shader Related Pass
-    
-    VkPipelineShaderStageCreateInfo* Engine::loadShaderModules(std::string _shaderName) {
+//Render Target Pass
 
-        auto vertShaderCode = Loader::readShaderFile(_shaderName + ".vert.spv");
-        auto fragShaderCode = Loader::readShaderFile(_shaderName + ".frag.spv");
+    VkSampleCountFlagBits Engine::chooseSampleCount(VkSampleCountFlagBits requested) {
 
-        _vertShaderModule = createShaderModule(vertShaderCode);
-        _fragShaderModule = createShaderModule(fragShaderCode);
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
 
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = _vertShaderModule,
-            .pName = "main",
-            .pSpecializationInfo = nullptr
-        };
+        //Color and depth share the render pass, both have to support the count
+        VkSampleCountFlags supported = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
 
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        for (uint32_t samples = requested; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1)
+            if (supported & samples)
+                return static_cast<VkSampleCountFlagBits>(samples);
+
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
+
+    void Engine::createRenderTarget(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkSampleCountFlagBits samples, RenderTarget& target) {
+
+        VkImageCreateInfo imageInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = _fragShaderModule,
-            .pName = "main",
-            .pSpecializationInfo = nullptr
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = format,
+            .extent = { _swapChainExtent.width, _swapChainExtent.height, 1 },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = samples,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
         };
 
-        VkPipelineShaderStageCreateInfo* shaderStages = new VkPipelineShaderStageCreateInfo[2] {
-            vertShaderStageInfo,
-            fragShaderStageInfo
-        };
+        if (vkCreateImage(_vkDevice, &imageInfo, _vkAllocator, &target.image) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create render target image!");
 
-        return shaderStages;
-    }
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(_vkDevice, target.image, &memRequirements);
 
-    VkShaderModule Engine::createShaderModule(const std::vector<char>& shaderBinary) {
+        //Transient attachments may use lazily allocated memory, desktop GPUs usually don't have it
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VkMemoryPropertyFlags lazyProperties = properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 
-        VkShaderModule shaderModule;
+        target.lazy = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) && hasMemoryType(memRequirements.memoryTypeBits, lazyProperties);
 
-        VkShaderModuleCreateInfo moduleCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        target.memory = allocateMemory(memRequirements, target.lazy ? lazyProperties : properties, MemoryCategory::Image);
+
+        vkBindImageMemory(_vkDevice, target.image, target.memory, 0);
+
+        VkImageViewCreateInfo viewInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .codeSize = shaderBinary.size(),
-            .pCode = reinterpret_cast<const uint32_t*>(shaderBinary.data())
+            .image = target.image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = format,
+            .components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY },
+            .subresourceRange = { aspect, 0, 1, 0, 1 }
         };
 
-        if (vkCreateShaderModule(_vkDevice, &moduleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to create shader module!");
-
-        return shaderModule;
+        if (vkCreateImageView(_vkDevice, &viewInfo, _vkAllocator, &target.view) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create render target view!");
     }
 
-//End Pass
+    void Engine::destroyRenderTarget(RenderTarget& target) {
+
+        if (target.image == VK_NULL_HANDLE)
+            return;
+
+        vkDestroyImageView(_vkDevice, target.view, _vkAllocator);
+        vkDestroyImage(_vkDevice, target.image, _vkAllocator);
+        freeMemory(target.memory);
+
+        target = RenderTarget{};
+    }
+
+    void Engine::createRenderTargets() {
+
+        _msaaSamples = chooseSampleCount(_settings.msaaSamples);
+        _depthFormat = findDepthFormat();
+
+        //Occlusion culling stores both between its two render passes and samples depth. The mesh pack isn't loaded yet, so this goes by the settings
+        VkImageUsageFlags transient = _settings.occlusionCulling ? 0 : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        VkImageUsageFlags sampled = _settings.occlusionCulling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0;
+
+        createRenderTarget(_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | transient | sampled,
+            VK_IMAGE_ASPECT_DEPTH_BIT, _msaaSamples, _depthTarget);
+
+        //Single sampled rendering goes straight to the swapchain image
+        if (msaaEnabled())
+            createRenderTarget(_swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | transient,
+                VK_IMAGE_ASPECT_COLOR_BIT, _msaaSamples, _msaaColorTarget);
+    }
+
+    void Engine::destroyRenderTargets() {
+
+        destroyRenderTarget(_msaaColorTarget);
+        destroyRenderTarget(_depthTarget);
+    }
+
+    VkFormat Engine::findDepthFormat() {
+
+        //Stencil is unused, so the formats without it come first
+        VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM };
+
+        for (VkFormat format : candidates) {
+
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &properties);
+
+            //The depth pyramid samples it with occlusion culling
+            VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | (_settings.occlusionCulling ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0);
+
+            if ((properties.optimalTilingFeatures & features) == features)
+                return format;
+        }
+
+        Debug::errorWindow(L"failed to find a supported depth format!");
+        return VK_FORMAT_UNDEFINED;
+    }
+
+//End Pass
+
+//Shader Related Pass
+    
+    VkPipelineShaderStageCreateInfo* Engine::loadShaderModules(Shaders::ShaderId vertexShader, Shaders::ShaderVariant& vertexVariant, Shaders::ShaderId fragmentShader, Shaders::ShaderVariant& fragmentVariant) {
+
+        //SPIR-V is embedded in the executable, no file access here. Modules are shared by every variant
+        for (auto id : { vertexShader, fragmentShader })
+            if (_shaderModules[static_cast<size_t>(id)] == VK_NULL_HANDLE)
+                _shaderModules[static_cast<size_t>(id)] = createShaderModule(Shaders::get(id));
+
+        if (!vertexVariant.matches(Shaders::get(vertexShader)) || !fragmentVariant.matches(Shaders::get(fragmentShader)))
+            Debug::errorWindow(L"shader variant sets a specialization constant the shader doesn't declare!");
+
+        VkPipelineShaderStageCreateInfo vertShaderStageInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .stage = Shaders::get(vertexShader).stage,
+            .module = _shaderModules[static_cast<size_t>(vertexShader)],
+            .pName = "main",
+            .pSpecializationInfo = vertexVariant.specializationInfo()
+        };
+
+        VkPipelineShaderStageCreateInfo fragShaderStageInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .stage = Shaders::get(fragmentShader).stage,
+            .module = _shaderModules[static_cast<size_t>(fragmentShader)],
+            .pName = "main",
+            .pSpecializationInfo = fragmentVariant.specializationInfo()
+        };
+
+        VkPipelineShaderStageCreateInfo* shaderStages = new VkPipelineShaderStageCreateInfo[2] {
+            vertShaderStageInfo,
+            fragShaderStageInfo
+        };
+
+        return shaderStages;
+    }
+
+    VkShaderModule Engine::createShaderModule(const Shaders::ShaderBinary& shader) {
+
+        VkShaderModule shaderModule;
+
+        VkShaderModuleCreateInfo moduleCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .codeSize = shader.codeSize(),
+            .pCode = shader.code
+        };
+
+        if (vkCreateShaderModule(_vkDevice, &moduleCreateInfo, _vkAllocator, &shaderModule) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create shader module!");
+
+        return shaderModule;
+    }
+
+//End Pass
 
 //Graphics Pipeline Pass
 
@@ -604,28 +1221,126 @@ namespace EggyEngine {
         return dynamicState;
     }
 
-    VkPipelineVertexInputStateCreateInfo Engine::inputVertexState() {
+    static bool isOverlayPass(PipelinePass pass) { return pass == PipelinePass::Overlay || pass == PipelinePass::OverlayLines; }
+
+    //Blended on top of the opaque geometry, nothing to cull
+    static bool isBlendedPass(PipelinePass pass) { return isOverlayPass(pass) || pass == PipelinePass::Particles; }
+
+    VkPipelineVertexInputStateCreateInfo Engine::inputVertexState(const Shaders::ShaderReflection& vertexShader, PipelinePass pass) {
+
+        if (isOverlayPass(pass)) {
+
+            for (const auto& input : vertexShader.vertexInputs) {
+
+                auto attribute = std::find_if(std::begin(overlayAttributes), std::end(overlayAttributes), [&](const VkVertexInputAttributeDescription& attribute) {
+                    return attribute.location == input.location;
+                });
+
+                if (attribute == std::end(overlayAttributes) || Shaders::formatComponentCount(attribute->format) != input.componentCount)
+                    Debug::errorWindow(L"overlay shader doesn't match the Batch2D vertex layout!");
+            }
+
+            VkPipelineVertexInputStateCreateInfo overlayInputInfo {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .vertexBindingDescriptionCount = 1,
+                .pVertexBindingDescriptions = &overlayBinding,
+                .vertexAttributeDescriptionCount = static_cast<uint32_t>(std::size(overlayAttributes)),
+                .pVertexAttributeDescriptions = overlayAttributes,
+            };
+
+            return overlayInputInfo;
+        }
+
+        if (pass == PipelinePass::Particles) {
+
+            //Billboards are built from gl_VertexIndex and the particle buffer
+            if (!vertexShader.vertexInputs.empty())
+                Debug::errorWindow(L"particle shader can't have vertex inputs!");
+
+            VkPipelineVertexInputStateCreateInfo noInputInfo {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .vertexBindingDescriptionCount = 0,
+                .pVertexBindingDescriptions = nullptr,
+                .vertexAttributeDescriptionCount = 0,
+                .pVertexAttributeDescriptions = nullptr,
+            };
+
+            return noInputInfo;
+        }
+
+        if (pass == PipelinePass::DepthPrepass) {
+
+            //Position only stream, the pre-pass shader can't read anything else
+            for (const auto& input : vertexShader.vertexInputs)
+                if (input.location != _positionAttribute.location || Shaders::formatComponentCount(_positionAttribute.format) != input.componentCount)
+                    Debug::errorWindow(L"depth pre-pass shader reads more than the position stream!");
+
+            VkPipelineVertexInputStateCreateInfo positionInputInfo {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .vertexBindingDescriptionCount = 1,
+                .pVertexBindingDescriptions = &_positionBinding,
+                .vertexAttributeDescriptionCount = 1,
+                .pVertexAttributeDescriptions = &_positionAttribute,
+            };
+
+            return positionInputInfo;
+        }
+
+        if (hasMeshes()) {
+
+            //The pack decides the formats, every input the shader reads just has to be there with the same width
+            for (const auto& input : vertexShader.vertexInputs) {
+
+                auto attribute = std::find_if(_meshAttributes.begin(), _meshAttributes.end(), [&](const VkVertexInputAttributeDescription& attribute) {
+                    return attribute.location == input.location;
+                });
+
+                if (attribute == _meshAttributes.end() || Shaders::formatComponentCount(attribute->format) != input.componentCount)
+                    Debug::errorWindow(L"mesh pack vertex layout doesn't match the inputs of the vertex shader!");
+            }
+
+            VkPipelineVertexInputStateCreateInfo meshInputInfo {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .vertexBindingDescriptionCount = 1,
+                .pVertexBindingDescriptions = &_meshBinding,
+                .vertexAttributeDescriptionCount = static_cast<uint32_t>(_meshAttributes.size()),
+                .pVertexAttributeDescriptions = _meshAttributes.data(),
+            };
+
+            return meshInputInfo;
+        }
+
+        //Reflected layout, tightly packed 32 bit attributes. Points into the cached reflection
+        bool hasInputs = !vertexShader.vertexAttributes.empty();
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .vertexBindingDescriptionCount = 0,
-            .pVertexBindingDescriptions = nullptr, // Optional
-            .vertexAttributeDescriptionCount = 0,
-            .pVertexAttributeDescriptions = nullptr, // Optional
+            .vertexBindingDescriptionCount = hasInputs ? 1u : 0u,
+            .pVertexBindingDescriptions = hasInputs ? &vertexShader.vertexBinding : nullptr,
+            .vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexShader.vertexAttributes.size()),
+            .pVertexAttributeDescriptions = hasInputs ? vertexShader.vertexAttributes.data() : nullptr,
         };
 
         return vertexInputInfo;
     }
 
-    VkPipelineInputAssemblyStateCreateInfo Engine::inputAssemblyState() {
+    VkPipelineInputAssemblyStateCreateInfo Engine::inputAssemblyState(PipelinePass pass) {
         
         VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .topology = pass == PipelinePass::OverlayLines ? VK_PRIMITIVE_TOPOLOGY_LINE_LIST : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
             .primitiveRestartEnable = VK_FALSE
         };
 
@@ -661,7 +1376,7 @@ namespace EggyEngine {
         return viewportState;
     }
 
-    VkPipelineRasterizationStateCreateInfo Engine::rasterizationState() {
+    VkPipelineRasterizationStateCreateInfo Engine::rasterizationState(PipelinePass pass) {
 
         VkPipelineRasterizationStateCreateInfo rasterizerState {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
@@ -670,8 +1385,9 @@ namespace EggyEngine {
             .depthClampEnable = VK_FALSE,
             .rasterizerDiscardEnable = VK_FALSE,
             .polygonMode = VK_POLYGON_MODE_FILL,
-            .cullMode = VK_CULL_MODE_BACK_BIT,
-            .frontFace = VK_FRONT_FACE_CLOCKWISE,
+            .cullMode = isBlendedPass(pass) ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT,
+            //Meshes are counter clockwise, the projection flips Y so they end up clockwise on screen
+            .frontFace = hasMeshes() ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE,
             .depthBiasEnable = VK_FALSE,
             .depthBiasConstantFactor = 0.0f,
             .depthBiasClamp = 0.0f,
@@ -688,7 +1404,7 @@ namespace EggyEngine {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+            .rasterizationSamples = _msaaSamples,
             .sampleShadingEnable = VK_FALSE,
             .minSampleShading = 1.0f,
             .pSampleMask = nullptr,
@@ -699,15 +1415,46 @@ namespace EggyEngine {
         return multisampleState;
     }
 
-    VkPipelineColorBlendStateCreateInfo Engine::colorBlendState() {
+    VkPipelineDepthStencilStateCreateInfo Engine::depthStencilState(PipelinePass pass) {
+
+        //With a pre-pass the color pass only shades the fragment that won, it never writes depth itself
+        bool testEqual = _depthPrepass && pass == PipelinePass::Color;
+
+        //The overlay goes on top of everything, particles are tested against the scene but don't occlude each other
+        bool overlay = isOverlayPass(pass);
+        bool particles = pass == PipelinePass::Particles;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .depthTestEnable = overlay ? VK_FALSE : VK_TRUE,
+            .depthWriteEnable = (testEqual || overlay || particles) ? VK_FALSE : VK_TRUE,
+            .depthCompareOp = testEqual ? VK_COMPARE_OP_EQUAL : (particles ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS),
+            .depthBoundsTestEnable = VK_FALSE,
+            .stencilTestEnable = VK_FALSE,
+            .front = {},
+            .back = {},
+            .minDepthBounds = 0.0f,
+            .maxDepthBounds = 1.0f
+        };
+
+        return depthStencil;
+    }
+
+    VkPipelineColorBlendStateCreateInfo Engine::colorBlendState(PipelinePass pass) {
         
+        //Overlays blend with straight alpha and particles add up, everything else is opaque
+        bool blend = isOverlayPass(pass);
+        bool additive = pass == PipelinePass::Particles;
+
         VkPipelineColorBlendAttachmentState* colorBlendAttachment = new VkPipelineColorBlendAttachmentState {
-            .blendEnable = VK_FALSE,
-            .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-            .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+            .blendEnable = (blend || additive) ? VK_TRUE : VK_FALSE,
+            .srcColorBlendFactor = blend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE,
+            .dstColorBlendFactor = blend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : (additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO),
             .colorBlendOp = VK_BLEND_OP_ADD,
             .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-            .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+            .dstAlphaBlendFactor = blend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : (additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO),
             .alphaBlendOp = VK_BLEND_OP_ADD,
             .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
         };
@@ -718,7 +1465,7 @@ namespace EggyEngine {
             .flags = 0,
             .logicOpEnable = VK_FALSE,
             .logicOp = VK_LOGIC_OP_COPY,
-            .attachmentCount = 1,
+            .attachmentCount = pass == PipelinePass::DepthPrepass ? 0u : 1u,
             .pAttachments = colorBlendAttachment
         };
 
@@ -728,18 +1475,46 @@ namespace EggyEngine {
         return colorBlending;
     }
 
-    void Engine::createRenderPass() {
+    VkRenderPass Engine::createRenderPass(bool late) {
+
+        //An early pass followed by a late one hands color and depth over in memory, the depth pyramid is built in between
+        bool early = _occlusionCulling && !late;
         
-        VkAttachmentDescription colorAttachment {
-            .flags = 0,
-            .format = _swapChainImageFormat,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+        //Color first, then depth. With MSAA color is the multisampled target and the swapchain image, last, is only written by the resolve
+        VkAttachmentDescription attachments[] = {
+            {
+                .flags = 0,
+                .format = _swapChainImageFormat,
+                .samples = _msaaSamples,
+                .loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = (msaaEnabled() && !early) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = late ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = (msaaEnabled() || early) ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            },
+            {
+                .flags = 0,
+                .format = _depthFormat,
+                .samples = _msaaSamples,
+                .loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = early ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = late ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = early ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+            },
+            {
+                .flags = 0,
+                .format = _swapChainImageFormat,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .storeOp = early ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            }
         };
 
         VkAttachmentReference colorAttachmentRef {
@@ -747,78 +1522,255 @@ namespace EggyEngine {
             .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
         };
 
-        VkSubpassDescription subpassDescription{
+        VkAttachmentReference depthAttachmentRef {
+            .attachment = 1,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        };
+
+        //After the pre-pass depth is only tested, never written
+        VkAttachmentReference depthReadOnlyAttachmentRef {
+            .attachment = 1,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+        };
+
+        VkAttachmentReference resolveAttachmentRef {
+            .attachment = 2,
+            .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+        };
+
+        VkSubpassDescription depthSubpass{
+            .flags = 0,
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .inputAttachmentCount = 0,
+            .pInputAttachments = nullptr,
+            .colorAttachmentCount = 0,
+            .pColorAttachments = nullptr,
+            .pResolveAttachments = nullptr,
+            .pDepthStencilAttachment = &depthAttachmentRef,
+            .preserveAttachmentCount = 0,
+            .pPreserveAttachments = nullptr
+        };
+
+        VkSubpassDescription colorSubpass{
             .flags = 0,
             .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
             .inputAttachmentCount = 0,
             .pInputAttachments = nullptr,
             .colorAttachmentCount = 1,
             .pColorAttachments = &colorAttachmentRef,
-            .pResolveAttachments = nullptr,
-            .pDepthStencilAttachment = nullptr,
+            .pResolveAttachments = msaaEnabled() ? &resolveAttachmentRef : nullptr,
+            .pDepthStencilAttachment = _depthPrepass ? &depthReadOnlyAttachmentRef : &depthAttachmentRef,
             .preserveAttachmentCount = 0,
             .pPreserveAttachments = nullptr
         };
 
+        VkSubpassDescription subpasses[] = { depthSubpass, colorSubpass };
+
         VkRenderPassCreateInfo renderPassInfo{
             .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .attachmentCount = 1,
-            .pAttachments = &colorAttachment,
-            .subpassCount = 1,
-            .pSubpasses = &subpassDescription,
+            .attachmentCount = msaaEnabled() ? 3u : 2u,
+            .pAttachments = attachments,
+            .subpassCount = _depthPrepass ? 2u : 1u,
+            .pSubpasses = _depthPrepass ? subpasses : &colorSubpass,
             .dependencyCount = 0,
             .pDependencies = nullptr
         };
 
-        VkSubpassDependency dependency{};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        //The render targets are shared by the frames in flight, their clears have to wait for the previous frame's writes.
+        //The late pass also waits for the depth pyramid to be done reading depth, and loads color
+        VkSubpassDependency dependencies[4]{};
+
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | (late ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0);
+        dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].dstSubpass = subpassIndex(PipelinePass::Color);
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (late ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+
+        //Pre-pass depth has to be written before the color pass tests against it, per pixel so tilers stay on chip
+        dependencies[2].srcSubpass = 0;
+        dependencies[2].dstSubpass = 1;
+        dependencies[2].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[2].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[2].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[2].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        //Depth written by the early pass is read by the pyramid reduction right after it
+        VkSubpassDependency& pyramidDependency = dependencies[_depthPrepass ? 3 : 2];
+
+        pyramidDependency.srcSubpass = subpassIndex(PipelinePass::Color);
+        pyramidDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        pyramidDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        pyramidDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        pyramidDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        pyramidDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        renderPassInfo.dependencyCount = (_depthPrepass ? 3 : 2) + (early ? 1 : 0);
+        renderPassInfo.pDependencies = dependencies;
+
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+
+        if (vkCreateRenderPass(_vkDevice, &renderPassInfo, _vkAllocator, &renderPass) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create render pass!");
+
+        return renderPass;
+    }
+
+    void Engine::createPipeline() {
 
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        //Without meshes there is only the triangle, nothing to pre-pass
+        _depthPrepass = _settings.depthPrepass && hasMeshes();
+        _occlusionCulling = _settings.occlusionCulling && hasMeshes();
 
-        if (vkCreateRenderPass(_vkDevice, &renderPassInfo, nullptr, &_vkRenderPass) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to create render pass!");
+        _vkRenderPass = createRenderPass(false);
+
+        if (_occlusionCulling)
+            _vkLateRenderPass = createRenderPass(true);
+
+        _layoutCache.init(_vkDevice, _vkAllocator);
+
+        VkPipelineCacheCreateInfo pipelineCacheInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .initialDataSize = 0,
+            .pInitialData = nullptr
+        };
+
+        if (vkCreatePipelineCache(_vkDevice, &pipelineCacheInfo, _vkAllocator, &_vkPipelineCache) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create pipeline cache!");
+
+        //Only the vertex layout differs between the pipelines of this render pass
+        _pipelineStateHash = Shaders::hashCombine(reinterpret_cast<uint64_t>(_vkRenderPass), _meshBinding.stride);
+        _pipelineStateHash = Shaders::hashCombine(_pipelineStateHash, _msaaSamples);
+        _pipelineStateHash = Shaders::hashCombine(_pipelineStateHash, _depthPrepass);
+
+        for (const auto& attribute : _meshAttributes)
+            _pipelineStateHash = Shaders::hashCombine(_pipelineStateHash, (uint64_t(attribute.location) << 48) ^ (uint64_t(attribute.format) << 16) ^ attribute.offset);
+
+        //Every mesh variant shares this layout, so push constants recorded against it work with all of them
+        Shaders::ShaderId defaultShaders[] = {
+            hasMeshes() ? Shaders::ShaderId::MeshVert : Shaders::ShaderId::SimpleTriangleVert,
+            hasMeshes() ? Shaders::ShaderId::MeshFrag : Shaders::ShaderId::SimpleTriangleFrag
+        };
+
+        _vkPipelineLayout = _layoutCache.pipelineLayout(defaultShaders);
+
+        Shaders::ShaderVariant noVariant{};
+
+        //The startup variant, others are built the first time a frame asks for them
+        _vkGraphicsPipeline = _pipelineTable[hasMeshes()
+            ? meshPipeline(_settings.meshShading)
+            : requestPipeline(Shaders::ShaderId::SimpleTriangleVert, noVariant, Shaders::ShaderId::SimpleTriangleFrag, noVariant)];
+
+        if (_depthPrepass)
+            depthPrepassPipeline();
     }
 
-    void Engine::createPipelineLayout() {
+    VkPipeline Engine::createComputePipeline(Shaders::ShaderId shader, Shaders::ShaderVariant& variant, VkPipelineLayout layout) {
+
+        if (_shaderModules[static_cast<size_t>(shader)] == VK_NULL_HANDLE)
+            _shaderModules[static_cast<size_t>(shader)] = createShaderModule(Shaders::get(shader));
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        if (!variant.matches(Shaders::get(shader)))
+            Debug::errorWindow(L"shader variant sets a specialization constant the shader doesn't declare!");
+
+        VkComputePipelineCreateInfo pipelineInfo{
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .setLayoutCount = 0, // Optional
-            .pSetLayouts = nullptr, // Optional
-            .pushConstantRangeCount = 0, // Optional
-            .pPushConstantRanges = nullptr // Optional
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = _shaderModules[static_cast<size_t>(shader)],
+                .pName = "main",
+                .pSpecializationInfo = variant.specializationInfo()
+            },
+            .layout = layout,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = -1
+        };
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        if (vkCreateComputePipelines(_vkDevice, _vkPipelineCache, 1, &pipelineInfo, _vkAllocator, &pipeline) != VK_SUCCESS)
+            Debug::errorWindow(L"Error creating Compute Pipeline!");
+
+        _computePipelines.push_back(pipeline);
+
+        return pipeline;
+    }
+
+    uint32_t Engine::meshPipeline(MeshShading shading) {
+
+        Shaders::ShaderVariant vertexVariant{};
+        Shaders::ShaderVariant fragmentVariant{};
+
+        fragmentVariant.set(MESH_SHADING_CONSTANT_ID, static_cast<uint32_t>(shading));
+
+        return requestPipeline(Shaders::ShaderId::MeshVert, vertexVariant, Shaders::ShaderId::MeshFrag, fragmentVariant);
+    }
+
+    uint32_t Engine::depthPrepassPipeline() {
+
+        Shaders::ShaderVariant noVariant{};
+
+        return requestPipeline(Shaders::ShaderId::DepthPrepassVert, noVariant, Shaders::ShaderId::DepthPrepassFrag, noVariant, PipelinePass::DepthPrepass);
+    }
+
+    uint32_t Engine::requestPipeline(Shaders::ShaderId vertexShader, Shaders::ShaderVariant& vertexVariant, Shaders::ShaderId fragmentShader, Shaders::ShaderVariant& fragmentVariant, PipelinePass pass) {
+
+        Shaders::PipelineKey key{
+            .vertexShader = vertexShader,
+            .fragmentShader = fragmentShader,
+            .vertexVariant = vertexVariant.hash(),
+            .fragmentVariant = fragmentVariant.hash(),
+            .stateHash = Shaders::hashCombine(_pipelineStateHash, static_cast<uint64_t>(pass))
         };
 
-        if (vkCreatePipelineLayout(_vkDevice, &pipelineLayoutInfo, nullptr, &_vkPipelineLayout) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to create pipeline layout!");
+        auto cached = _pipelines.find(key);
+
+        if (cached != _pipelines.end())
+            return cached->second;
+
+        if (_pipelineTable.size() >= (size_t(1) << SortKey::PIPELINE_BITS))
+            Debug::errorWindow(L"too many pipelines for the sort keys!");
+
+        uint32_t pipelineId = static_cast<uint32_t>(_pipelineTable.size());
+
+        _pipelineTable.push_back(createGraphicsPipeline(vertexShader, vertexVariant, fragmentShader, fragmentVariant, pass));
+        _pipelines.emplace(key, pipelineId);
+
+        return pipelineId;
     }
 
-    void Engine::createPipeline() {
+    VkPipeline Engine::createGraphicsPipeline(Shaders::ShaderId vertexShader, Shaders::ShaderVariant& vertexVariant, Shaders::ShaderId fragmentShader, Shaders::ShaderVariant& fragmentVariant, PipelinePass pass) {
 
-        auto shaderStages = loadShaderModules("simpletriangleShader");
-        auto vertex = inputVertexState();
-        auto assembly = inputAssemblyState();
+        auto shaderStages = loadShaderModules(vertexShader, vertexVariant, fragmentShader, fragmentVariant);
+        Shaders::ShaderId shaders[] = { vertexShader, fragmentShader };
+
+        auto vertex = inputVertexState(_layoutCache.reflection(vertexShader), pass);
+        auto assembly = inputAssemblyState(pass);
         //Tessellation would have go here;
         auto viewport = viewportState();
-        auto rasterization = rasterizationState();
+        auto rasterization = rasterizationState(pass);
         auto multisampling = multisamplingState();
-        //DepthStencil would have go here;
-        auto colorBlend = colorBlendState();
+        auto depthStencil = depthStencilState(pass);
+        auto colorBlend = colorBlendState(pass);
         auto dynamic = pipelineDynamicState();
 
-        createRenderPass();
-        createPipelineLayout();
-
         VkGraphicsPipelineCreateInfo pipelineInfo {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
             .pNext = nullptr,
@@ -831,17 +1783,20 @@ namespace EggyEngine {
             .pViewportState = &viewport,
             .pRasterizationState = &rasterization,
             .pMultisampleState = &multisampling,
-            .pDepthStencilState = nullptr,
+            .pDepthStencilState = &depthStencil,
             .pColorBlendState = &colorBlend,
             .pDynamicState = &dynamic,
-            .layout = _vkPipelineLayout,
+            //The pre-pass shares the mesh layout, so the light set bound for the queue stays valid across both passes
+            .layout = pass == PipelinePass::DepthPrepass ? _vkPipelineLayout : _layoutCache.pipelineLayout(shaders),
             .renderPass = _vkRenderPass,
-            .subpass = 0,
+            .subpass = subpassIndex(pass),
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = -1
         };
 
-        if (vkCreateGraphicsPipelines(_vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_vkGraphicsPipeline) != VK_SUCCESS)
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        if (vkCreateGraphicsPipelines(_vkDevice, _vkPipelineCache, 1, &pipelineInfo, _vkAllocator, &pipeline) != VK_SUCCESS)
             Debug::errorWindow(L"Error creating Graphics Pipeline!");
 
         //Once created the pipeline we need to destroy the variables created on the heap.
@@ -850,54 +1805,172 @@ namespace EggyEngine {
         delete viewport.pScissors;
         delete colorBlend.pAttachments;
         delete[] dynamic.pDynamicStates;
+
+        return pipeline;
     }
     
 //End Pass
 
-//Draw Pass
+//Mesh Pass
 
-    void Engine::createFramebuffers() {
+    LodSelectionStats Engine::lodStats() const {
 
-        _swapChainFramebuffers.resize(_swapChainImageViews.size());
+        std::lock_guard lock(_lodStatsMutex);
+        return _lodStats;
+    }
 
-        VkFramebufferCreateInfo framebufferInfo{
-            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .renderPass = _vkRenderPass,
-            .attachmentCount = 1,
-            .pAttachments = nullptr,
-            .width = _swapChainExtent.width,
-            .height = _swapChainExtent.height,
-            .layers = 1
+    void Engine::loadMeshPack() {
+
+        if (_settings.meshPackPath.empty())
+            return;
+
+        Loader::MeshPackView pack;
+
+        try {
+            pack.open(_settings.meshPackPath);
+        }
+        catch (std::exception& e) {
+            std::cerr << _settings.meshPackPath << ": " << e.what() << std::endl;
+            Debug::errorWindow(L"failed to load mesh pack!");
+        }
+
+        const auto& header = pack.header();
+
+        if (header.meshCount == 0 || header.vertexDataSize == 0 || header.indexDataSize == 0)
+            return;
+
+        //meshShader expects the converter's quantized layout
+        const auto* position = pack.findAttribute(Loader::VertexSemantic::Position);
+        const auto* normal = pack.findAttribute(Loader::VertexSemantic::Normal);
+
+        if (position == nullptr || normal == nullptr || normal->format != VK_FORMAT_R16G16_SNORM)
+            Debug::errorWindow(L"unsupported mesh pack layout, rerun MeshConverter!");
+
+        _meshes.assign(pack.meshes().begin(), pack.meshes().end());
+        _meshLods.assign(pack.lods().begin(), pack.lods().end());
+        _meshIndexType = header.indexType;
+        _meshPackFlags = header.flags;
+
+        std::copy(header.boundsMin, header.boundsMin + 3, _meshBoundsMin);
+        std::copy(header.boundsMax, header.boundsMax + 3, _meshBoundsMax);
+
+        _meshBinding = {
+            .binding = 0,
+            .stride = header.vertexStride,
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
         };
 
-        for (size_t i = 0; i < _swapChainImageViews.size(); i++) {
+        _meshAttributes.clear();
 
-            VkImageView attachment[] = { _swapChainImageViews[i] };
+        for (uint32_t i = 0; i < header.attributeCount; i++)
+            _meshAttributes.push_back({
+                .location = header.attributes[i].location,
+                .binding = 0,
+                .format = header.attributes[i].format,
+                .offset = header.attributes[i].offset
+            });
 
-            framebufferInfo.pAttachments = attachment;
+        //The pre-pass reads positions from their own tightly packed stream, it goes right after the interleaved vertices
+        uint32_t positionSize = Shaders::formatSize(position->format);
+        uint64_t vertexCount = header.vertexDataSize / header.vertexStride;
 
-            if (vkCreateFramebuffer(_vkDevice, &framebufferInfo, nullptr, &_swapChainFramebuffers[i]) != VK_SUCCESS)
-                Debug::errorWindow(L"failed to create framebuffer!");
+        VkDeviceSize positionStreamSize = _settings.depthPrepass ? vertexCount * positionSize : 0;
+        _positionStreamOffset = (header.vertexDataSize + 15) & ~VkDeviceSize(15);
+
+        if (positionSize == 0)
+            Debug::errorWindow(L"unsupported mesh pack layout, rerun MeshConverter!");
+
+        _positionBinding = {
+            .binding = 0,
+            .stride = positionSize,
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        };
+
+        _positionAttribute = {
+            .location = position->location,
+            .binding = 0,
+            .format = position->format,
+            .offset = 0
+        };
+
+        VkDeviceSize vertexBufferSize = positionStreamSize > 0 ? _positionStreamOffset + positionStreamSize : header.vertexDataSize;
+
+        //One staging buffer for everything, the copy reads straight from the mapped file
+        VkDeviceSize stagingSize = vertexBufferSize + header.indexDataSize;
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+
+        createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging, stagingBuffer, stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(_vkDevice, stagingBufferMemory, 0, stagingSize, 0, &data);
+        std::memcpy(data, pack.vertexData(), header.vertexDataSize);
+
+        if (positionStreamSize > 0) {
+
+            const uint8_t* source = pack.vertexData() + position->offset;
+            uint8_t* destination = static_cast<uint8_t*>(data) + _positionStreamOffset;
+
+            for (uint64_t vertex = 0; vertex < vertexCount; vertex++)
+                std::memcpy(destination + vertex * positionSize, source + vertex * header.vertexStride, positionSize);
         }
+
+        std::memcpy(static_cast<uint8_t*>(data) + vertexBufferSize, pack.indexData(), header.indexDataSize);
+        vkUnmapMemory(_vkDevice, stagingBufferMemory);
+
+        createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _vkVertexBuffer, _vkVertexBufferMemory);
+        createBuffer(header.indexDataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _vkIndexBuffer, _vkIndexBufferMemory);
+
+        VkBufferCopy regions[] = {
+            { .srcOffset = 0, .dstOffset = 0, .size = vertexBufferSize },
+            { .srcOffset = vertexBufferSize, .dstOffset = 0, .size = header.indexDataSize }
+        };
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, _vkVertexBuffer, 1, &regions[0]);
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, _vkIndexBuffer, 1, &regions[1]);
+        endSingleTimeCommands(commandBuffer);
+
+        vkDestroyBuffer(_vkDevice, stagingBuffer, _vkAllocator);
+        freeMemory(stagingBufferMemory);
     }
 
-    void Engine::createCommandPool() {
+    void Engine::destroyMeshes() {
 
-        VkCommandPoolCreateInfo poolInfo{
-            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        vkDestroyBuffer(_vkDevice, _vkIndexBuffer, _vkAllocator);
+        freeMemory(_vkIndexBufferMemory);
+
+        vkDestroyBuffer(_vkDevice, _vkVertexBuffer, _vkAllocator);
+        freeMemory(_vkVertexBufferMemory);
+    }
+
+    void Engine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+
+        VkBufferCreateInfo bufferInfo{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
             .pNext = nullptr,
-            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-            .queueFamilyIndex = indices.graphicsFamily
+            .flags = 0,
+            .size = size,
+            .usage = usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr
         };
 
-        if (vkCreateCommandPool(_vkDevice, &poolInfo, nullptr, &_vkCommandPool) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to create command pool!");
+        if (vkCreateBuffer(_vkDevice, &bufferInfo, _vkAllocator, &buffer) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create buffer!");
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(_vkDevice, buffer, &memRequirements);
+
+        bufferMemory = allocateMemory(memRequirements, properties, category);
+
+        vkBindBufferMemory(_vkDevice, buffer, bufferMemory, 0);
     }
 
-    void Engine::createCommandBuffer() {
-        
+    VkCommandBuffer Engine::beginSingleTimeCommands() {
+
         VkCommandBufferAllocateInfo allocInfo{
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
             .pNext = nullptr,
@@ -906,36 +1979,1908 @@ namespace EggyEngine {
             .commandBufferCount = 1
         };
 
-        if (vkAllocateCommandBuffers(_vkDevice, &allocInfo, &_vkCommandBuffer) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to allocate command buffers!");
-    }
+        VkCommandBuffer commandBuffer;
 
-    void Engine::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        if (vkAllocateCommandBuffers(_vkDevice, &allocInfo, &commandBuffer) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate command buffers!");
 
         VkCommandBufferBeginInfo beginInfo{
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
             .pNext = nullptr,
-            .flags = 0,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
             .pInheritanceInfo = nullptr
         };
 
-        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        return commandBuffer;
+    }
+
+    void Engine::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        //Load time only, waiting for the queue is fine here
+        vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(_graphicsQueue);
+
+        vkFreeCommandBuffers(_vkDevice, _vkCommandPool, 1, &commandBuffer);
+    }
+
+    Engine::MeshCamera Engine::meshCamera(const SceneSnapshot& scene) {
+
+        glm::vec3 boundsMin(_meshBoundsMin[0], _meshBoundsMin[1], _meshBoundsMin[2]);
+        glm::vec3 boundsMax(_meshBoundsMax[0], _meshBoundsMax[1], _meshBoundsMax[2]);
+
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = std::max(glm::length(boundsMax - boundsMin) * 0.5f, 0.001f);
+
+        //Slow orbit around the pack, driven by the simulation clock so it stays smooth with interpolation.
+        //It also drifts in and out so the LOD levels get exercised.
+        float time = static_cast<float>(scene.simulationTime);
+        float angle = time * 0.5f;
+        float distance = radius * (2.5f + 12.5f * (1.0f - std::cos(time * 0.2f)));
+
+        glm::vec3 eye = center + glm::normalize(glm::vec3(std::cos(angle), 0.5f, std::sin(angle))) * distance;
+
+        float fovY = glm::radians(45.0f);
+        float aspect = _swapChainExtent.width / (float)_swapChainExtent.height;
+        float nearPlane = radius * 0.05f;
+        float farPlane = distance + radius * 2.0f;
+
+        glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(fovY, aspect, nearPlane, farPlane);
+
+        //GLM is made for OpenGL where clip space Y points up
+        projection[1][1] *= -1;
+
+        return {
+            .view = view,
+            .viewProjection = projection * view,
+            .eye = eye,
+            .projectionScale = LodSelector::projectionScale(static_cast<float>(_swapChainExtent.height), fovY),
+            .farPlane = farPlane,
+            .nearPlane = nearPlane,
+            .tanHalfFovX = std::tan(fovY * 0.5f) * aspect,
+            .tanHalfFovY = std::tan(fovY * 0.5f)
+        };
+    }
+
+    void Engine::prepareMeshDraws(const SceneSnapshot& scene) {
+
+        MeshCamera camera = meshCamera(scene);
+
+        _lodSelector.beginFrame(_meshes.size());
+        _meshDraws.clear();
+
+        for (uint32_t meshIndex = 0; meshIndex < _meshes.size(); meshIndex++) {
+
+            const auto& mesh = _meshes[meshIndex];
+
+            //Position dequantization, the camera comes from the light buffer
+            glm::mat4 world(1.0f);
+
+            if (_meshPackFlags & Loader::MESH_PACK_FLAG_QUANTIZED_POSITIONS) {
+
+                glm::vec3 boundsMin(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2]);
+                glm::vec3 boundsMax(mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2]);
+
+                world = glm::scale(glm::translate(world, boundsMin), boundsMax - boundsMin);
+            }
+
+            const auto& lod = _meshLods[mesh.firstLod + selectMeshLod(meshIndex, camera)];
+
+            _meshDraws.push_back({
+                .constants = { world },
+                .indexCount = lod.indexCount,
+                .firstIndex = lod.firstIndex,
+                .vertexOffset = static_cast<int32_t>(mesh.firstVertex)
+            });
+        }
+
+        {
+            std::lock_guard lock(_lodStatsMutex);
+            _lodStats = _lodSelector.stats();
+        }
+
+        //Variants are specialized pipelines, switching shading never branches in the shader
+        uint32_t colorPipeline = meshPipeline(scene.meshShading);
+        uint32_t prepassPipeline = _depthPrepass ? depthPrepassPipeline() : 0;
+
+        for (uint32_t drawIndex = 0; drawIndex < _meshDraws.size(); drawIndex++) {
+
+            const auto& mesh = _meshes[drawIndex];
+
+            //Front to back, closer opaque draws fill depth first and later ones fail early
+            glm::vec3 sphereCenter(mesh.sphereCenter[0], mesh.sphereCenter[1], mesh.sphereCenter[2]);
+            uint32_t depth = SortKey::quantizeDepth(glm::length(sphereCenter - camera.eye) / camera.farPlane);
+
+            //Meshes have no materials of their own yet, they all share material 0
+            if (_depthPrepass)
+                _renderQueue.submit(SortKey::make(subpassIndex(PipelinePass::DepthPrepass), prepassPipeline, 0, depth), drawIndex);
+
+            _renderQueue.submit(SortKey::make(subpassIndex(PipelinePass::Color), colorPipeline, 0, depth), drawIndex);
+        }
+
+        _renderQueue.sort();
+
+        if (_occlusionCulling)
+            writeCullDraws(camera);
+    }
+
+    void Engine::recordRenderQueue(VkCommandBuffer commandBuffer, uint32_t phase) {
+
+        uint32_t subpass = 0;
+
+        //Every variant and the pre-pass share the layout and read the camera from it, only the lit variant reads the clusters
+        _renderQueue.bindDescriptorSet(commandBuffer, _vkPipelineLayout, 0, _lightingDrawSets[_currentFrame]);
+
+        for (const auto& entry : _renderQueue.entries()) {
+
+            //The pass is the top of the key, so each subpass is one contiguous run
+            for (; subpass < SortKey::pass(entry.key); subpass++)
+                vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+            bool positionsOnly = _depthPrepass && subpass == subpassIndex(PipelinePass::DepthPrepass);
+
+            _renderQueue.bindPipeline(commandBuffer, _pipelineTable[SortKey::pipeline(entry.key)]);
+            _renderQueue.bindVertexBuffer(commandBuffer, _vkVertexBuffer, positionsOnly ? _positionStreamOffset : 0);
+            _renderQueue.bindIndexBuffer(commandBuffer, _vkIndexBuffer, 0, _meshIndexType);
+
+            const auto& draw = _meshDraws[entry.payload];
+
+            //The pre-pass declares the same push constants, so they are the same for both passes
+            vkCmdPushConstants(commandBuffer, _vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshDraw::Constants), &draw.constants);
+
+            //The culling pass wrote the same command, with no instances when the draw is hidden
+            if (_occlusionCulling)
+                vkCmdDrawIndexedIndirect(commandBuffer, _drawCommandBuffer, (VkDeviceSize(phase) * _meshDraws.size() + entry.payload) * sizeof(VkDrawIndexedIndirectCommand),
+                    1, sizeof(VkDrawIndexedIndirectCommand));
+            else
+                vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0);
+
+            _renderQueue.countDraw();
+        }
+
+        //Every subpass has to be walked through even when nothing was drawn in it
+        for (; subpass < subpassIndex(PipelinePass::Color); subpass++)
+            vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    void Engine::meshBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+
+        boundsMin = glm::vec3(_meshBoundsMin[0], _meshBoundsMin[1], _meshBoundsMin[2]);
+        boundsMax = glm::vec3(_meshBoundsMax[0], _meshBoundsMax[1], _meshBoundsMax[2]);
+    }
+
+    RenderQueueStats Engine::renderQueueStats() const {
+
+        std::lock_guard lock(_renderQueueStatsMutex);
+        return _renderQueueStats;
+    }
+
+    uint32_t Engine::selectMeshLod(uint32_t meshIndex, const MeshCamera& camera) {
+
+        const auto& mesh = _meshes[meshIndex];
+
+        glm::vec3 center(mesh.sphereCenter[0], mesh.sphereCenter[1], mesh.sphereCenter[2]);
+
+        //Closest point of the bounding sphere, so the error is never underestimated
+        float distance = glm::length(center - camera.eye) - mesh.sphereRadius;
+
+        std::span<const Loader::MeshPackLod> lods(_meshLods.data() + mesh.firstLod, mesh.lodCount);
+
+        return _lodSelector.select(meshIndex, lods, distance, camera.projectionScale);
+    }
+
+//End Pass
+
+//Lighting Pass
+
+    void Engine::createLighting() {
+
+        const auto& settings = _settings.lighting;
+
+        uint32_t clusterCount = settings.clustersX * settings.clustersY * settings.clustersZ;
+
+        if (clusterCount == 0)
+            Debug::errorWindow(L"light cluster grid can't be empty!");
+
+        _lightIndexCapacity = clusterCount * std::max(settings.averageLightsPerCluster, 1u);
+
+        VkDeviceSize lightBytes = sizeof(LightDataHeader) + VkDeviceSize(settings.maxLights) * sizeof(PointLight);
+
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+            //Rewritten every frame and read once by every cluster and lit fragment, so it stays in host visible memory
+            createBuffer(lightBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                MemoryCategory::Buffer, _lightBuffers[i], _lightBufferMemory[i]);
+
+            void* mapped;
+            vkMapMemory(_vkDevice, _lightBufferMemory[i], 0, lightBytes, 0, &mapped);
+            _lightData[i] = static_cast<LightDataHeader*>(mapped);
+        }
+
+        createBuffer(VkDeviceSize(clusterCount) * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _clusterBuffer, _clusterBufferMemory);
+
+        createBuffer(VkDeviceSize(_lightIndexCapacity) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _lightIndexBuffer, _lightIndexBufferMemory);
+
+        createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _lightCounterBuffer, _lightCounterBufferMemory);
+
+        Shaders::ShaderId binningShaders[] = { Shaders::ShaderId::LightClusterComp };
+
+        _lightBinningLayout = _layoutCache.pipelineLayout(binningShaders);
+
+        if (_layoutCache.reflection(Shaders::ShaderId::LightClusterComp).workgroupSize[0] != LIGHT_CLUSTER_WORKGROUP_SIZE)
+            Debug::errorWindow(L"lightCluster.comp and LIGHT_CLUSTER_WORKGROUP_SIZE disagree!");
+
+        Shaders::ShaderVariant noVariant{};
+
+        _lightBinningPipeline = createComputePipeline(Shaders::ShaderId::LightClusterComp, noVariant, _lightBinningLayout);
+
+        //Per frame in flight: lights, clusters, indices and counter for the binning, the first three for the draw
+        VkDescriptorPoolSize poolSize{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 7 * MAX_FRAMES_IN_FLIGHT
+        };
+
+        VkDescriptorPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = 2 * MAX_FRAMES_IN_FLIGHT,
+            .poolSizeCount = 1,
+            .pPoolSizes = &poolSize
+        };
+
+        if (vkCreateDescriptorPool(_vkDevice, &poolInfo, _vkAllocator, &_lightingDescriptorPool) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create lighting descriptor pool!");
+
+        auto binningSetLayouts = _layoutCache.setLayouts(_lightBinningLayout);
+        auto drawSetLayouts = _layoutCache.setLayouts(_vkPipelineLayout);
+
+        if (binningSetLayouts.empty() || drawSetLayouts.empty())
+            Debug::errorWindow(L"lighting shaders don't declare their buffers!");
+
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+
+            VkDescriptorSetLayout setLayouts[] = { binningSetLayouts[0], drawSetLayouts[0] };
+            VkDescriptorSet sets[2];
+
+            VkDescriptorSetAllocateInfo allocInfo{
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .descriptorPool = _lightingDescriptorPool,
+                .descriptorSetCount = 2,
+                .pSetLayouts = setLayouts
+            };
+
+            if (vkAllocateDescriptorSets(_vkDevice, &allocInfo, sets) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to allocate lighting descriptor sets!");
+
+            _lightBinningSets[frame] = sets[0];
+            _lightingDrawSets[frame] = sets[1];
+
+            VkDescriptorBufferInfo bufferInfos[] = {
+                { .buffer = _lightBuffers[frame], .offset = 0, .range = VK_WHOLE_SIZE },
+                { .buffer = _clusterBuffer, .offset = 0, .range = VK_WHOLE_SIZE },
+                { .buffer = _lightIndexBuffer, .offset = 0, .range = VK_WHOLE_SIZE },
+                { .buffer = _lightCounterBuffer, .offset = 0, .range = VK_WHOLE_SIZE }
+            };
+
+            VkWriteDescriptorSet writes[7]{};
+
+            //Bindings 0 to 3 of the binning set, 0 to 2 of the draw set
+            for (uint32_t write = 0; write < 7; write++) {
+
+                uint32_t binding = write < 4 ? write : write - 4;
+
+                writes[write] = {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .pNext = nullptr,
+                    .dstSet = write < 4 ? _lightBinningSets[frame] : _lightingDrawSets[frame],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pImageInfo = nullptr,
+                    .pBufferInfo = &bufferInfos[binding],
+                    .pTexelBufferView = nullptr
+                };
+            }
+
+            vkUpdateDescriptorSets(_vkDevice, 7, writes, 0, nullptr);
+        }
+    }
+
+    void Engine::destroyLighting() {
+
+        vkDestroyDescriptorPool(_vkDevice, _lightingDescriptorPool, _vkAllocator);
+
+        vkDestroyBuffer(_vkDevice, _lightCounterBuffer, _vkAllocator);
+        freeMemory(_lightCounterBufferMemory);
+
+        vkDestroyBuffer(_vkDevice, _lightIndexBuffer, _vkAllocator);
+        freeMemory(_lightIndexBufferMemory);
+
+        vkDestroyBuffer(_vkDevice, _clusterBuffer, _vkAllocator);
+        freeMemory(_clusterBufferMemory);
+
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+            vkDestroyBuffer(_vkDevice, _lightBuffers[i], _vkAllocator);
+            freeMemory(_lightBufferMemory[i]);
+        }
+    }
+
+    void Engine::uploadLights(const std::vector<PointLight>& lights, const SceneSnapshot& scene) {
+
+        const auto& settings = _settings.lighting;
+
+        MeshCamera camera = meshCamera(scene);
+
+        uint32_t lightCount = static_cast<uint32_t>(std::min<size_t>(lights.size(), settings.maxLights));
+
+        //slice = log(depth / near) / log(far / near) * clustersZ, split into a scale and a bias on log(depth)
+        float sliceScale = settings.clustersZ / std::log(camera.farPlane / camera.nearPlane);
+
+        LightDataHeader* header = _lightData[_currentFrame];
+
+        *header = {
+            .view = camera.view,
+            .projection = glm::vec4(camera.tanHalfFovX, camera.tanHalfFovY, camera.nearPlane, camera.farPlane),
+            .clusterScale = glm::vec4(
+                settings.clustersX / static_cast<float>(_swapChainExtent.width),
+                settings.clustersY / static_cast<float>(_swapChainExtent.height),
+                sliceScale,
+                -sliceScale * std::log(camera.nearPlane)),
+            .clusterGrid = { settings.clustersX, settings.clustersY, settings.clustersZ, 0 },
+            .counts = { lightCount, _lightIndexCapacity, 0, 0 },
+            .viewProjection = camera.viewProjection
+        };
+
+        //The lights sit right after the header
+        std::memcpy(reinterpret_cast<uint8_t*>(header) + sizeof(LightDataHeader), lights.data(), lightCount * sizeof(PointLight));
+    }
+
+    void Engine::recordLightBinning(VkCommandBuffer commandBuffer) {
+
+        const auto& settings = _settings.lighting;
+
+        uint32_t clusterCount = settings.clustersX * settings.clustersY * settings.clustersZ;
+
+        //Last frame's fragments are done with the clusters and its binning with the counter before they are rewritten
+        VkMemoryBarrier reuseBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &reuseBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdFillBuffer(commandBuffer, _lightCounterBuffer, 0, VK_WHOLE_SIZE, 0);
+
+        VkMemoryBarrier clearBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _lightBinningPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _lightBinningLayout, 0, 1, &_lightBinningSets[_currentFrame], 0, nullptr);
+        vkCmdDispatch(commandBuffer, (clusterCount + LIGHT_CLUSTER_WORKGROUP_SIZE - 1) / LIGHT_CLUSTER_WORKGROUP_SIZE, 1, 1);
+
+        //Cluster lists for the lit fragments of this frame
+        VkMemoryBarrier binningBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &binningBarrier, 0, nullptr, 0, nullptr);
+    }
+
+//End Pass
+
+//Occlusion Pass
+
+    void Engine::createOcclusionCulling() {
+
+        uint32_t drawCount = static_cast<uint32_t>(_meshes.size());
+
+        //Power of two levels halve exactly, so every texel below level 0 covers 2x2 of the one above
+        _depthPyramidWidth = std::bit_floor(_swapChainExtent.width);
+        _depthPyramidHeight = std::bit_floor(_swapChainExtent.height);
+        _depthPyramidLevels = static_cast<uint32_t>(std::bit_width(std::max(_depthPyramidWidth, _depthPyramidHeight)));
+
+        VkImageCreateInfo imageInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .extent = { _depthPyramidWidth, _depthPyramidHeight, 1 },
+            .mipLevels = _depthPyramidLevels,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+        };
+
+        if (vkCreateImage(_vkDevice, &imageInfo, _vkAllocator, &_depthPyramid) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create depth pyramid!");
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(_vkDevice, _depthPyramid, &memRequirements);
+
+        _depthPyramidMemory = allocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Image);
+
+        vkBindImageMemory(_vkDevice, _depthPyramid, _depthPyramidMemory, 0);
+
+        VkImageViewCreateInfo viewInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .image = _depthPyramid,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY },
+            .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, _depthPyramidLevels, 0, 1 }
+        };
+
+        if (vkCreateImageView(_vkDevice, &viewInfo, _vkAllocator, &_depthPyramidView) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create depth pyramid view!");
+
+        _depthPyramidLevelViews.resize(_depthPyramidLevels);
+
+        for (uint32_t level = 0; level < _depthPyramidLevels; level++) {
+
+            viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+            if (vkCreateImageView(_vkDevice, &viewInfo, _vkAllocator, &_depthPyramidLevelViews[level]) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to create depth pyramid view!");
+        }
+
+        //Only ever read with texelFetch, the filter doesn't matter
+        VkSamplerCreateInfo samplerInfo{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .magFilter = VK_FILTER_NEAREST,
+            .minFilter = VK_FILTER_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .mipLodBias = 0.0f,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0f,
+            .compareEnable = VK_FALSE,
+            .compareOp = VK_COMPARE_OP_ALWAYS,
+            .minLod = 0.0f,
+            .maxLod = static_cast<float>(_depthPyramidLevels),
+            .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+            .unnormalizedCoordinates = VK_FALSE
+        };
+
+        if (vkCreateSampler(_vkDevice, &samplerInfo, _vkAllocator, &_depthPyramidSampler) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create depth pyramid sampler!");
+
+        //GENERAL for good, the reduction writes it as a storage image and reads it back as a texture
+        VkImageMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = _depthPyramid,
+            .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, _depthPyramidLevels, 0, 1 }
+        };
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        endSingleTimeCommands(commandBuffer);
+
+        VkDeviceSize cullDataBytes = sizeof(CullDataHeader) + VkDeviceSize(drawCount) * sizeof(CullDraw);
+
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+            createBuffer(cullDataBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                MemoryCategory::Buffer, _cullDataBuffers[i], _cullDataBufferMemory[i]);
+
+            void* mapped;
+            vkMapMemory(_vkDevice, _cullDataBufferMemory[i], 0, cullDataBytes, 0, &mapped);
+            _cullData[i] = static_cast<CullDataHeader*>(mapped);
+        }
+
+        createBuffer(VkDeviceSize(OCCLUSION_PHASE_COUNT) * drawCount * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _drawCommandBuffer, _drawCommandBufferMemory);
+
+        Shaders::ShaderId reduceShaders[] = { Shaders::ShaderId::HiZReduceComp };
+        Shaders::ShaderId reduceMultisampleShaders[] = { Shaders::ShaderId::HiZReduceMultisampleComp };
+        Shaders::ShaderId cullShaders[] = { Shaders::ShaderId::OcclusionCullComp };
+
+        _depthReduceLayout = _layoutCache.pipelineLayout(reduceShaders);
+        _cullLayout = _layoutCache.pipelineLayout(cullShaders);
+
+        for (auto shader : { Shaders::ShaderId::HiZReduceComp, Shaders::ShaderId::HiZReduceMultisampleComp })
+            if (_layoutCache.reflection(shader).workgroupSize[0] != DEPTH_REDUCE_WORKGROUP_SIZE || _layoutCache.reflection(shader).workgroupSize[1] != DEPTH_REDUCE_WORKGROUP_SIZE)
+                Debug::errorWindow(L"depth pyramid shaders and DEPTH_REDUCE_WORKGROUP_SIZE disagree!");
+
+        if (_layoutCache.reflection(Shaders::ShaderId::OcclusionCullComp).workgroupSize[0] != OCCLUSION_CULL_WORKGROUP_SIZE)
+            Debug::errorWindow(L"occlusionCull.comp and OCCLUSION_CULL_WORKGROUP_SIZE disagree!");
+
+        Shaders::ShaderVariant noVariant{};
+
+        _depthReducePipeline = createComputePipeline(Shaders::ShaderId::HiZReduceComp, noVariant, _depthReduceLayout);
+        _cullPipeline = createComputePipeline(Shaders::ShaderId::OcclusionCullComp, noVariant, _cullLayout);
+
+        //Multisampled depth can't be read through a sampler2D, level 0 fetches every sample instead
+        if (msaaEnabled()) {
+
+            _depthReduceMultisampleLayout = _layoutCache.pipelineLayout(reduceMultisampleShaders);
+            _depthReduceMultisamplePipeline = createComputePipeline(Shaders::ShaderId::HiZReduceMultisampleComp, noVariant, _depthReduceMultisampleLayout);
+        }
+
+        //Per level: the level above or the depth buffer, and the level written. Per frame in flight: draws, commands and the pyramid
+        VkDescriptorPoolSize poolSizes[] = {
+            { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = _depthPyramidLevels + MAX_FRAMES_IN_FLIGHT },
+            { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = _depthPyramidLevels },
+            { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 2 * MAX_FRAMES_IN_FLIGHT }
+        };
+
+        VkDescriptorPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = _depthPyramidLevels + MAX_FRAMES_IN_FLIGHT,
+            .poolSizeCount = 3,
+            .pPoolSizes = poolSizes
+        };
+
+        if (vkCreateDescriptorPool(_vkDevice, &poolInfo, _vkAllocator, &_occlusionDescriptorPool) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create occlusion descriptor pool!");
+
+        auto reduceSetLayouts = _layoutCache.setLayouts(_depthReduceLayout);
+        auto cullSetLayouts = _layoutCache.setLayouts(_cullLayout);
+
+        if (reduceSetLayouts.empty() || cullSetLayouts.empty())
+            Debug::errorWindow(L"occlusion shaders don't declare their resources!");
+
+        std::vector<VkDescriptorSetLayout> setLayouts(_depthPyramidLevels, reduceSetLayouts[0]);
+
+        if (msaaEnabled())
+            setLayouts[0] = _layoutCache.setLayouts(_depthReduceMultisampleLayout)[0];
+
+        setLayouts.insert(setLayouts.end(), MAX_FRAMES_IN_FLIGHT, cullSetLayouts[0]);
+
+        std::vector<VkDescriptorSet> sets(setLayouts.size());
+
+        VkDescriptorSetAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = _occlusionDescriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data()
+        };
+
+        if (vkAllocateDescriptorSets(_vkDevice, &allocInfo, sets.data()) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate occlusion descriptor sets!");
+
+        _depthReduceSets.assign(sets.begin(), sets.begin() + _depthPyramidLevels);
+
+        for (uint32_t level = 0; level < _depthPyramidLevels; level++) {
+
+            //Level 0 reads depth in the layout the early render pass leaves it in
+            VkDescriptorImageInfo sourceInfo{
+                .sampler = _depthPyramidSampler,
+                .imageView = level == 0 ? _depthTarget.view : _depthPyramidLevelViews[level - 1],
+                .imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            VkDescriptorImageInfo destinationInfo{
+                .sampler = VK_NULL_HANDLE,
+                .imageView = _depthPyramidLevelViews[level],
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            VkWriteDescriptorSet writes[2]{};
+
+            for (uint32_t binding = 0; binding < 2; binding++)
+                writes[binding] = {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .pNext = nullptr,
+                    .dstSet = _depthReduceSets[level],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .pImageInfo = binding == 0 ? &sourceInfo : &destinationInfo,
+                    .pBufferInfo = nullptr,
+                    .pTexelBufferView = nullptr
+                };
+
+            vkUpdateDescriptorSets(_vkDevice, 2, writes, 0, nullptr);
+        }
+
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+
+            _cullSets[frame] = sets[_depthPyramidLevels + frame];
+
+            VkDescriptorBufferInfo cullDataInfo{ .buffer = _cullDataBuffers[frame], .offset = 0, .range = VK_WHOLE_SIZE };
+            VkDescriptorBufferInfo commandInfo{ .buffer = _drawCommandBuffer, .offset = 0, .range = VK_WHOLE_SIZE };
+
+            VkDescriptorImageInfo pyramidInfo{
+                .sampler = _depthPyramidSampler,
+                .imageView = _depthPyramidView,
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+            };
+
+            VkWriteDescriptorSet writes[3]{};
+
+            const VkDescriptorBufferInfo* bufferBindings[] = { &cullDataInfo, &commandInfo };
+
+            for (uint32_t binding = 0; binding < 3; binding++)
+                writes[binding] = {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .pNext = nullptr,
+                    .dstSet = _cullSets[frame],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = binding < 2 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = binding < 2 ? nullptr : &pyramidInfo,
+                    .pBufferInfo = binding < 2 ? bufferBindings[binding] : nullptr,
+                    .pTexelBufferView = nullptr
+                };
+
+            vkUpdateDescriptorSets(_vkDevice, 3, writes, 0, nullptr);
+        }
+    }
+
+    void Engine::destroyOcclusionCulling() {
+
+        vkDestroyDescriptorPool(_vkDevice, _occlusionDescriptorPool, _vkAllocator);
+
+        vkDestroyBuffer(_vkDevice, _drawCommandBuffer, _vkAllocator);
+        freeMemory(_drawCommandBufferMemory);
+
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+            vkDestroyBuffer(_vkDevice, _cullDataBuffers[i], _vkAllocator);
+            freeMemory(_cullDataBufferMemory[i]);
+        }
+
+        vkDestroySampler(_vkDevice, _depthPyramidSampler, _vkAllocator);
+
+        for (auto view : _depthPyramidLevelViews)
+            vkDestroyImageView(_vkDevice, view, _vkAllocator);
+
+        vkDestroyImageView(_vkDevice, _depthPyramidView, _vkAllocator);
+        vkDestroyImage(_vkDevice, _depthPyramid, _vkAllocator);
+        freeMemory(_depthPyramidMemory);
+    }
+
+    void Engine::writeCullDraws(const MeshCamera& camera) {
+
+        CullDataHeader* header = _cullData[_currentFrame];
+
+        *header = {
+            .viewProjection = camera.viewProjection,
+            .pyramid = { _depthPyramidWidth, _depthPyramidHeight, _depthPyramidLevels, _depthPyramidBuilt ? 1u : 0u },
+            .counts = { static_cast<uint32_t>(_meshDraws.size()), 0, 0, 0 }
+        };
+
+        //The draws sit right after the header, in _meshDraws order
+        CullDraw* draws = reinterpret_cast<CullDraw*>(reinterpret_cast<uint8_t*>(header) + sizeof(CullDataHeader));
+
+        for (uint32_t drawIndex = 0; drawIndex < _meshDraws.size(); drawIndex++) {
+
+            const auto& mesh = _meshes[drawIndex];
+            const auto& draw = _meshDraws[drawIndex];
+
+            draws[drawIndex] = {
+                .boundsMin = { mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2], 0.0f },
+                .boundsMax = { mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2], 0.0f },
+                .indexCount = draw.indexCount,
+                .firstIndex = draw.firstIndex,
+                .vertexOffset = draw.vertexOffset,
+                .padding = 0
+            };
+        }
+    }
+
+    void Engine::recordOcclusionCull(VkCommandBuffer commandBuffer, uint32_t phase) {
+
+        uint32_t drawCount = static_cast<uint32_t>(_meshDraws.size());
+
+        //Phase 0 overwrites what last frame's draws read, phase 1 reads the pyramid just built and the commands of phase 0
+        VkMemoryBarrier beforeBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &beforeBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullLayout, 0, 1, &_cullSets[_currentFrame], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, _cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase);
+        vkCmdDispatch(commandBuffer, (drawCount + OCCLUSION_CULL_WORKGROUP_SIZE - 1) / OCCLUSION_CULL_WORKGROUP_SIZE, 1, 1);
+
+        //Commands for this phase's draws and for phase 1
+        VkMemoryBarrier afterBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &afterBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    void Engine::recordDepthPyramid(VkCommandBuffer commandBuffer) {
+
+        //The early render pass' external dependency already made its depth visible to compute
+        VkMemoryBarrier levelBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+
+        //Last frame's culling still reads the pyramid about to be overwritten
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+
+        uint32_t sourceWidth = _swapChainExtent.width;
+        uint32_t sourceHeight = _swapChainExtent.height;
+
+        for (uint32_t level = 0; level < _depthPyramidLevels; level++) {
+
+            uint32_t width = std::max(_depthPyramidWidth >> level, 1u);
+            uint32_t height = std::max(_depthPyramidHeight >> level, 1u);
+
+            DepthReduceConstants constants{
+                .sourceSize = { sourceWidth, sourceHeight },
+                .destinationSize = { width, height }
+            };
+
+            bool multisample = level == 0 && msaaEnabled();
+
+            VkPipelineLayout layout = multisample ? _depthReduceMultisampleLayout : _depthReduceLayout;
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, multisample ? _depthReduceMultisamplePipeline : _depthReducePipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &_depthReduceSets[level], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthReduceConstants), &constants);
+            vkCmdDispatch(commandBuffer, (width + DEPTH_REDUCE_WORKGROUP_SIZE - 1) / DEPTH_REDUCE_WORKGROUP_SIZE, (height + DEPTH_REDUCE_WORKGROUP_SIZE - 1) / DEPTH_REDUCE_WORKGROUP_SIZE, 1);
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+
+            sourceWidth = width;
+            sourceHeight = height;
+        }
+
+        //Phase 1 of this frame and phase 0 of the next one test against it
+        _depthPyramidBuilt = true;
+    }
+
+//End Pass
+
+//Particle Pass
+
+    void Engine::createParticles() {
+
+        const auto& settings = _settings.particles;
+
+        VkDeviceSize particleBytes = VkDeviceSize(settings.capacity) * sizeof(GpuParticle);
+
+        //Never read or written by the CPU
+        for (uint32_t i = 0; i < 2; i++)
+            createBuffer(particleBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _particleBuffers[i], _particleBufferMemory[i]);
+
+        createBuffer(sizeof(ParticleCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _particleCounterBuffer, _particleCounterBufferMemory);
+
+        //No particles and empty indirect arguments, the first frame dispatches and draws nothing but the emission
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        vkCmdFillBuffer(commandBuffer, _particleCounterBuffer, 0, VK_WHOLE_SIZE, 0);
+
+        VkMemoryBarrier fillBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+        endSingleTimeCommands(commandBuffer);
+
+        //One layout for all the compute passes, so a single set per parity serves every dispatch
+        Shaders::ShaderId computeShaders[] = {
+            Shaders::ShaderId::ParticleEmitComp,
+            Shaders::ShaderId::ParticleSimulateComp,
+            Shaders::ShaderId::ParticleCompactComp,
+            Shaders::ShaderId::ParticleFinalizeComp
+        };
+
+        Shaders::ShaderId drawShaders[] = { Shaders::ShaderId::ParticleVert, Shaders::ShaderId::ParticleFrag };
+
+        _particleComputeLayout = _layoutCache.pipelineLayout(computeShaders);
+        _particleDrawLayout = _layoutCache.pipelineLayout(drawShaders);
+
+        for (auto shader : { Shaders::ShaderId::ParticleSimulateComp, Shaders::ShaderId::ParticleCompactComp })
+            if (_layoutCache.reflection(shader).workgroupSize[0] != PARTICLE_WORKGROUP_SIZE)
+                Debug::errorWindow(L"particle shaders and PARTICLE_WORKGROUP_SIZE disagree!");
+
+        _particleEmitWorkgroupSize = _layoutCache.reflection(Shaders::ShaderId::ParticleEmitComp).workgroupSize[0];
+
+        Shaders::ShaderVariant noVariant{};
+
+        _particleEmitPipeline = createComputePipeline(Shaders::ShaderId::ParticleEmitComp, noVariant, _particleComputeLayout);
+        _particleSimulatePipeline = createComputePipeline(Shaders::ShaderId::ParticleSimulateComp, noVariant, _particleComputeLayout);
+        _particleCompactPipeline = createComputePipeline(Shaders::ShaderId::ParticleCompactComp, noVariant, _particleComputeLayout);
+        _particleFinalizePipeline = createComputePipeline(Shaders::ShaderId::ParticleFinalizeComp, noVariant, _particleComputeLayout);
+
+        _particleDrawPipeline = requestPipeline(Shaders::ShaderId::ParticleVert, noVariant, Shaders::ShaderId::ParticleFrag, noVariant, PipelinePass::Particles);
+
+        //Per parity: source, destination and counters for compute, one particle buffer for the draw
+        VkDescriptorPoolSize poolSize{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 8
+        };
+
+        VkDescriptorPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = 4,
+            .poolSizeCount = 1,
+            .pPoolSizes = &poolSize
+        };
+
+        if (vkCreateDescriptorPool(_vkDevice, &poolInfo, _vkAllocator, &_particleDescriptorPool) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create particle descriptor pool!");
+
+        auto computeSetLayouts = _layoutCache.setLayouts(_particleComputeLayout);
+        auto drawSetLayouts = _layoutCache.setLayouts(_particleDrawLayout);
+
+        if (computeSetLayouts.empty() || drawSetLayouts.empty())
+            Debug::errorWindow(L"particle shaders don't declare their buffers!");
+
+        VkDescriptorSetLayout setLayouts[] = { computeSetLayouts[0], computeSetLayouts[0], drawSetLayouts[0], drawSetLayouts[0] };
+        VkDescriptorSet sets[4];
+
+        VkDescriptorSetAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = _particleDescriptorPool,
+            .descriptorSetCount = 4,
+            .pSetLayouts = setLayouts
+        };
+
+        if (vkAllocateDescriptorSets(_vkDevice, &allocInfo, sets) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate particle descriptor sets!");
+
+        for (uint32_t source = 0; source < 2; source++) {
+
+            _particleComputeSets[source] = sets[source];
+            _particleDrawSets[source] = sets[2 + source];
+
+            VkDescriptorBufferInfo sourceInfo{ .buffer = _particleBuffers[source], .offset = 0, .range = VK_WHOLE_SIZE };
+            VkDescriptorBufferInfo destinationInfo{ .buffer = _particleBuffers[1 - source], .offset = 0, .range = VK_WHOLE_SIZE };
+            VkDescriptorBufferInfo counterInfo{ .buffer = _particleCounterBuffer, .offset = 0, .range = VK_WHOLE_SIZE };
+
+            VkWriteDescriptorSet writes[4]{};
+
+            const VkDescriptorBufferInfo* computeBindings[] = { &sourceInfo, &destinationInfo, &counterInfo };
+
+            for (uint32_t binding = 0; binding < 3; binding++)
+                writes[binding] = {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .pNext = nullptr,
+                    .dstSet = _particleComputeSets[source],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pImageInfo = nullptr,
+                    .pBufferInfo = computeBindings[binding],
+                    .pTexelBufferView = nullptr
+                };
+
+            //Indexed by the buffer drawn rather than the one simulated
+            writes[3] = {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = _particleDrawSets[source],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo = nullptr,
+                .pBufferInfo = &sourceInfo,
+                .pTexelBufferView = nullptr
+            };
+
+            vkUpdateDescriptorSets(_vkDevice, 4, writes, 0, nullptr);
+        }
+    }
+
+    void Engine::destroyParticles() {
+
+        vkDestroyDescriptorPool(_vkDevice, _particleDescriptorPool, _vkAllocator);
+
+        vkDestroyBuffer(_vkDevice, _particleCounterBuffer, _vkAllocator);
+        freeMemory(_particleCounterBufferMemory);
+
+        for (uint32_t i = 0; i < 2; i++) {
+
+            vkDestroyBuffer(_vkDevice, _particleBuffers[i], _vkAllocator);
+            freeMemory(_particleBufferMemory[i]);
+        }
+    }
+
+    static void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+
+        VkMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = dstAccess
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void Engine::recordParticleSimulation(VkCommandBuffer commandBuffer, const SceneSnapshot& scene) {
+
+        const auto& settings = _settings.particles;
+
+        //Fractional particles carry over, so low rates at high frame rates still emit
+        _particleEmitDebt += settings.emitRate * scene.deltaTime;
+
+        uint32_t emitCount = static_cast<uint32_t>(std::min(_particleEmitDebt, static_cast<double>(settings.capacity)));
+        _particleEmitDebt = std::min(_particleEmitDebt - emitCount, 1.0);
+
+        _particleSeed += 0x9E3779B9u;
+
+        ParticleConstants constants{
+            .emitter = glm::vec4(settings.emitter[0], settings.emitter[1], settings.emitter[2], settings.spread),
+            .gravity = glm::vec4(settings.gravity[0], settings.gravity[1], settings.gravity[2], scene.deltaTime),
+            .speed = settings.speed,
+            .lifetime = settings.lifetime,
+            .emitCount = emitCount,
+            .capacity = settings.capacity,
+            .source = _particleSource,
+            .seed = _particleSeed
+        };
+
+        //The last frame's draw still reads the buffer simulated in place now, and its compaction target is written again
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _particleComputeLayout, 0, 1, &_particleComputeSets[_particleSource], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, _particleComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleConstants), &constants);
+
+        //Sized by the alive count the last frame's finalize wrote
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _particleSimulatePipeline);
+        vkCmdDispatchIndirect(commandBuffer, _particleCounterBuffer, offsetof(ParticleCounters, dispatch));
+
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _particleCompactPipeline);
+        vkCmdDispatchIndirect(commandBuffer, _particleCounterBuffer, offsetof(ParticleCounters, dispatch));
+
+        if (emitCount > 0) {
+
+            computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _particleEmitPipeline);
+            vkCmdDispatch(commandBuffer, (emitCount + _particleEmitWorkgroupSize - 1) / _particleEmitWorkgroupSize, 1, 1);
+        }
+
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _particleFinalizePipeline);
+        vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+        //Indirect arguments and particles for this frame's draw and the next frame's dispatches
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        //The destination is drawn this frame and simulated the next
+        _particleSource = 1 - _particleSource;
+    }
+
+    void Engine::recordParticleDraw(VkCommandBuffer commandBuffer, const MeshCamera& camera) {
+
+        const auto& view = camera.view;
+
+        ParticleDrawConstants constants{
+            .viewProjection = camera.viewProjection,
+            .cameraRight = glm::vec4(view[0][0], view[1][0], view[2][0], _settings.particles.size),
+            .cameraUp = glm::vec4(view[0][1], view[1][1], view[2][1], 0.0f)
+        };
+
+        _renderQueue.bindPipeline(commandBuffer, _pipelineTable[_particleDrawPipeline]);
+        _renderQueue.bindDescriptorSet(commandBuffer, _particleDrawLayout, 0, _particleDrawSets[_particleSource]);
+
+        vkCmdPushConstants(commandBuffer, _particleDrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleDrawConstants), &constants);
+        vkCmdDrawIndirect(commandBuffer, _particleCounterBuffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+
+        _renderQueue.countDraw();
+    }
+
+//End Pass
+
+//Overlay Pass
+
+    void Engine::createOverlay() {
+
+        createSpriteTexture();
+        createQuadIndexBuffer();
+
+        Shaders::ShaderId overlayShaders[] = { Shaders::ShaderId::Sprite2DVert, Shaders::ShaderId::Sprite2DFrag };
+
+        _overlayPipelineLayout = _layoutCache.pipelineLayout(overlayShaders);
+
+        Shaders::ShaderVariant noVariant{};
+
+        _overlayPipelines[static_cast<uint32_t>(Primitive2D::Quads)] = requestPipeline(Shaders::ShaderId::Sprite2DVert, noVariant, Shaders::ShaderId::Sprite2DFrag, noVariant, PipelinePass::Overlay);
+        _overlayPipelines[static_cast<uint32_t>(Primitive2D::Lines)] = requestPipeline(Shaders::ShaderId::Sprite2DVert, noVariant, Shaders::ShaderId::Sprite2DFrag, noVariant, PipelinePass::OverlayLines);
+
+        //The texture array never changes handle, so a single set written once is all the overlay needs
+        VkDescriptorPoolSize poolSize{
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1
+        };
+
+        VkDescriptorPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .maxSets = 1,
+            .poolSizeCount = 1,
+            .pPoolSizes = &poolSize
+        };
+
+        if (vkCreateDescriptorPool(_vkDevice, &poolInfo, _vkAllocator, &_overlayDescriptorPool) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create overlay descriptor pool!");
+
+        auto setLayouts = _layoutCache.setLayouts(_overlayPipelineLayout);
+
+        if (setLayouts.empty())
+            Debug::errorWindow(L"sprite2D.frag doesn't declare the sprite texture!");
+
+        VkDescriptorSetAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .descriptorPool = _overlayDescriptorPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &setLayouts[0]
+        };
+
+        if (vkAllocateDescriptorSets(_vkDevice, &allocInfo, &_overlayDescriptorSet) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate overlay descriptor set!");
+
+        VkDescriptorImageInfo imageInfo{
+            .sampler = _spriteSampler,
+            .imageView = _spriteImageView,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+
+        VkWriteDescriptorSet write{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = _overlayDescriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &imageInfo,
+            .pBufferInfo = nullptr,
+            .pTexelBufferView = nullptr
+        };
+
+        vkUpdateDescriptorSets(_vkDevice, 1, &write, 0, nullptr);
+    }
+
+    void Engine::destroyOverlay() {
+
+        for (auto& chunks : _overlayChunks) {
+
+            for (auto& chunk : chunks) {
+
+                vkUnmapMemory(_vkDevice, chunk.memory);
+                vkDestroyBuffer(_vkDevice, chunk.buffer, _vkAllocator);
+                freeMemory(chunk.memory);
+            }
+
+            chunks.clear();
+        }
+
+        vkDestroyBuffer(_vkDevice, _quadIndexBuffer, _vkAllocator);
+        freeMemory(_quadIndexBufferMemory);
+
+        vkDestroyDescriptorPool(_vkDevice, _overlayDescriptorPool, _vkAllocator);
+
+        vkDestroySampler(_vkDevice, _spriteSampler, _vkAllocator);
+        vkDestroyImageView(_vkDevice, _spriteImageView, _vkAllocator);
+        vkDestroyImage(_vkDevice, _spriteImage, _vkAllocator);
+        freeMemory(_spriteImageMemory);
+    }
+
+    void Engine::createSpriteTexture() {
+
+        const auto& settings = _settings.overlay;
+
+        if (settings.layerSize == 0 || settings.layerCount == 0)
+            Debug::errorWindow(L"the sprite texture array needs at least one layer!");
+
+        //sRGB like the swapchain, sprites are authored in it and blending happens in linear
+        VkImageCreateInfo imageInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = VK_FORMAT_R8G8B8A8_SRGB,
+            .extent = { settings.layerSize, settings.layerSize, 1 },
+            .mipLevels = 1,
+            .arrayLayers = settings.layerCount,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+        };
+
+        if (vkCreateImage(_vkDevice, &imageInfo, _vkAllocator, &_spriteImage) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create sprite texture array!");
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(_vkDevice, _spriteImage, &memRequirements);
+
+        _spriteImageMemory = allocateMemory(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Image);
+
+        vkBindImageMemory(_vkDevice, _spriteImage, _spriteImageMemory, 0);
+
+        VkImageViewCreateInfo viewInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .image = _spriteImage,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+            .format = VK_FORMAT_R8G8B8A8_SRGB,
+            .components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY },
+            .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, settings.layerCount }
+        };
+
+        if (vkCreateImageView(_vkDevice, &viewInfo, _vkAllocator, &_spriteImageView) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create sprite texture view!");
+
+        VkSamplerCreateInfo samplerInfo{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .magFilter = VK_FILTER_LINEAR,
+            .minFilter = VK_FILTER_LINEAR,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .mipLodBias = 0.0f,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0f,
+            .compareEnable = VK_FALSE,
+            .compareOp = VK_COMPARE_OP_ALWAYS,
+            .minLod = 0.0f,
+            .maxLod = 0.0f,
+            .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+            .unnormalizedCoordinates = VK_FALSE
+        };
+
+        if (vkCreateSampler(_vkDevice, &samplerInfo, _vkAllocator, &_spriteSampler) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create sprite sampler!");
+
+        //White layer for untextured quads and lines, the rest starts out transparent until loadSpriteLayer fills it
+        VkClearColorValue white = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+        VkClearColorValue transparent = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+
+        VkImageSubresourceRange whiteLayer = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, Batch2D::WHITE_LAYER, 1 };
+        VkImageSubresourceRange otherLayers = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, Batch2D::WHITE_LAYER + 1, settings.layerCount - 1 };
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        transitionSpriteLayers(commandBuffer, 0, settings.layerCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        vkCmdClearColorImage(commandBuffer, _spriteImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &whiteLayer);
+
+        if (settings.layerCount > 1)
+            vkCmdClearColorImage(commandBuffer, _spriteImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &transparent, 1, &otherLayers);
+
+        transitionSpriteLayers(commandBuffer, 0, settings.layerCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        endSingleTimeCommands(commandBuffer);
+    }
+
+    void Engine::transitionSpriteLayers(VkCommandBuffer commandBuffer, uint32_t firstLayer, uint32_t layerCount, VkImageLayout oldLayout, VkImageLayout newLayout) {
+
+        bool toTransfer = newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+        VkImageMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = toTransfer ? VkAccessFlags(0) : VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT),
+            .dstAccessMask = toTransfer ? VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT) : VkAccessFlags(VK_ACCESS_SHADER_READ_BIT),
+            .oldLayout = oldLayout,
+            .newLayout = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = _spriteImage,
+            .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, firstLayer, layerCount }
+        };
+
+        //Uploads only happen at load time, with the queue idle, so there is nothing before the transfer to wait on
+        VkPipelineStageFlags sourceStage = toTransfer ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkPipelineStageFlags destinationStage = toTransfer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void Engine::loadSpriteLayer(uint32_t layer, std::span<const uint8_t> pixels) {
+
+        const auto& settings = _settings.overlay;
+
+        VkDeviceSize layerBytes = VkDeviceSize(settings.layerSize) * settings.layerSize * 4;
+
+        if (layer == Batch2D::WHITE_LAYER || layer >= settings.layerCount)
+            Debug::errorWindow(L"sprite layer out of range, layer 0 is reserved!");
+
+        if (pixels.size() != layerBytes)
+            Debug::errorWindow(L"sprite layer has the wrong size!");
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+
+        createBuffer(layerBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging, stagingBuffer, stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(_vkDevice, stagingBufferMemory, 0, layerBytes, 0, &data);
+        std::memcpy(data, pixels.data(), pixels.size());
+        vkUnmapMemory(_vkDevice, stagingBufferMemory);
+
+        VkBufferImageCopy region{
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, layer, 1 },
+            .imageOffset = { 0, 0, 0 },
+            .imageExtent = { settings.layerSize, settings.layerSize, 1 }
+        };
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        transitionSpriteLayers(commandBuffer, layer, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, _spriteImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        transitionSpriteLayers(commandBuffer, layer, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        endSingleTimeCommands(commandBuffer);
+
+        vkDestroyBuffer(_vkDevice, stagingBuffer, _vkAllocator);
+        freeMemory(stagingBufferMemory);
+    }
+
+    void Engine::createQuadIndexBuffer() {
+
+        uint32_t quadCount = _overlayBatch.verticesPerChunk() / 4;
+
+        std::vector<uint16_t> indices;
+        indices.reserve(size_t(quadCount) * 6);
+
+        //Top left, top right, bottom right and bottom right, bottom left, top left, the order Batch2D writes the corners in
+        for (uint32_t quad = 0; quad < quadCount; quad++) {
+
+            uint16_t first = static_cast<uint16_t>(quad * 4);
+            indices.insert(indices.end(), { first, uint16_t(first + 1), uint16_t(first + 2), uint16_t(first + 2), uint16_t(first + 3), first });
+        }
+
+        VkDeviceSize indexBytes = indices.size() * sizeof(uint16_t);
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+
+        createBuffer(indexBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging, stagingBuffer, stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(_vkDevice, stagingBufferMemory, 0, indexBytes, 0, &data);
+        std::memcpy(data, indices.data(), indexBytes);
+        vkUnmapMemory(_vkDevice, stagingBufferMemory);
+
+        createBuffer(indexBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer, _quadIndexBuffer, _quadIndexBufferMemory);
+
+        VkBufferCopy region{ .srcOffset = 0, .dstOffset = 0, .size = indexBytes };
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, _quadIndexBuffer, 1, &region);
+        endSingleTimeCommands(commandBuffer);
+
+        vkDestroyBuffer(_vkDevice, stagingBuffer, _vkAllocator);
+        freeMemory(stagingBufferMemory);
+    }
+
+    void Engine::uploadOverlay(const Batch2D& batch) {
+
+        auto& chunks = _overlayChunks[_currentFrame];
+
+        VkDeviceSize chunkBytes = VkDeviceSize(batch.verticesPerChunk()) * sizeof(Vertex2D);
+
+        //Device local and host visible when there is such a heap (resizable BAR, integrated GPUs), the GPU reads it without crossing the bus
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        while (chunks.size() < batch.chunkCount()) {
+
+            OverlayChunk chunk{};
+
+            VkBufferCreateInfo bufferInfo{
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .size = chunkBytes,
+                .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices = nullptr
+            };
+
+            if (vkCreateBuffer(_vkDevice, &bufferInfo, _vkAllocator, &chunk.buffer) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to create overlay vertex buffer!");
+
+            VkMemoryRequirements memRequirements;
+            vkGetBufferMemoryRequirements(_vkDevice, chunk.buffer, &memRequirements);
+
+            VkMemoryPropertyFlags deviceLocalProperties = properties | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+            chunk.memory = allocateMemory(memRequirements, hasMemoryType(memRequirements.memoryTypeBits, deviceLocalProperties) ? deviceLocalProperties : properties, MemoryCategory::Buffer);
+
+            vkBindBufferMemory(_vkDevice, chunk.buffer, chunk.memory, 0);
+
+            //Mapped for as long as the chunk lives, coherent so nothing has to be flushed
+            void* mapped;
+            vkMapMemory(_vkDevice, chunk.memory, 0, chunkBytes, 0, &mapped);
+            chunk.mapped = static_cast<Vertex2D*>(mapped);
+
+            chunks.push_back(chunk);
+        }
+
+        //After a burst the extra chunks would sit mapped for good. They were last read by a frame the fence above
+        //already waited for, the deletion queue still holds them until every frame that could record them is done
+        size_t neededChunks = std::max<size_t>(batch.chunkCount(), 1);
+        uint32_t trimAfterFrames = _settings.overlay.trimAfterFrames;
+
+        if (trimAfterFrames != 0 && chunks.size() > neededChunks) {
+
+            if (++_overlayIdleFrames[_currentFrame] >= trimAfterFrames) {
+
+                for (; chunks.size() > neededChunks; chunks.pop_back()) {
+
+                    //Freeing the memory unmaps it
+                    retire(VK_OBJECT_TYPE_BUFFER, chunks.back().buffer);
+                    retire(VK_OBJECT_TYPE_DEVICE_MEMORY, chunks.back().memory);
+                }
+
+                _overlayIdleFrames[_currentFrame] = 0;
+            }
+        }
+        else
+            _overlayIdleFrames[_currentFrame] = 0;
+
+        for (uint32_t chunk = 0; chunk < batch.chunkCount(); chunk++) {
+
+            auto vertices = batch.chunk(chunk);
+            std::memcpy(chunks[chunk].mapped, vertices.data(), vertices.size_bytes());
+        }
+    }
+
+    void Engine::recordOverlay(VkCommandBuffer commandBuffer, const Batch2D& batch) {
+
+        if (batch.empty())
+            return;
+
+        const auto& chunks = _overlayChunks[_currentFrame];
+
+        //No layer yet, so the first run always pushes
+        SpriteConstants constants{
+            .pixelScale = { 2.0f / _swapChainExtent.width, 2.0f / _swapChainExtent.height },
+            .layer = ~0u
+        };
+
+        _renderQueue.bindIndexBuffer(commandBuffer, _quadIndexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+        //Runs are already merged by layer and kind, in submission order so later ones draw on top
+        for (const auto& run : batch.runs()) {
+
+            _renderQueue.bindPipeline(commandBuffer, _pipelineTable[_overlayPipelines[static_cast<uint32_t>(run.primitive)]]);
+            _renderQueue.bindDescriptorSet(commandBuffer, _overlayPipelineLayout, 0, _overlayDescriptorSet);
+            _renderQueue.bindVertexBuffer(commandBuffer, chunks[run.chunk].buffer, 0);
+
+            if (run.layer != constants.layer) {
+
+                constants.layer = run.layer;
+                vkCmdPushConstants(commandBuffer, _overlayPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SpriteConstants), &constants);
+            }
+
+            if (run.primitive == Primitive2D::Quads)
+                vkCmdDrawIndexed(commandBuffer, run.vertexCount / 4 * 6, 1, 0, static_cast<int32_t>(run.firstVertex), 0);
+            else
+                vkCmdDraw(commandBuffer, run.vertexCount, 1, run.firstVertex, 0);
+
+            _renderQueue.countDraw();
+        }
+    }
+
+//End Pass
+
+//Capture Pass
+
+    void Engine::createCapture() {
+
+        const auto& settings = _settings.capture;
+
+        if (settings.ringSize == 0)
+            Debug::errorWindow(L"frame capture needs at least one readback buffer!");
+
+        VkDeviceSize frameBytes = VkDeviceSize(_swapChainExtent.width) * _swapChainExtent.height * 4;
+
+        _captureBuffers.resize(settings.ringSize);
+        _captureBufferMemory.resize(settings.ringSize);
+        _captureData.resize(settings.ringSize);
+
+        for (uint32_t i = 0; i < settings.ringSize; i++) {
+
+            VkBufferCreateInfo bufferInfo{
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .size = frameBytes,
+                .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices = nullptr
+            };
+
+            if (vkCreateBuffer(_vkDevice, &bufferInfo, _vkAllocator, &_captureBuffers[i]) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to create capture buffer!");
+
+            VkMemoryRequirements memRequirements;
+            vkGetBufferMemoryRequirements(_vkDevice, _captureBuffers[i], &memRequirements);
+
+            //The encoder reads every byte once, uncached memory makes that read many times slower
+            VkMemoryPropertyFlags cachedProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+            _captureCoherent = !hasMemoryType(memRequirements.memoryTypeBits, cachedProperties);
+
+            _captureBufferMemory[i] = allocateMemory(memRequirements, _captureCoherent ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : cachedProperties,
+                MemoryCategory::Staging);
+
+            vkBindBufferMemory(_vkDevice, _captureBuffers[i], _captureBufferMemory[i], 0);
+
+            void* mapped;
+            vkMapMemory(_vkDevice, _captureBufferMemory[i], 0, frameBytes, 0, &mapped);
+            _captureData[i] = static_cast<uint8_t*>(mapped);
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = _vkCommandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = MAX_FRAMES_IN_FLIGHT
+        };
+
+        if (vkAllocateCommandBuffers(_vkDevice, &allocInfo, _vkCaptureCommandBuffers) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate capture command buffers!");
+
+        _frameCapture.start(settings, _swapChainExtent.width, _swapChainExtent.height, _capturePixelLayout);
+    }
+
+    void Engine::destroyCapture() {
+
+        if (!_captureEnabled)
+            return;
+
+        //The device is idle, copies still in flight when the loop stopped are done. Written oldest first
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+            finishCapture((_currentFrame + i) % MAX_FRAMES_IN_FLIGHT);
+
+        //Joins the encoder before the memory it reads goes away
+        _frameCapture.stop();
+
+        for (size_t i = 0; i < _captureBuffers.size(); i++) {
+
+            vkDestroyBuffer(_vkDevice, _captureBuffers[i], _vkAllocator);
+            freeMemory(_captureBufferMemory[i]);
+        }
+    }
+
+    void Engine::finishCapture(uint32_t frame) {
+
+        auto& pending = _pendingCaptures[frame];
+
+        if (!pending)
+            return;
+
+        if (!_captureCoherent) {
+
+            VkMappedMemoryRange range{
+                .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+                .pNext = nullptr,
+                .memory = _captureBufferMemory[pending->slot],
+                .offset = 0,
+                .size = VK_WHOLE_SIZE
+            };
+
+            vkInvalidateMappedMemoryRanges(_vkDevice, 1, &range);
+        }
+
+        _frameCapture.submit(*pending);
+        pending.reset();
+    }
+
+    void Engine::collectCapture(uint64_t frameNumber) {
+
+        //Copied MAX_FRAMES_IN_FLIGHT frames ago, the fence we just waited on covers it
+        finishCapture(_currentFrame);
+
+        if (frameNumber % std::max(_settings.capture.interval, 1u) != 0)
+            return;
+
+        uint32_t slot;
+
+        if (_frameCapture.acquireSlot(slot))
+            _pendingCaptures[_currentFrame] = CapturedFrame{ .slot = slot, .pixels = _captureData[slot], .frameNumber = frameNumber };
+    }
+
+    VkCommandBuffer Engine::recordCapture(uint32_t imageIndex, uint32_t slot) {
+
+        VkCommandBuffer commandBuffer = _vkCaptureCommandBuffers[_currentFrame];
+
+        vkResetCommandBuffer(commandBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr
+        };
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to begin recording capture command buffer!");
+
+        //The render pass ran in the command buffer before this one in the same submit, barriers reach back across it
+        VkImageMemoryBarrier toTransfer{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = _swapChainImages[imageIndex],
+            .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+        //Tightly packed rows, what the encoder expects
+        VkBufferImageCopy region{
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+            .imageOffset = { 0, 0, 0 },
+            .imageExtent = { _swapChainExtent.width, _swapChainExtent.height, 1 }
+        };
+
+        vkCmdCopyImageToBuffer(commandBuffer, _swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _captureBuffers[slot], 1, &region);
+
+        //Back to what the render pass left it in, the present waits on the semaphore of this submit
+        VkImageMemoryBarrier toPresent = toTransfer;
+        toPresent.srcAccessMask = 0;
+        toPresent.dstAccessMask = 0;
+        toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkBufferMemoryBarrier toHost{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = _captureBuffers[slot],
+            .offset = 0,
+            .size = VK_WHOLE_SIZE
+        };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &toPresent);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &toHost, 0, nullptr);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to record capture command buffer!");
+
+        return commandBuffer;
+    }
+
+//End Pass
+
+//Profiler Pass
+
+    void Engine::createGpuTimestamps() {
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, nullptr);
+
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        //The trace then only has the CPU zones
+        uint32_t validBits = queueFamilies[indices.graphicsFamily].timestampValidBits;
+
+        if (validBits == 0)
+            return;
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+
+        _timestampPeriod = deviceProperties.limits.timestampPeriod;
+        _timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        VkQueryPoolCreateInfo queryPoolInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = MAX_FRAMES_IN_FLIGHT * GPU_TIMESTAMPS_PER_FRAME,
+            .pipelineStatistics = 0
+        };
+
+        if (vkCreateQueryPool(_vkDevice, &queryPoolInfo, _vkAllocator, &_vkTimestampQueryPool) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create timestamp query pool!");
+
+        _gpuTimestamps = true;
+    }
+
+    void Engine::destroyGpuTimestamps() {
+
+        vkDestroyQueryPool(_vkDevice, _vkTimestampQueryPool, _vkAllocator);
+    }
+
+    void Engine::writeGpuTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query) {
+
+        //The current frame in flight picks the queries, a reused recording is only ever submitted from the same one
+        vkCmdWriteTimestamp(commandBuffer, stage, _vkTimestampQueryPool, _currentFrame * GPU_TIMESTAMPS_PER_FRAME + query);
+    }
+
+    void Engine::collectGpuTimestamps() {
+
+        if (!_timestampsPending[_currentFrame])
+            return;
+
+        _timestampsPending[_currentFrame] = false;
+
+        uint64_t ticks[GPU_TIMESTAMPS_PER_FRAME];
+
+        //The fence has signaled, the results are there without waiting
+        if (vkGetQueryPoolResults(_vkDevice, _vkTimestampQueryPool, _currentFrame * GPU_TIMESTAMPS_PER_FRAME, GPU_TIMESTAMPS_PER_FRAME,
+            sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+            return;
+
+        uint64_t nanoseconds[GPU_TIMESTAMPS_PER_FRAME];
+
+        for (uint32_t i = 0; i < GPU_TIMESTAMPS_PER_FRAME; i++)
+            nanoseconds[i] = static_cast<uint64_t>(static_cast<double>(ticks[i] & _timestampMask) * _timestampPeriod);
+
+        _gpuClockOffset = std::max(_gpuClockOffset, static_cast<int64_t>(_timestampSubmitTimes[_currentFrame] - nanoseconds[0]));
+
+        uint64_t offset = static_cast<uint64_t>(_gpuClockOffset);
+
+        //Particles, light binning and the first culling phase, then every render pass
+        Profiler::gpuZone("compute", nanoseconds[0] + offset, nanoseconds[1] + offset);
+        Profiler::gpuZone("render passes", nanoseconds[1] + offset, nanoseconds[2] + offset);
+    }
+
+//End Pass
+
+//Draw Pass
+
+    void Engine::createFramebuffers() {
+
+        _swapChainFramebuffers.resize(_swapChainImageViews.size());
+
+        VkFramebufferCreateInfo framebufferInfo{
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .renderPass = _vkRenderPass,
+            .attachmentCount = msaaEnabled() ? 3u : 2u,
+            .pAttachments = nullptr,
+            .width = _swapChainExtent.width,
+            .height = _swapChainExtent.height,
+            .layers = 1
+        };
+
+        for (size_t i = 0; i < _swapChainImageViews.size(); i++) {
+
+            //Every framebuffer shares the render targets, the external subpass dependencies order the frames using them
+            VkImageView attachment[] = {
+                msaaEnabled() ? _msaaColorTarget.view : _swapChainImageViews[i],
+                _depthTarget.view,
+                _swapChainImageViews[i]
+            };
+
+            framebufferInfo.pAttachments = attachment;
+
+            if (vkCreateFramebuffer(_vkDevice, &framebufferInfo, _vkAllocator, &_swapChainFramebuffers[i]) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to create framebuffer!");
+        }
+    }
+
+    void Engine::createCommandPool() {
+
+        VkCommandPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = indices.graphicsFamily
+        };
+
+        if (vkCreateCommandPool(_vkDevice, &poolInfo, _vkAllocator, &_vkCommandPool) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to create command pool!");
+    }
+
+    void Engine::createCommandBuffers() {
+        
+        VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = _vkCommandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = MAX_FRAMES_IN_FLIGHT
+        };
+
+        //Particles advance their simulation state while recording, so their frames are always recorded
+        _reuseCommandBuffers = _settings.reuseCommandBuffers && !hasParticles();
+
+        if (!_reuseCommandBuffers) {
+
+            if (vkAllocateCommandBuffers(_vkDevice, &allocInfo, _vkCommandBuffers) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to allocate command buffers!");
+
+            return;
+        }
+
+        std::vector<VkCommandBuffer> commandBuffers(MAX_FRAMES_IN_FLIGHT * _swapChainImages.size());
+        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+        if (vkAllocateCommandBuffers(_vkDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+            Debug::errorWindow(L"failed to allocate command buffers!");
+
+        _recordedCommandBuffers.resize(commandBuffers.size());
+
+        for (size_t i = 0; i < commandBuffers.size(); i++)
+            _recordedCommandBuffers[i].commandBuffer = commandBuffers[i];
+    }
+
+    //Folds 4 byte words, every type hashed here is made of them
+    static uint64_t hashWords(uint64_t seed, const void* data, size_t bytes) {
+
+        const uint8_t* words = static_cast<const uint8_t*>(data);
+
+        for (size_t offset = 0; offset + sizeof(uint32_t) <= bytes; offset += sizeof(uint32_t)) {
+
+            uint32_t word;
+            std::memcpy(&word, words + offset, sizeof(word));
+            seed = Shaders::hashCombine(seed, word);
+        }
+
+        return seed;
+    }
+
+    uint64_t Engine::frameContentKey(const SceneSnapshot& scene, const Batch2D& overlay) const {
+
+        uint64_t key = Shaders::hashCombine(_swapChainGeneration, _contentGeneration.load(std::memory_order_relaxed));
+
+        key = hashWords(key, &scene.clearColor, sizeof(scene.clearColor));
+
+        //Queue order, passes and pipelines, then the constants pushed for each draw. The depth field only sorts, it moves
+        //with the camera every frame
+        for (const auto& entry : _renderQueue.entries())
+            key = Shaders::hashCombine(Shaders::hashCombine(key, entry.key >> SortKey::MATERIAL_SHIFT), entry.payload);
+
+        static_assert(sizeof(MeshDraw) % sizeof(uint32_t) == 0, "MeshDraw is hashed as 4 byte words");
+
+        key = hashWords(key, _meshDraws.data(), _meshDraws.size() * sizeof(MeshDraw));
+
+        static_assert(sizeof(Batch2DRun) % sizeof(uint32_t) == 0, "Batch2DRun is hashed as 4 byte words");
+
+        auto runs = overlay.runs();
+        key = hashWords(Shaders::hashCombine(key, runs.size()), runs.data(), runs.size_bytes());
+
+        return key;
+    }
+
+    void Engine::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const SceneSnapshot& scene, const Batch2D& overlay) {
+
+        VkCommandBufferBeginInfo beginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .pInheritanceInfo = nullptr
+        };
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
             Debug::errorWindow(L"failed to begin recording command buffer!");
+
+        if (_gpuTimestamps) {
+
+            vkCmdResetQueryPool(commandBuffer, _vkTimestampQueryPool, _currentFrame * GPU_TIMESTAMPS_PER_FRAME, GPU_TIMESTAMPS_PER_FRAME);
+            writeGpuTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+        }
+
+        //Compute can't run inside a render pass
+        if (hasParticles())
+            recordParticleSimulation(commandBuffer, scene);
+
+        if (hasMeshes())
+            recordLightBinning(commandBuffer);
+
+        //The queue was filled by prepareMeshDraws before recording
+        _renderQueue.resetBindings();
+
+        if (_occlusionCulling)
+            recordOcclusionCull(commandBuffer, 0);
+
+        if (_gpuTimestamps)
+            writeGpuTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
         
         VkRect2D renderA = {
             .offset = {0, 0},
             .extent = _swapChainExtent,
         };
 
-        VkClearValue clearColor = { 
-            {
-                {
-                    0.0f,   //R
-                    0.0f,   //G
-                    0.0f,   //B
-                    1.0f    //A
-                }
-            } 
+        VkClearValue clearValues[] = {
+            { .color = scene.clearColor },
+            { .depthStencil = { 1.0f, 0 } }
         };
 
         VkRenderPassBeginInfo renderPassInfo{
@@ -944,14 +3889,12 @@ namespace EggyEngine {
             .renderPass = _vkRenderPass,
             .framebuffer = _swapChainFramebuffers[imageIndex],
             .renderArea = renderA,
-            .clearValueCount = 1,
-            .pClearValues = &clearColor
+            .clearValueCount = 2,
+            .pClearValues = clearValues
         };
 
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _vkGraphicsPipeline);
-
         VkViewport viewport{
             .x = 0.0f,
             .y = 0.0f,
@@ -970,10 +3913,45 @@ namespace EggyEngine {
 
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        if (hasMeshes())
+            recordRenderQueue(commandBuffer, 0);
+        else {
+
+            _renderQueue.bindPipeline(commandBuffer, _vkGraphicsPipeline);
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+            _renderQueue.countDraw();
+        }
+
+        //Second phase in a render pass of its own, the depth of the first one is what the pyramid is built from.
+        //Viewport, scissor and bindings are command buffer state and carry over
+        if (_occlusionCulling) {
+
+            vkCmdEndRenderPass(commandBuffer);
+
+            recordDepthPyramid(commandBuffer);
+            recordOcclusionCull(commandBuffer, 1);
+
+            renderPassInfo.renderPass = _vkLateRenderPass;
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            recordRenderQueue(commandBuffer, 1);
+        }
+
+        if (hasParticles())
+            recordParticleDraw(commandBuffer, meshCamera(scene));
+
+        recordOverlay(commandBuffer, overlay);
 
         vkCmdEndRenderPass(commandBuffer);
 
+        if (_gpuTimestamps)
+            writeGpuTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 2);
+
+        {
+            std::lock_guard lock(_renderQueueStatsMutex);
+            _renderQueueStats = _renderQueue.stats();
+        }
+
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
             Debug::errorWindow(L"failed to record command buffer!");
     }
@@ -987,10 +3965,11 @@ namespace EggyEngine {
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        if (vkCreateSemaphore(_vkDevice, &semaphoreInfo, nullptr, &_vkImageAvailableSemaphore) != VK_SUCCESS ||
-            vkCreateSemaphore(_vkDevice, &semaphoreInfo, nullptr, &_vkRenderFinishedSemaphore) != VK_SUCCESS ||
-            vkCreateFence(_vkDevice, &fenceInfo, nullptr, &_vkInFlightFence) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to create semaphores!");
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+            if (vkCreateSemaphore(_vkDevice, &semaphoreInfo, _vkAllocator, &_vkImageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(_vkDevice, &semaphoreInfo, _vkAllocator, &_vkRenderFinishedSemaphores[i]) != VK_SUCCESS ||
+                vkCreateFence(_vkDevice, &fenceInfo, _vkAllocator, &_vkInFlightFences[i]) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to create semaphores!");
 
     }
     
@@ -1001,34 +3980,129 @@ namespace EggyEngine {
     Submit the recorded command buffer
     Present the swap chain image
     */
-    void Engine::drawFrame() {
+    void Engine::drawFrame(const FramePacket& packet) {
+
+        EGGY_PROFILE_FRAME("render frame");
+        EGGY_PROFILE_ZONE("drawFrame");
+
+        {
+            EGGY_PROFILE_ZONE("waitForFence");
+            vkWaitForFences(_vkDevice, 1, &_vkInFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
+        }
+
+        vkResetFences(_vkDevice, 1, &_vkInFlightFences[_currentFrame]);
 
-        vkWaitForFences(_vkDevice, 1, &_vkInFlightFence, VK_TRUE, UINT64_MAX);
-        vkResetFences(_vkDevice, 1, &_vkInFlightFence);
+        if (_gpuTimestamps)
+            collectGpuTimestamps();
+
+        //The fence covers the last frame submitted from this frame in flight and every frame before it
+        uint64_t completedSerial = _submittedSerials[_currentFrame];
+        _submittedSerials[_currentFrame] = ++_frameSerial;
+
+        _retiredReady.clear();
+        _deletionQueue.beginFrame(_frameSerial, completedSerial, _retiredReady);
+        destroyRetired(_retiredReady);
+
+        //Hands the copy this frame in flight made last time to the encoder and picks a buffer for this one
+        if (_captureEnabled)
+            collectCapture(packet.frameNumber);
 
         uint32_t imageIndex;
-        vkAcquireNextImageKHR(_vkDevice, _vkSwapChain, UINT64_MAX, _vkImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 
-        vkResetCommandBuffer(_vkCommandBuffer, 0);
+        {
+            EGGY_PROFILE_ZONE("acquireImage");
+            vkAcquireNextImageKHR(_vkDevice, _vkSwapChain, UINT64_MAX, _vkImageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
+
+        //The fence above also freed the overlay chunks and the light buffer of this frame
+        {
+            EGGY_PROFILE_ZONE("uploadFrame");
+
+            uploadOverlay(packet.overlay);
+
+            if (hasMeshes())
+                uploadLights(packet.lights, packet.scene);
+        }
+
+        //Before recording, the culling reads the draws it picks and a reused recording is matched against them
+        _renderQueue.clear();
+
+        if (hasMeshes()) {
+
+            EGGY_PROFILE_ZONE("prepareMeshDraws");
+            prepareMeshDraws(packet.scene);
+        }
+
+        VkCommandBuffer commandBuffer = _vkCommandBuffers[_currentFrame];
+        RecordedCommandBuffer* recorded = nullptr;
+        bool record = true;
+
+        if (_reuseCommandBuffers) {
+
+            recorded = &_recordedCommandBuffers[_currentFrame * _swapChainImages.size() + imageIndex];
+            uint64_t contentKey = frameContentKey(packet.scene, packet.overlay);
+
+            commandBuffer = recorded->commandBuffer;
+            record = !recorded->recorded || recorded->contentKey != contentKey;
+
+            recorded->contentKey = contentKey;
+            recorded->recorded = true;
+
+            (record ? _commandBuffersRecorded : _commandBuffersReused).fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+            _commandBuffersRecorded.fetch_add(1, std::memory_order_relaxed);
+
+        if (record) {
+
+            EGGY_PROFILE_ZONE("recordCommandBuffer");
+
+            vkResetCommandBuffer(commandBuffer, 0);
+            recordCommandBuffer(commandBuffer, imageIndex, packet.scene, packet.overlay);
+
+            if (recorded)
+                recorded->stats = _renderQueue.stats();
+        }
+        else {
+
+            //A replay draws what its recording counted
+            std::lock_guard lock(_renderQueueStatsMutex);
+            _renderQueueStats = recorded->stats;
+        }
 
-        recordCommandBuffer(_vkCommandBuffer, imageIndex);
+        //Captures copy in a command buffer of their own so the frame's recording doesn't change with them
+        VkCommandBuffer commandBuffers[] = { commandBuffer, VK_NULL_HANDLE };
+        uint32_t commandBufferCount = 1;
+
+        if (_pendingCaptures[_currentFrame])
+            commandBuffers[commandBufferCount++] = recordCapture(imageIndex, _pendingCaptures[_currentFrame]->slot);
         
-        VkSemaphore waitSemaphores[] = { _vkImageAvailableSemaphore };
+        VkSemaphore waitSemaphores[] = { _vkImageAvailableSemaphores[_currentFrame] };
         VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        VkSemaphore signalSemaphores[] = { _vkRenderFinishedSemaphore };
+        VkSemaphore signalSemaphores[] = { _vkRenderFinishedSemaphores[_currentFrame] };
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &_vkCommandBuffer;
+        submitInfo.commandBufferCount = commandBufferCount;
+        submitInfo.pCommandBuffers = commandBuffers;
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _vkInFlightFence) != VK_SUCCESS)
-            Debug::errorWindow(L"failed to submit draw command buffer!");
+        if (_gpuTimestamps) {
+
+            _timestampSubmitTimes[_currentFrame] = Profiler::now();
+            _timestampsPending[_currentFrame] = true;
+        }
+
+        {
+            EGGY_PROFILE_ZONE("submit");
+
+            if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _vkInFlightFences[_currentFrame]) != VK_SUCCESS)
+                Debug::errorWindow(L"failed to submit draw command buffer!");
+        }
 
         VkSwapchainKHR swapChains[] = { _vkSwapChain };
 
@@ -1040,7 +4114,19 @@ namespace EggyEngine {
         presentInfo.pSwapchains = swapChains;
         presentInfo.pImageIndices = &imageIndex;
 
-        vkQueuePresentKHR(_presentQueue, &presentInfo);
+        {
+            EGGY_PROFILE_ZONE("present");
+            vkQueuePresentKHR(_presentQueue, &presentInfo);
+        }
+
+        EGGY_PROFILE_COUNTER("queued draws", _renderQueue.entries().size());
+        EGGY_PROFILE_COUNTER("retired objects pending", _deletionQueue.stats().pending);
+
+        _framePacer.markPresented(packet.frameStart, packet.inputTime);
+
+        _currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+        _memoryTracker.update();
     }
     
 //End Pass
@@ -1,4 +1,29 @@
 #include "HelperNamespaces.hpp"
+#include "FramePacing.hpp"
+#include "LoopScheduler.hpp"
+#include "FramePacket.hpp"
+#include "FrameClock.hpp"
+#include "MeshPack.hpp"
+#include "LodSelection.hpp"
+#include "ShaderRegistry.hpp"
+#include "ShaderVariant.hpp"
+#include "ShaderReflection.hpp"
+#include "MemoryBudget.hpp"
+#include "RenderQueue.hpp"
+#include "ParticleSystem.hpp"
+#include "OcclusionCulling.hpp"
+#include "FrameCapture.hpp"
+#include "DeletionQueue.hpp"
+#include "HostAllocator.hpp"
+#include "Profiler.hpp"
+
+#include <glm/glm.hpp>
+
+#include <thread>
+#include <exception>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
 
 struct QueueFamilyIndices {
 	uint32_t graphicsFamily = 0;
@@ -20,15 +45,182 @@ struct SwapChainSupportDetails {
 };
 
 namespace EggyEngine{
+
+	struct EngineSettings {
+
+		// Backend, size and title. Headless renders to VK_EXT_headless_surface without a window
+		Platform::WindowSettings window{};
+
+		FramePacingSettings framePacing{};
+		LoopSchedulingSettings loopScheduling{};
+		FrameClockSettings frameClock{};
+
+		// Mesh pack written by MeshConverter, empty draws the built in triangle
+		std::string meshPackPath{};
+
+		LodSelectionSettings lodSelection{};
+
+		MemoryBudgetSettings memoryBudget{};
+
+		// Objects released while frames are in flight are destroyed a few frames later, spread over frames by this budget
+		DeletionQueueSettings deletionQueue{};
+
+		// Host memory the driver allocates through VkAllocationCallbacks, counted per allocation scope
+		HostAllocatorSettings hostAllocator{};
+
+		// Validation output, only used when validation layers are enabled
+		Debug::DebugSinkSettings debugSink{};
+
+		// Chrome trace of the CPU zones and the GPU timestamps from startup to shutdown, written when the engine goes away.
+		// Needs a build with EGGY_PROFILER, empty doesn't record
+		std::string tracePath{};
+		Profiler::ProfilerSettings profiler{};
+
+		// Startup shading of the mesh shader, F2 cycles through the variants
+		MeshShading meshShading = MeshShading::Lit;
+
+		// Clamped to what the device supports, VK_SAMPLE_COUNT_1_BIT renders straight to the swapchain
+		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_4_BIT;
+
+		// Depth only pass over the meshes from a position only stream, the color pass then tests EQUAL and shades
+		// every pixel once. Pays off when fragment shading and overdraw dominate, costs a second geometry pass otherwise
+		bool depthPrepass = false;
+
+		// GPU culling of the meshes against a depth pyramid, in two phases split by a second render pass. Keeps the depth
+		// buffer and the multisampled color target in memory instead of transient, pays off once most geometry is hidden
+		bool occlusionCulling = false;
+
+		// Sprite texture array and vertex chunk sizes of the 2D overlay
+		Batch2DSettings overlay{};
+
+		// GPU particle system, off while particles.capacity is 0
+		ParticleSettings particles{};
+
+		// Cluster grid and light limits of the lit mesh shading
+		LightingSettings lighting{};
+
+		// Frames copied out of the swapchain and written to disk on a background thread, off while capture.directory is empty
+		FrameCaptureSettings capture{};
+
+		// Keeps the command buffer of every frame in flight and swapchain image and replays it while the frame content is
+		// unchanged, for mostly static scenes. The camera is read from a buffer so moving it keeps the recordings, a LOD
+		// switch or a change in draw order doesn't. Has no effect with particles, their simulation is recorded every frame
+		bool reuseCommandBuffers = false;
+	};
+
+	// Subpass a pipeline is built for. The overlay and particle passes draw in the color subpass with their own vertex layout and blending
+	enum class PipelinePass : uint32_t {
+		Color,
+		DepthPrepass,
+		Overlay,
+		OverlayLines,
+		Particles
+	};
+
+	struct CommandBufferStats {
+
+		// Frames that had to be recorded and frames that replayed an earlier recording
+		uint64_t recorded = 0;
+		uint64_t reused = 0;
+	};
+
+	// Main thread, gets a cleared batch and the framebuffer size once per frame packet
+	using OverlayCallback = std::function<void(Batch2D& batch, uint32_t width, uint32_t height)>;
+
+	// Main thread, gets a cleared list once per frame packet and the scene it is built for. World space, same as the meshes
+	using LightCallback = std::function<void(std::vector<PointLight>& lights, const SceneSnapshot& scene)>;
 	
 	class Engine {
 	public:
 
-		Engine();
+		Engine(const EngineSettings& settings = {});
 		~Engine();
 
 		void run();
 
+		// Limiter and low latency options can change at runtime, the present mode policy is read at swapchain creation
+		void setFramePacing(const FramePacingSettings& settings) {
+
+			_settings.framePacing = settings;
+			_framePacer.configure(settings);
+		}
+
+		LatencyStats latencyStats() const { return _framePacer.latencyStats(); }
+
+		void setLoopScheduling(const LoopSchedulingSettings& settings) {
+
+			_settings.loopScheduling = settings;
+			_loopScheduler.configure(settings);
+		}
+
+		LoopUtilization loopUtilization() const { return _loopScheduler.utilization(); }
+
+		// Main thread only
+		const FrameTiming& frameTiming() const { return _frameClock.timing(); }
+
+		// Levels picked for the last recorded frame
+		LodSelectionStats lodStats() const;
+
+		// Heap budgets and engine allocations by category, budgets are refreshed every memoryBudget.updateInterval frames
+		MemoryStats memoryStats() const { return _memoryTracker.stats(); }
+
+		// Any thread, for objects released mid run by streaming or reloads. Destroyed on the render thread once the
+		// GPU is past every frame that could use it, never waits on the device. Reused recordings are dropped too,
+		// replaying one could still touch the object.
+		// Takes BUFFER, IMAGE, IMAGE_VIEW, SAMPLER, PIPELINE, SHADER_MODULE, DESCRIPTOR_POOL and FRAMEBUFFER, and
+		// DEVICE_MEMORY from the engine's own allocations. Objects are destroyed in retire order, so memory goes after
+		// whatever is bound to it. The handle must have been created with the engine device and allocator
+		template<typename Handle>
+		void retire(VkObjectType type, Handle handle) {
+
+			if (handle == VK_NULL_HANDLE)
+				return;
+
+			_deletionQueue.retire(type, reinterpret_cast<uint64_t>(handle));
+			invalidateCommandBuffers();
+		}
+
+		DeletionQueueStats deletionQueueStats() const { return _deletionQueue.stats(); }
+
+		// Any thread, driver host memory by VkSystemAllocationScope. All zero with hostAllocator.enabled off
+		HostAllocatorStats hostAllocatorStats() const { return _hostAllocator.stats(); }
+
+		// Fired on the render thread when a heap moves between pressure levels
+		void addMemoryPressureCallback(MemoryPressureCallback callback) { _memoryTracker.addPressureCallback(std::move(callback)); }
+
+		// Any thread, VERBOSE and INFO get through only when asked for
+		void setDebugSeverityFilter(VkDebugUtilsMessageSeverityFlagsEXT severityFilter) { _debugSink.setSeverityFilter(severityFilter); }
+
+		Debug::DebugSinkStats debugStats() const { return _debugSink.stats(); }
+
+		// Draws and binds of the last submitted frame, redundant binds are the ones the sorted queue saved. A replayed
+		// command buffer reports the numbers of its recording
+		RenderQueueStats renderQueueStats() const;
+
+		// The sample count in use after clamping to the device limits
+		VkSampleCountFlagBits msaaSamples() const { return _msaaSamples; }
+
+		void setOverlayCallback(OverlayCallback callback) { _overlayCallback = std::move(callback); }
+
+		// Copies overlay.layerSize squared RGBA8 sRGB pixels into a layer of the sprite texture array.
+		// Waits for the upload, call it before run()
+		void loadSpriteLayer(uint32_t layer, std::span<const uint8_t> pixels);
+
+		void setLightCallback(LightCallback callback) { _lightCallback = std::move(callback); }
+
+		// Bounds of the loaded mesh pack, a unit box without one
+		void meshBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+		// Any thread, dropped frames mean the encoder can't keep up with the capture interval
+		CaptureStats captureStats() const { return _frameCapture.stats(); }
+
+		// Any thread. With reuseCommandBuffers, forces every recording to be redone for state the engine can't see change
+		void invalidateCommandBuffers() { _contentGeneration.fetch_add(1, std::memory_order_relaxed); }
+
+		CommandBufferStats commandBufferStats() const {
+			return { .recorded = _commandBuffersRecorded.load(std::memory_order_relaxed), .reused = _commandBuffersReused.load(std::memory_order_relaxed) };
+		}
+
 	private:
 		
 		void destroyWindow();
@@ -46,14 +238,104 @@ namespace EggyEngine{
 
 		void createPipeline();
 
-		GLFWwindow* _window = nullptr;
+		Platform::Window _window{};
+
+		EngineSettings _settings{};
+
+//End Pass
+
+//Frame Pacing Pass
+
+		void registerInputCallbacks();
+
+		static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+		static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+		static void cursorPosCallback(GLFWwindow* window, double x, double y);
+
+		FramePacer _framePacer{};
+		LoopScheduler _loopScheduler{};
+
+//End Pass
+
+//Render Thread Pass
+
+		// The main thread polls events and produces packets, the render thread records, submits and presents them.
+		// A slow acquire or present only backs up the packet queue, never the event loop.
+
+		void startRenderThread();
+		void stopRenderThread();
+		void renderThreadMain();
+
+		void submitFramePacket();
+
+		FramePacketQueue _framePackets{};
+
+		std::thread _renderThread;
+		std::exception_ptr _renderThreadError = nullptr;
+
+		std::atomic<bool> _renderThreadFailed = false;
+		std::atomic<bool> _packetProducerWaiting = false;
+
+		uint64_t _framesSubmitted = 0;
+
+//End Pass
+
+//Simulation Pass
+
+		// Runs the due fixed steps and returns the interpolated snapshot for the render thread
+		SceneSnapshot advanceSimulation();
+
+		void updateSimulation(double deltaTime);
+
+		FrameClock _frameClock{};
+
+		SimulationState _previousState{};
+		SimulationState _currentState{};
+
+		// Written by the key callback, copied into every snapshot
+		MeshShading _meshShading = MeshShading::Lit;
 
 //End Pass
 
 //Instance Pass
 
+		// Only freed after ~Engine has destroyed every object it allocated for
+		HostAllocator _hostAllocator{};
+
+		// pAllocator of every vkCreate and vkDestroy, nullptr with the host allocator off
+		const VkAllocationCallbacks* _vkAllocator = nullptr;
+
 		VkInstance _vkInstance = VK_NULL_HANDLE;
 
+		// Stopped after the instance is gone so messages from the teardown still get printed
+		Debug::DebugSink _debugSink{};
+
+//End Pass
+
+//Memory Pass
+
+		// Every device allocation goes through here so the tracker sees it
+
+		VkDeviceMemory allocateMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category);
+		void freeMemory(VkDeviceMemory memory);
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+		bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+		MemoryTracker _memoryTracker{};
+
+		// Render thread, or any thread once the device is idle
+		void destroyRetired(const std::vector<RetiredObject>& objects);
+
+		DeletionQueue _deletionQueue{};
+
+		// Render thread scratch, kept between frames so it doesn't allocate
+		std::vector<RetiredObject> _retiredReady;
+
+		// Serial of the frame being recorded, and of the last frame submitted from each frame in flight
+		uint64_t _frameSerial = 0;
+		uint64_t _submittedSerials[MAX_FRAMES_IN_FLIGHT] = {};
+
 //End Pass
 
 //SwapChain Pass
@@ -69,6 +351,7 @@ namespace EggyEngine{
 		void findQueueFamilies();
 
 		bool checkDeviceExtensionSupport();
+		bool isDeviceExtensionAvailable(const char* extensionName);
 
 		void startSwapChain();
 
@@ -86,11 +369,17 @@ namespace EggyEngine{
 		VkSurfaceKHR _vkSurface = VK_NULL_HANDLE;
 		VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
 
+		// Required extensions plus the optional ones the device has
+		std::vector<const char*> _enabledDeviceExtensions;
+
 		VkSwapchainKHR _vkSwapChain = VK_NULL_HANDLE;
 
 		VkFormat _swapChainImageFormat;
 		VkExtent2D _swapChainExtent;
 
+		// Bumped whenever the swapchain is created, recordings of an older one are never replayed
+		uint64_t _swapChainGeneration = 0;
+
 		VkQueue _graphicsQueue = VK_NULL_HANDLE;
 		VkQueue _presentQueue = VK_NULL_HANDLE;
 
@@ -101,54 +390,535 @@ namespace EggyEngine{
 
 //End Pass
 
+//Render Target Pass
+
+		// Multisampled attachments only live inside the render pass: cleared on load, resolved in the subpass and never stored.
+		// Tilers keep them in tile memory, so their lazily allocated backing is never committed
+
+		struct RenderTarget {
+
+			VkImage image = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+
+			// Backed by LAZILY_ALLOCATED memory, false when the device has none
+			bool lazy = false;
+		};
+
+		VkSampleCountFlagBits chooseSampleCount(VkSampleCountFlagBits requested);
+
+		void createRenderTarget(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkSampleCountFlagBits samples, RenderTarget& target);
+		void destroyRenderTarget(RenderTarget& target);
+
+		void createRenderTargets();
+		void destroyRenderTargets();
+
+		bool msaaEnabled() const { return _msaaSamples != VK_SAMPLE_COUNT_1_BIT; }
+
+		VkFormat findDepthFormat();
+
+		VkSampleCountFlagBits _msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		RenderTarget _msaaColorTarget{};
+
+		// Transient as well unless occlusion culling builds its depth pyramid from it
+		RenderTarget _depthTarget{};
+		VkFormat _depthFormat = VK_FORMAT_UNDEFINED;
+
+//End Pass
+
 //Graphics Pipeline Pass
 
-		VkShaderModule createShaderModule(const std::vector<char>& shaderBinary);
+		VkShaderModule createShaderModule(const Shaders::ShaderBinary& shader);
 		
-		VkPipelineShaderStageCreateInfo* loadShaderModules(std::string _shaderName);
+		VkPipelineShaderStageCreateInfo* loadShaderModules(Shaders::ShaderId vertexShader, Shaders::ShaderVariant& vertexVariant, Shaders::ShaderId fragmentShader, Shaders::ShaderVariant& fragmentVariant);
+
+		// Pipelines are built once per shader, variant and state combination and cached for the lifetime of the render pass.
+		// Returns the index in _pipelineTable, which is also the pipeline field of the sort keys.
+		// The variants have to outlive the call, their VkSpecializationInfo points into them
+		uint32_t requestPipeline(Shaders::ShaderId vertexShader, Shaders::ShaderVariant& vertexVariant, Shaders::ShaderId fragmentShader, Shaders::ShaderVariant& fragmentVariant, PipelinePass pass = PipelinePass::Color);
+		VkPipeline createGraphicsPipeline(Shaders::ShaderId vertexShader, Shaders::ShaderVariant& vertexVariant, Shaders::ShaderId fragmentShader, Shaders::ShaderVariant& fragmentVariant, PipelinePass pass);
+
+		// Compute pipelines aren't cached, callers keep the handle. Destroyed with the graphics pipelines
+		VkPipeline createComputePipeline(Shaders::ShaderId shader, Shaders::ShaderVariant& variant, VkPipelineLayout layout);
+
+		uint32_t meshPipeline(MeshShading shading);
+		uint32_t depthPrepassPipeline();
 
 		VkPipelineDynamicStateCreateInfo pipelineDynamicState();
-		VkPipelineVertexInputStateCreateInfo inputVertexState();
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState();
+		VkPipelineVertexInputStateCreateInfo inputVertexState(const Shaders::ShaderReflection& vertexShader, PipelinePass pass);
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState(PipelinePass pass);
 
 		VkPipelineViewportStateCreateInfo viewportState();
-		VkPipelineRasterizationStateCreateInfo rasterizationState();
+		VkPipelineRasterizationStateCreateInfo rasterizationState(PipelinePass pass);
 		VkPipelineMultisampleStateCreateInfo  multisamplingState();
-		VkPipelineColorBlendStateCreateInfo colorBlendState();
+		VkPipelineDepthStencilStateCreateInfo depthStencilState(PipelinePass pass);
+		VkPipelineColorBlendStateCreateInfo colorBlendState(PipelinePass pass);
 
-		void createRenderPass();
-		void createPipelineLayout();
+		// The late pass continues where the first one stopped, loading color and depth. Both passes are compatible,
+		// so pipelines and framebuffers made for one work with the other
+		VkRenderPass createRenderPass(bool late);
+
+		uint32_t subpassIndex(PipelinePass pass) const { return (_depthPrepass && pass != PipelinePass::DepthPrepass) ? 1 : 0; }
 		
 		VkRenderPass _vkRenderPass = VK_NULL_HANDLE;
+
+		// Second phase of occlusion culling, VK_NULL_HANDLE without it
+		VkRenderPass _vkLateRenderPass = VK_NULL_HANDLE;
+
+		// Subpass 0 writes depth, subpass 1 shades. Only with meshes loaded
+		bool _depthPrepass = false;
+
+		// Layout of the default pipeline, owned by _layoutCache
 		VkPipelineLayout _vkPipelineLayout = VK_NULL_HANDLE;
+
+		// Descriptor set and pipeline layouts reflected from the shaders, shared by every pipeline with the same interface
+		Shaders::PipelineLayoutCache _layoutCache{};
+
+		// Default pipeline, owned by _pipelineTable
 		VkPipeline _vkGraphicsPipeline = VK_NULL_HANDLE;
 
-		VkShaderModule _vertShaderModule = VK_NULL_HANDLE;
-		VkShaderModule _fragShaderModule = VK_NULL_HANDLE;
+		VkPipelineCache _vkPipelineCache = VK_NULL_HANDLE;
+
+		std::unordered_map<Shaders::PipelineKey, uint32_t, Shaders::PipelineKeyHash> _pipelines;
+		std::vector<VkPipeline> _pipelineTable;
+		std::vector<VkPipeline> _computePipelines;
+		uint64_t _pipelineStateHash = 0;
+
+		// One module per embedded shader, shared by every variant
+		VkShaderModule _shaderModules[static_cast<size_t>(Shaders::ShaderId::Count)] = {};
+
+//End Pass
+
+//Mesh Pass
+
+		// The pack is mapped, copied straight from the mapping into a staging buffer and unmapped again,
+		// only the mesh and LOD tables are kept on the CPU
+
+		void loadMeshPack();
+		void destroyMeshes();
+
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+		VkCommandBuffer beginSingleTimeCommands();
+		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+		struct MeshCamera {
+
+			glm::mat4 view;
+			glm::mat4 viewProjection;
+			glm::vec3 eye;
+
+			// Pixels per unit of error at distance 1, for LOD selection
+			float projectionScale;
+
+			// Normalizes the depth of the sort keys
+			float farPlane;
+			float nearPlane;
+
+			// Half extents of the view at distance 1, for the light clusters
+			float tanHalfFovX;
+			float tanHalfFovY;
+		};
+
+		MeshCamera meshCamera(const SceneSnapshot& scene);
+
+		uint32_t selectMeshLod(uint32_t meshIndex, const MeshCamera& camera);
+
+		// Picked once per frame so the pre-pass and the color pass draw the very same triangles, the payload of the queued draws
+		struct MeshDraw {
+
+			// Push constants of meshShader.vert and depthPrepass.vert, the position dequantization. The camera is in the
+			// light buffer so it doesn't end up in recorded command buffers
+			struct Constants {
+
+				glm::mat4 world;
+			} constants;
+
+			uint32_t indexCount;
+			uint32_t firstIndex;
+			int32_t vertexOffset;
+		};
+
+		// Fills _meshDraws and queues them for every pass, sorted by pass, pipeline, material and then front to back
+		void prepareMeshDraws(const SceneSnapshot& scene);
+		// With occlusion culling the draws are indirect, reading the commands of the given culling phase
+		void recordRenderQueue(VkCommandBuffer commandBuffer, uint32_t phase);
+
+		bool hasMeshes() const { return !_meshes.empty(); }
+
+		VkBuffer _vkVertexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _vkVertexBufferMemory = VK_NULL_HANDLE;
+
+		VkBuffer _vkIndexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _vkIndexBufferMemory = VK_NULL_HANDLE;
+
+		VkIndexType _meshIndexType = VK_INDEX_TYPE_UINT16;
+		uint32_t _meshPackFlags = 0;
+
+		std::vector<Loader::MeshPackMesh> _meshes;
+		std::vector<Loader::MeshPackLod> _meshLods;
+
+		VkVertexInputBindingDescription _meshBinding{};
+		std::vector<VkVertexInputAttributeDescription> _meshAttributes;
+
+		// Tightly packed copy of the positions after the interleaved vertices, for the depth pre-pass
+		VkDeviceSize _positionStreamOffset = 0;
+		VkVertexInputBindingDescription _positionBinding{};
+		VkVertexInputAttributeDescription _positionAttribute{};
+
+		// Render thread only
+		std::vector<MeshDraw> _meshDraws;
+		RenderQueue _renderQueue{};
+
+		RenderQueueStats _renderQueueStats{};
+		mutable std::mutex _renderQueueStatsMutex;
+
+		// A unit box until a pack is loaded, the particles still need something for the camera to orbit
+		float _meshBoundsMin[3] = { -1.0f, -1.0f, -1.0f };
+		float _meshBoundsMax[3] = { 1.0f, 1.0f, 1.0f };
+
+		// Render thread only, stats are copied out under the mutex after each frame
+		LodSelector _lodSelector{};
+
+		LodSelectionStats _lodStats{};
+		mutable std::mutex _lodStatsMutex;
+
+//End Pass
+
+//Lighting Pass
+
+		// Clustered forward lighting. The view frustum is cut into a grid of clusters, lightCluster.comp tests every light
+		// against every cluster ahead of the render pass and writes a compact list of light indices per cluster, so a
+		// fragment only loops over the lights of its own cluster. Only set up with a mesh pack, meshShader.frag is the lit shader
+
+		void createLighting();
+		void destroyLighting();
+
+		// Render thread, after the fence of the current frame
+		void uploadLights(const std::vector<PointLight>& lights, const SceneSnapshot& scene);
+		void recordLightBinning(VkCommandBuffer commandBuffer);
+
+		LightCallback _lightCallback{};
+
+		// Main thread, refilled for every packet and swapped through the packet queue like the overlay batch
+		std::vector<PointLight> _frameLights;
+
+		// LightDataHeader and the lights, host visible and mapped for as long as they live
+		VkBuffer _lightBuffers[MAX_FRAMES_IN_FLIGHT] = {};
+		VkDeviceMemory _lightBufferMemory[MAX_FRAMES_IN_FLIGHT] = {};
+		LightDataHeader* _lightData[MAX_FRAMES_IN_FLIGHT] = {};
+
+		// Offset and count per cluster and the index list they point into. Rebuilt every frame, command buffers
+		// run in submission order so one copy serves every frame in flight
+		VkBuffer _clusterBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _clusterBufferMemory = VK_NULL_HANDLE;
+
+		VkBuffer _lightIndexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _lightIndexBufferMemory = VK_NULL_HANDLE;
+
+		// Entries of the index list handed out so far, cleared before every binning dispatch
+		VkBuffer _lightCounterBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _lightCounterBufferMemory = VK_NULL_HANDLE;
+
+		uint32_t _lightIndexCapacity = 0;
+
+		VkDescriptorPool _lightingDescriptorPool = VK_NULL_HANDLE;
+
+		// Indexed by frame in flight, the binning sets for lightCluster.comp and the draw sets for the mesh layout
+		VkDescriptorSet _lightBinningSets[MAX_FRAMES_IN_FLIGHT] = {};
+		VkDescriptorSet _lightingDrawSets[MAX_FRAMES_IN_FLIGHT] = {};
+
+		// Owned by _layoutCache and _computePipelines
+		VkPipelineLayout _lightBinningLayout = VK_NULL_HANDLE;
+		VkPipeline _lightBinningPipeline = VK_NULL_HANDLE;
+
+//End Pass
+
+//Occlusion Pass
+
+		// Hierarchical-Z culling of the mesh draws. The depth buffer is reduced by compute into a power of two mip chain
+		// keeping the farthest depth, and occlusionCull.comp tests the screen rectangle and nearest depth of every draw's
+		// bounds against the level where the rectangle covers 2x2 texels. Phase 0 culls against the pyramid of the previous
+		// frame and draws, the pyramid is rebuilt from that depth, and phase 1 retests the rejected draws in a second render
+		// pass, catching what came into view. The CPU still records every queued draw, hidden ones have instanceCount 0
+
+		void createOcclusionCulling();
+		void destroyOcclusionCulling();
+
+		// Render thread, after the fence of the current frame
+		void writeCullDraws(const MeshCamera& camera);
+
+		void recordOcclusionCull(VkCommandBuffer commandBuffer, uint32_t phase);
+		void recordDepthPyramid(VkCommandBuffer commandBuffer);
+
+		// Settings with a mesh pack loaded
+		bool _occlusionCulling = false;
+
+		VkImage _depthPyramid = VK_NULL_HANDLE;
+		VkDeviceMemory _depthPyramidMemory = VK_NULL_HANDLE;
+
+		// Every level for the culling, one per level for the reduction. Always in GENERAL layout
+		VkImageView _depthPyramidView = VK_NULL_HANDLE;
+		std::vector<VkImageView> _depthPyramidLevelViews;
+		VkSampler _depthPyramidSampler = VK_NULL_HANDLE;
+
+		uint32_t _depthPyramidWidth = 0;
+		uint32_t _depthPyramidHeight = 0;
+		uint32_t _depthPyramidLevels = 0;
+
+		// Render thread only, the pyramid holds garbage until the first frame built it
+		bool _depthPyramidBuilt = false;
+
+		// CullDataHeader and the draws, host visible and mapped for as long as they live
+		VkBuffer _cullDataBuffers[MAX_FRAMES_IN_FLIGHT] = {};
+		VkDeviceMemory _cullDataBufferMemory[MAX_FRAMES_IN_FLIGHT] = {};
+		CullDataHeader* _cullData[MAX_FRAMES_IN_FLIGHT] = {};
+
+		// OCCLUSION_PHASE_COUNT commands per mesh, source of the indirect draws
+		VkBuffer _drawCommandBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _drawCommandBufferMemory = VK_NULL_HANDLE;
+
+		VkDescriptorPool _occlusionDescriptorPool = VK_NULL_HANDLE;
+
+		// One per pyramid level, and one cull set per frame in flight
+		std::vector<VkDescriptorSet> _depthReduceSets;
+		VkDescriptorSet _cullSets[MAX_FRAMES_IN_FLIGHT] = {};
+
+		// Owned by _layoutCache and _computePipelines. Level 0 uses the multisample variant with MSAA
+		VkPipelineLayout _depthReduceLayout = VK_NULL_HANDLE;
+		VkPipelineLayout _depthReduceMultisampleLayout = VK_NULL_HANDLE;
+		VkPipelineLayout _cullLayout = VK_NULL_HANDLE;
+
+		VkPipeline _depthReducePipeline = VK_NULL_HANDLE;
+		VkPipeline _depthReduceMultisamplePipeline = VK_NULL_HANDLE;
+		VkPipeline _cullPipeline = VK_NULL_HANDLE;
+
+//End Pass
+
+//Particle Pass
+
+		// Simulate, compact and emit are compute dispatches recorded ahead of the render pass, and the draw is indirect, so the
+		// alive count never comes back to the CPU. The two particle buffers swap roles every frame: the source is simulated
+		// in place and its survivors are compacted into the other one, which the new particles are appended to and which gets drawn
+
+		void createParticles();
+		void destroyParticles();
+
+		void recordParticleSimulation(VkCommandBuffer commandBuffer, const SceneSnapshot& scene);
+		void recordParticleDraw(VkCommandBuffer commandBuffer, const MeshCamera& camera);
+
+		bool hasParticles() const { return _settings.particles.capacity > 0; }
+
+		VkBuffer _particleBuffers[2] = {};
+		VkDeviceMemory _particleBufferMemory[2] = {};
+
+		// ParticleCounters, also the source of the indirect dispatch and draw
+		VkBuffer _particleCounterBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _particleCounterBufferMemory = VK_NULL_HANDLE;
+
+		VkDescriptorPool _particleDescriptorPool = VK_NULL_HANDLE;
+
+		// Compute sets are indexed by the buffer simulated, draw sets by the buffer drawn
+		VkDescriptorSet _particleComputeSets[2] = {};
+		VkDescriptorSet _particleDrawSets[2] = {};
+
+		// Owned by _layoutCache, every particle compute shader shares one layout
+		VkPipelineLayout _particleComputeLayout = VK_NULL_HANDLE;
+		VkPipelineLayout _particleDrawLayout = VK_NULL_HANDLE;
+
+		// Owned by _computePipelines and _pipelineTable
+		VkPipeline _particleEmitPipeline = VK_NULL_HANDLE;
+		VkPipeline _particleSimulatePipeline = VK_NULL_HANDLE;
+		VkPipeline _particleCompactPipeline = VK_NULL_HANDLE;
+		VkPipeline _particleFinalizePipeline = VK_NULL_HANDLE;
+		uint32_t _particleDrawPipeline = 0;
+
+		uint32_t _particleEmitWorkgroupSize = 1;
+
+		// Render thread only. Command buffers run in submission order, so the CPU side parity always matches the GPU's.
+		// Flipped once the simulation is recorded, the draw then reads the new source
+		uint32_t _particleSource = 0;
+		uint32_t _particleSeed = 0;
+		double _particleEmitDebt = 0.0;
+
+//End Pass
+
+//Overlay Pass
+
+		// Batch2D vertices are copied into persistently mapped chunk buffers, one set per frame in flight. Chunks are added
+		// as frames need them, so once the busiest frame has been seen an overlay costs a memcpy and one draw per run.
+		// Chunks left idle for overlay.trimAfterFrames are retired through the deletion queue
+
+		struct OverlayChunk {
+
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			Vertex2D* mapped = nullptr;
+		};
+
+		void createOverlay();
+		void destroyOverlay();
+
+		void createSpriteTexture();
+		void transitionSpriteLayers(VkCommandBuffer commandBuffer, uint32_t firstLayer, uint32_t layerCount, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+		void createQuadIndexBuffer();
+
+		// Render thread, after the fence of the current frame
+		void uploadOverlay(const Batch2D& batch);
+		void recordOverlay(VkCommandBuffer commandBuffer, const Batch2D& batch);
+
+		OverlayCallback _overlayCallback{};
+
+		// Main thread, refilled for every packet and swapped through the packet queue, never copied. The batches
+		// circulate between here, the queue slots and the render thread so their capacity is kept
+		Batch2D _overlayBatch{};
+
+		VkImage _spriteImage = VK_NULL_HANDLE;
+		VkDeviceMemory _spriteImageMemory = VK_NULL_HANDLE;
+		VkImageView _spriteImageView = VK_NULL_HANDLE;
+		VkSampler _spriteSampler = VK_NULL_HANDLE;
+
+		VkDescriptorPool _overlayDescriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet _overlayDescriptorSet = VK_NULL_HANDLE;
+
+		// Owned by _layoutCache and _pipelineTable, indexed by Primitive2D
+		VkPipelineLayout _overlayPipelineLayout = VK_NULL_HANDLE;
+		uint32_t _overlayPipelines[2] = {};
+
+		// Two triangles per four vertices, enough for a full chunk. Quad runs offset into it with vertexOffset
+		VkBuffer _quadIndexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _quadIndexBufferMemory = VK_NULL_HANDLE;
+
+		std::vector<OverlayChunk> _overlayChunks[MAX_FRAMES_IN_FLIGHT];
+
+		// Frames in a row each frame in flight had more chunks than it needed
+		uint32_t _overlayIdleFrames[MAX_FRAMES_IN_FLIGHT] = {};
+
+//End Pass
+
+//Capture Pass
+
+		// The finished swapchain image is copied into a host visible readback buffer at the end of the command buffer.
+		// The copy is only read after the fence of its frame in flight signals, the next time that frame comes around,
+		// so the render thread never waits on it and hands the buffer straight to the encoder thread
+
+		void createCapture();
+		void destroyCapture();
+
+		// Render thread, after the fence of the current frame
+		void collectCapture(uint64_t frameNumber);
+		void finishCapture(uint32_t frame);
+
+		// Records the copy of the pending capture into the capture command buffer of the current frame and returns it
+		VkCommandBuffer recordCapture(uint32_t imageIndex, uint32_t slot);
+
+		// Set in startSwapChain once the swapchain images can be copied from
+		bool _captureEnabled = false;
+		CapturePixelLayout _capturePixelLayout = CapturePixelLayout::BGRA;
+
+		FrameCapture _frameCapture;
+
+		// One per ring slot, mapped for as long as they live
+		std::vector<VkBuffer> _captureBuffers;
+		std::vector<VkDeviceMemory> _captureBufferMemory;
+		std::vector<uint8_t*> _captureData;
+
+		// Host cached memory is read much faster by the encoder, it is invalidated before the hand off
+		bool _captureCoherent = true;
+
+		// Copy recorded for each frame in flight, read back after its fence
+		std::optional<CapturedFrame> _pendingCaptures[MAX_FRAMES_IN_FLIGHT];
+
+		// Submitted after the frame's own command buffer, which stays the same whether the frame is captured or not
+		VkCommandBuffer _vkCaptureCommandBuffers[MAX_FRAMES_IN_FLIGHT] = {};
+
+//End Pass
+
+//Profiler Pass
+
+		// Timestamps around the compute work and the render passes of every frame, read back after the fence of their
+		// frame in flight the next time it comes around. Only recorded with EGGY_PROFILER and a trace path
+
+		void createGpuTimestamps();
+		void destroyGpuTimestamps();
+
+		// Render thread, after the fence of the current frame
+		void collectGpuTimestamps();
+
+		void writeGpuTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query);
+
+		static constexpr uint32_t GPU_TIMESTAMPS_PER_FRAME = 3;
+
+		// Set once the graphics queue is known to write timestamps
+		bool _gpuTimestamps = false;
+
+		VkQueryPool _vkTimestampQueryPool = VK_NULL_HANDLE;
+
+		// Nanoseconds per tick and the bits the graphics queue writes
+		double _timestampPeriod = 1.0;
+		uint64_t _timestampMask = ~0ull;
+
+		uint64_t _timestampSubmitTimes[MAX_FRAMES_IN_FLIGHT] = {};
+		bool _timestampsPending[MAX_FRAMES_IN_FLIGHT] = {};
+
+		// Added to GPU nanoseconds to land on the CPU clock. A frame can't start on the GPU before it was submitted, so it
+		// is the largest submit to start gap seen so far, the closest the clocks get without VK_EXT_calibrated_timestamps
+		int64_t _gpuClockOffset = INT64_MIN;
 
 //End Pass
 
 //Draw Pass
 		
-		void drawFrame();
+		void drawFrame(const FramePacket& packet);
 		void createSyncObjects();
 
 		void destroyDraw();
 
 		void createFramebuffers();
 		void createCommandPool();
-		void createCommandBuffer();
+		void createCommandBuffers();
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const SceneSnapshot& scene, const Batch2D& overlay);
 
-		void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+		// Everything a recording bakes in: the swapchain, the clear color, the draw order and pipelines, the mesh draw constants
+		// and levels and the overlay runs. Buffer contents uploaded every frame (camera, lights, overlay vertices, cull draws)
+		// aren't part of it, nor is the depth in the sort keys unless it changes the order
+		uint64_t frameContentKey(const SceneSnapshot& scene, const Batch2D& overlay) const;
 
 		std::vector<VkFramebuffer> _swapChainFramebuffers;
 
 		VkCommandPool _vkCommandPool = VK_NULL_HANDLE;
-		VkCommandBuffer _vkCommandBuffer = VK_NULL_HANDLE;
+
+		// One set per frame in flight, _currentFrame is only touched by the render thread
+		VkCommandBuffer _vkCommandBuffers[MAX_FRAMES_IN_FLIGHT] = {};
+
+		struct RecordedCommandBuffer {
+
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+			uint64_t contentKey = 0;
+			bool recorded = false;
+
+			// Published again every time the recording is replayed
+			RenderQueueStats stats{};
+		};
+
+		// With command buffer reuse, indexed by frame in flight and then swapchain image: a recording bakes in the
+		// framebuffer of its image and the descriptor sets of its frame in flight
+		bool _reuseCommandBuffers = false;
+		std::vector<RecordedCommandBuffer> _recordedCommandBuffers;
+
+		std::atomic<uint64_t> _contentGeneration{ 0 };
+
+		std::atomic<uint64_t> _commandBuffersRecorded{ 0 };
+		std::atomic<uint64_t> _commandBuffersReused{ 0 };
 		
-		VkSemaphore _vkImageAvailableSemaphore = VK_NULL_HANDLE;
-		VkSemaphore _vkRenderFinishedSemaphore = VK_NULL_HANDLE;
-		VkFence _vkInFlightFence = VK_NULL_HANDLE;
+		VkSemaphore _vkImageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT] = {};
+		VkSemaphore _vkRenderFinishedSemaphores[MAX_FRAMES_IN_FLIGHT] = {};
+		VkFence _vkInFlightFences[MAX_FRAMES_IN_FLIGHT] = {};
+
+		uint32_t _currentFrame = 0;
 
 //End Pass
 
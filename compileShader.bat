@@ -1,2 +1,18 @@
-%Vulkan_SDK%/Bin/glslc.exe simpletriangleShader.vert -o simpletriangleShader.vert.spv
-%Vulkan_SDK%/Bin/glslc.exe simpletriangleShader.frag -o simpletriangleShader.frag.spv
\ No newline at end of file
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num simpletriangleShader.vert -o simpletriangleShader.vert.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num simpletriangleShader.frag -o simpletriangleShader.frag.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num meshShader.vert -o meshShader.vert.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num meshShader.frag -o meshShader.frag.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num depthPrepass.vert -o depthPrepass.vert.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num depthPrepass.frag -o depthPrepass.frag.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num sprite2D.vert -o sprite2D.vert.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num sprite2D.frag -o sprite2D.frag.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num particleEmit.comp -o particleEmit.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num particleSimulate.comp -o particleSimulate.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num particleCompact.comp -o particleCompact.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num particleFinalize.comp -o particleFinalize.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num particle.vert -o particle.vert.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num particle.frag -o particle.frag.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num lightCluster.comp -o lightCluster.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num hiZReduce.comp -o hiZReduce.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num hiZReduceMultisample.comp -o hiZReduceMultisample.comp.inc || exit /b 1
+%Vulkan_SDK%/Bin/glslc.exe -mfmt=num occlusionCull.comp -o occlusionCull.comp.inc || exit /b 1
\ No newline at end of file
@@ -0,0 +1,5 @@
+#version 450
+
+// Depth only, there are no color attachments in the pre-pass
+void main() {
+}
@@ -0,0 +1,22 @@
+#version 450
+
+// Same transform as meshShader.vert, both declare gl_Position invariant so the color pass can test EQUAL against this depth.
+// The pipeline is created with the mesh pipeline layout, these match what meshShader.vert declares
+layout(push_constant) uniform MeshConstants {
+    mat4 world;
+} constants;
+
+layout(set = 0, binding = 0) readonly buffer LightData {
+    layout(offset = 128) mat4 viewProjection;
+} lightData;
+
+// Position only stream, R16G16B16A16_UNORM
+layout(location = 0) in vec4 inPosition;
+
+invariant gl_Position;
+
+void main() {
+    vec4 worldPosition = constants.world * inPosition;
+
+    gl_Position = lightData.viewProjection * worldPosition;
+}
@@ -1,10 +1,99 @@
 #include "VulkanEngine.hpp"
 
-int main()
+#include <cstring>
+
+int main(int argc, char** argv)
 {
-    EggyEngine::Engine _vkEngine;
-    
+    EggyEngine::EngineSettings settings{};
+
+    bool frameGraph = false;
+    uint32_t lightCount = 0;
+
+    //EggyEngine [--headless | --x11 | --wayland] [--frames N] [--frame-graph] [--particles N] [--lights N] [--occlusion] [--capture DIR] [--capture-images] [--reuse-commands] [--trace FILE] [mesh pack made with MeshConverter]
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--headless") == 0)
+            settings.window.backend = Platform::WindowBackend::Headless;
+        else if (strcmp(argv[i], "--x11") == 0)
+            settings.window.backend = Platform::WindowBackend::X11;
+        else if (strcmp(argv[i], "--wayland") == 0)
+            settings.window.backend = Platform::WindowBackend::Wayland;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            settings.window.headlessFrameLimit = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--frame-graph") == 0)
+            frameGraph = true;
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+            settings.particles.capacity = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+            lightCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--occlusion") == 0)
+            settings.occlusionCulling = true;
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            settings.capture.directory = argv[++i];
+        else if (strcmp(argv[i], "--capture-images") == 0)
+            settings.capture.format = EggyEngine::CaptureFormat::ImageSequence;
+        else if (strcmp(argv[i], "--reuse-commands") == 0)
+            settings.reuseCommandBuffers = true;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            settings.tracePath = argv[++i];
+        else
+            settings.meshPackPath = argv[i];
+    }
+
     try {
+        EggyEngine::Engine _vkEngine(settings);
+
+        //Frame times of the last 240 frames, one quad per bar and a line at the 60 Hz budget
+        std::vector<float> frameTimes(240, 0.0f);
+        size_t nextFrame = 0;
+
+        if (frameGraph)
+            _vkEngine.setOverlayCallback([&](EggyEngine::Batch2D& batch, uint32_t width, uint32_t height) {
+
+                frameTimes[nextFrame++ % frameTimes.size()] = static_cast<float>(_vkEngine.frameTiming().deltaTime * 1000.0);
+
+                float left = 16.0f;
+                float bottom = static_cast<float>(height) - 16.0f;
+                float pixelsPerMs = 3.0f;
+
+                batch.quad(left - 4.0f, bottom - 104.0f, frameTimes.size() * 2.0f + 8.0f, 108.0f, EggyEngine::rgba(0, 0, 0, 160));
+
+                for (size_t i = 0; i < frameTimes.size(); i++) {
+
+                    float ms = frameTimes[(nextFrame + i) % frameTimes.size()];
+                    float barHeight = std::min(ms * pixelsPerMs, 100.0f);
+
+                    batch.quad(left + i * 2.0f, bottom - barHeight, 2.0f, barHeight, ms > 16.7f ? EggyEngine::rgba(230, 60, 40) : EggyEngine::rgba(60, 200, 90));
+                }
+
+                batch.line(left, bottom - 16.7f * pixelsPerMs, left + frameTimes.size() * 2.0f, bottom - 16.7f * pixelsPerMs, EggyEngine::rgba(255, 220, 0));
+            });
+
+        //Colored point lights orbiting the mesh pack on stacked rings, each ring turning at its own speed
+        if (lightCount > 0)
+            _vkEngine.setLightCallback([&](std::vector<EggyEngine::PointLight>& lights, const EggyEngine::SceneSnapshot& scene) {
+
+                glm::vec3 boundsMin, boundsMax;
+                _vkEngine.meshBounds(boundsMin, boundsMax);
+
+                glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+                glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+                float lightRadius = glm::length(extent) * 0.2f;
+
+                for (uint32_t i = 0; i < lightCount; i++) {
+
+                    float ring = (i % 16) / 15.0f;
+                    float angle = i * 2.39996f + static_cast<float>(scene.simulationTime) * (0.3f + ring);
+
+                    glm::vec3 position = center + extent * glm::vec3(std::cos(angle) * 1.2f, ring * 2.0f - 1.0f, std::sin(angle) * 1.2f);
+
+                    lights.push_back({
+                        { position.x, position.y, position.z, lightRadius },
+                        { 0.5f + 0.5f * std::cos(i * 0.7f), 0.5f + 0.5f * std::cos(i * 0.7f + 2.1f), 0.5f + 0.5f * std::cos(i * 0.7f + 4.2f), 1.0f }
+                    });
+                }
+            });
+
         _vkEngine.run();
     }
     catch (std::exception& e) {
@@ -12,7 +101,7 @@ int main()
         return EXIT_FAILURE;
     }
 
-    
+
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
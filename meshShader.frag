@@ -0,0 +1,85 @@
+#version 450
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragWorldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+// MeshShading in FramePacket.hpp, baked in at pipeline creation so the unused branches are compiled out
+layout(constant_id = 0) const uint SHADING_MODE = 0;
+
+struct PointLight {
+    // xyz world position, w radius of influence
+    vec4 positionRadius;
+    // rgb color, w intensity
+    vec4 colorIntensity;
+};
+
+// Written by the CPU every frame, ClusteredLighting.hpp
+layout(set = 0, binding = 0) readonly buffer LightData {
+    mat4 view;
+    // tan of the half field of view in x and y, near and far plane
+    vec4 projection;
+    // xy clusters per pixel, z and w turn the log of the view depth into a slice
+    vec4 clusterScale;
+    // xyz cluster counts
+    uvec4 clusterGrid;
+    // x light count, y capacity of the light index list
+    uvec4 counts;
+    // Only read by the mesh vertex shaders
+    mat4 viewProjection;
+    PointLight lights[];
+} lightData;
+
+// Built every frame by lightCluster.comp
+layout(set = 0, binding = 1) readonly buffer ClusterLights {
+    uvec2 clusters[];
+};
+
+layout(set = 0, binding = 2) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+const vec3 lightDirection = normalize(vec3(0.4, 1.0, 0.3));
+
+// Only the lights binned into the cluster of this fragment
+vec3 clusteredLights(vec3 position, vec3 normal) {
+    uvec3 grid = lightData.clusterGrid.xyz;
+
+    float viewDepth = max(-(lightData.view * vec4(position, 1.0)).z, 1e-4);
+    float slice = log(viewDepth) * lightData.clusterScale.z + lightData.clusterScale.w;
+
+    uvec3 coord = min(uvec3(uvec2(gl_FragCoord.xy * lightData.clusterScale.xy), uint(max(slice, 0.0))), grid - 1u);
+    uvec2 cluster = clusters[(coord.z * grid.y + coord.y) * grid.x + coord.x];
+
+    vec3 result = vec3(0.0);
+
+    for (uint i = 0u; i < cluster.y; i++) {
+        PointLight light = lightData.lights[lightIndices[cluster.x + i]];
+
+        vec3 toLight = light.positionRadius.xyz - position;
+        float distanceSquared = dot(toLight, toLight);
+
+        // Smooth falloff reaching zero at the radius the light was binned with
+        float falloff = max(1.0 - distanceSquared / (light.positionRadius.w * light.positionRadius.w), 0.0);
+        float diffuse = max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-8))), 0.0);
+
+        result += light.colorIntensity.rgb * light.colorIntensity.w * falloff * falloff * diffuse;
+    }
+
+    return result;
+}
+
+void main() {
+    vec3 normal = normalize(fragNormal);
+
+    if (SHADING_MODE == 1) {
+        outColor = vec4(normal * 0.5 + 0.5, 1.0);
+    } else if (SHADING_MODE == 2) {
+        outColor = vec4(fract(fragTexCoord), 0.0, 1.0);
+    } else {
+        float diffuse = max(dot(normal, lightDirection), 0.0);
+        outColor = vec4(vec3(0.15 + 0.85 * diffuse) + clusteredLights(fragWorldPosition, normal), 1.0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#version 450
+
+// Position dequantization of the draw, the meshes have no model transform of their own yet
+layout(push_constant) uniform MeshConstants {
+    mat4 world;
+} constants;
+
+// The camera part of LightData in meshShader.frag, written by the CPU every frame
+layout(set = 0, binding = 0) readonly buffer LightData {
+    layout(offset = 128) mat4 viewProjection;
+} lightData;
+
+// R16G16B16A16_UNORM, w is always 1
+layout(location = 0) in vec4 inPosition;
+// R16G16_SNORM octahedral
+layout(location = 1) in vec2 inNormal;
+// R16G16_SFLOAT
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragWorldPosition;
+
+// Bit identical to depthPrepass.vert for the EQUAL depth test
+invariant gl_Position;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    vec4 worldPosition = constants.world * inPosition;
+
+    gl_Position = lightData.viewProjection * worldPosition;
+    fragNormal = decodeOctahedral(inNormal);
+    fragTexCoord = inTexCoord;
+    fragWorldPosition = worldPosition.xyz;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in float fragFade;
+
+layout(location = 0) out vec4 outColor;
+
+// Additive, so the draw order of the particles doesn't matter
+void main() {
+    float intensity = max(1.0 - dot(fragCorner, fragCorner), 0.0) * fragFade;
+    outColor = vec4(vec3(1.0, 0.55, 0.2) * intensity, intensity);
+}
\ No newline at end of file
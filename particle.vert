@@ -0,0 +1,36 @@
+#version 450
+
+// Billboards straight from the particle buffer, no vertex inputs. One instance per particle, six vertices per quad
+layout(push_constant) uniform ParticleDrawConstants {
+    mat4 viewProjection;
+    // xyz world space camera axes, w of the right axis is the particle size
+    vec4 cameraRight;
+    vec4 cameraUp;
+} constants;
+
+struct Particle {
+    // xyz position, w age in seconds
+    vec4 positionAge;
+    // xyz velocity, w lifetime in seconds
+    vec4 velocityLifetime;
+};
+
+layout(set = 0, binding = 0) readonly buffer Particles {
+    Particle particles[];
+};
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out float fragFade;
+
+const vec2 corners[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0));
+
+void main() {
+    Particle particle = particles[gl_InstanceIndex];
+    vec2 corner = corners[gl_VertexIndex];
+
+    vec3 offset = (constants.cameraRight.xyz * corner.x + constants.cameraUp.xyz * corner.y) * constants.cameraRight.w;
+
+    gl_Position = constants.viewProjection * vec4(particle.positionAge.xyz + offset, 1.0);
+    fragCorner = corner;
+    fragFade = 1.0 - clamp(particle.positionAge.w / particle.velocityLifetime.w, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 450
+
+layout(push_constant) uniform SpriteConstants {
+    vec2 pixelScale;
+    uint layer;
+} constants;
+
+// Layer 0 is white, untextured quads and lines sample it
+layout(set = 0, binding = 0) uniform sampler2DArray spriteTextures;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(spriteTextures, vec3(fragTexCoord, float(constants.layer))) * fragColor;
+}
\ No newline at end of file
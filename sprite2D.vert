@@ -0,0 +1,22 @@
+#version 450
+
+// Shared with sprite2D.frag, one range so a single push reaches both stages
+layout(push_constant) uniform SpriteConstants {
+    // 2 / framebuffer size, pixels to clip space
+    vec2 pixelScale;
+    uint layer;
+} constants;
+
+// Batch2D Vertex2D: pixels with the origin top left, R32G32_SFLOAT texture coordinate and an R8G8B8A8_UNORM color
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+    gl_Position = vec4(inPosition * constants.pixelScale - 1.0, 0.0, 1.0);
+    fragTexCoord = inTexCoord;
+    fragColor = inColor;
+}
\ No newline at end of file